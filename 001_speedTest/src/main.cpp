@@ -1,120 +1,643 @@
-#include <Arduino.h>
+#include "../../myLib/Platform.h"
+#include "../../myLib/Bench.h"
+#include "../../myLib/FastRandom.h"
+#include "../../myLib/FixedPoint.h"
+#include "../../myLib/BigFixed.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifndef ARDUINO
+#include <thread>
+#endif
 
+// ---------------------------------------------------------------
+// Jądra liczone w typie T: float, double, Q16_16, Q1_31 (FixedPoint.h),
+// wynik zawsze jako double do porównania z M_PI.
+// ---------------------------------------------------------------
+
+// wszystko przeskalowane o 1/2 (AGM(a/2, b/2) = AGM(a, b) / 2, t o 1/4),
+// a w wyniku liczone pi/4, żeby wartości mieściły się w [-1, 1) także w Q1.31
+template <class T>
 double piGaussLegendre(long int n)
 {
-  long double an = 1.0, bn = 1.0 / sqrt(2), tn = 0.25, pn = 1.0, a_pom;
+  typedef NumTraits<T> N;
+  const T half = N::fromDouble(0.5), quarter = N::fromDouble(0.25);
+  T an = half, bn = N::sqrt(N::fromDouble(0.125)), tn = N::fromDouble(0.0625), a_pom;
+  int k = 0; // pn = 2^k
   while (n--)
   {
     a_pom = an;
-    an = (an + bn) / 2;
-    bn = sqrt(a_pom * bn);
-    tn = tn - pn * pow(a_pom - an, 2);
-    pn *= 2;
+    an = (an + bn) * half;
+    bn = N::sqrt(a_pom * bn);
+    T d = a_pom - an;
+    tn = tn - N::mulPow2(d * d, k);
+    k++;
   }
-  return pow(an + bn, 2) / (4.0 * tn);
+  T s = an + bn;
+  return 4.0 * N::toDouble((s * s * quarter) / N::mulPow2(tn, 2));
 }
 
+// ułamek łańcuchowy ma wartości rzędu 2n, typ musi mieć >= 15 bitów części całkowitej
+template <class T>
 double piBrouncker(long int n)
 {
-  double wartosc = 2;
+  typedef NumTraits<T> N;
+  const T two = N::fromInt(2);
+  T wartosc = two;
   for (; n >= 0; n--)
   {
-    wartosc = double((2 * n + 1) * (2 * n + 1)) / (2.0 + wartosc);
+    T odd = N::fromInt(2 * n + 1);
+    wartosc = odd * (odd / (two + wartosc)); // (2n+1)^2 nie mieści się w Q16.16
   }
-  return 4.0 / (1.0 + wartosc);
+  return N::toDouble(N::fromInt(4) / (N::fromInt(1) + wartosc));
 }
 
-double piMonteCarlo(long int n)
+// rand() jako generator z next(), 31 losowych bitów na górze
+struct RandGenerator
+{
+  uint32_t next() { return (uint32_t)rand() << 1; }
+};
+
+template <class T, class Rng>
+double piMonteCarlo(long int n, Rng &rng)
 {
-  double x, y;
-  long int T = 0;
+  typedef NumTraits<T> N;
+  const T r2 = N::fromDouble(0.25);
+  long int hits = 0;
   for (long int i = 0; i < n; i++)
   {
-    x = double(rand()) / RAND_MAX - 0.5;
-    y = double(rand()) / RAND_MAX - 0.5;
-    if (x * x + y * y <= 0.25)
+    T x = N::fromRandom(rng.next());
+    T y = N::fromRandom(rng.next());
+    if (x * x + y * y <= r2)
     {
-      T++;
+      hits++;
     }
   }
-  return 4 * double(T) / n;
+  return 4 * double(hits) / n;
 }
 
-void setup()
+// ---------------------------------------------------------------
+// Benchmarki - to samo obciążenie co w pierwszej wersji testu
+// (tam Monte Carlo przez pomyłkę mierzyło drugi raz Gauss-Legendre).
+// ---------------------------------------------------------------
+void benchGaussLegendre()
 {
-  Serial.begin(115200);
+  for (long int n = 0; n < 100; n++)
+    benchDoNotOptimize(piGaussLegendre<double>(n));
+}
 
-  long int n;
+void benchBrouncker()
+{
+  for (long int n = 0; n <= 10000; n += 1000)
+    benchDoNotOptimize(piBrouncker<double>(n));
+}
 
-  Serial.println("Metoda Gauss–Legendre");
-  auto start = millis();
-  for (n = 0; n < 100; n++)
+// ten sam ciąg rand() w każdym powtórzeniu
+void benchMonteCarlo()
+{
+  RandGenerator rng;
+  srand(1);
+  benchDoNotOptimize(piMonteCarlo<double>(10000, rng));
+}
+
+BENCH_REGISTER(benchGaussLegendre);
+BENCH_REGISTER(benchBrouncker);
+BENCH_REGISTER(benchMonteCarlo);
+
+// ---------------------------------------------------------------
+// Monte Carlo na obu rdzeniach. Każdy rdzeń ma swój generator
+// (Xoshiro128 z jump(), Pcg32 z osobnym stream, albo esp_random()),
+// a punkt to 2 x 16 bitów z jednego losowania, test koła na liczbach
+// całkowitych. Taski robocze są tworzone raz i czekają na powiadomienie,
+// więc pomiar nie obejmuje tworzenia tasków. Na PC zamiast tasków wątki.
+// ---------------------------------------------------------------
+#define MC_SAMPLES 200000
+#define MC_SEED 20240601ull
+
+#ifdef ARDUINO
+#define MC_CORES portNUM_PROCESSORS
+#define MC_TASK_PRIORITY 5
+#else
+#define MC_CORES 2
+#endif
+
+enum McGenerator
+{
+  MC_XOSHIRO,
+  MC_PCG,
+  MC_ESP_RANDOM
+};
+
+struct McJob
+{
+  McGenerator generator;
+  uint32_t part;    // numer ciągu losowego
+  uint32_t samples;
+  uint32_t hits;
+};
+
+// punkty w kole o promieniu 2^15 wpisanym w kwadrat 2^16 x 2^16
+template <class Rng>
+uint32_t monteCarloHits(Rng &rng, uint32_t samples)
+{
+  const uint32_t R2 = 1u << 30;
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < samples; i++)
   {
-    volatile double out = piGaussLegendre(n);
+    uint32_t r = rng.next();
+    int32_t x = (int32_t)(r & 0xFFFF) - 32768;
+    int32_t y = (int32_t)(r >> 16) - 32768;
+    hits += (uint32_t)(x * x) + (uint32_t)(y * y) < R2;
   }
-  auto stop = millis();
-  auto duration = stop - start;
-  Serial.print("Czas wykonania : ");
-  Serial.print(duration);
-  Serial.println(" [ms]");
+  return hits;
+}
 
-  Serial.println("Metoda Brouncker'a");
-  start = millis();
-  for (n = 0; n <= 10000; n += 1000)
+void runMcJob(McJob &job)
+{
+  if (job.generator == MC_XOSHIRO)
+  {
+    Xoshiro128 rng(MC_SEED);
+    for (uint32_t i = 0; i < job.part; i++)
+      rng.jump();
+    job.hits = monteCarloHits(rng, job.samples);
+  }
+  else if (job.generator == MC_PCG)
+  {
+    Pcg32 rng(MC_SEED, job.part);
+    job.hits = monteCarloHits(rng, job.samples);
+  }
+#ifdef ARDUINO
+  else
   {
-    volatile double out = piBrouncker(n);
+    EspRandom rng;
+    job.hits = monteCarloHits(rng, job.samples);
   }
-  stop = millis();
-  duration = stop - start;
-  Serial.print("Czas wykonania : ");
-  Serial.print(duration);
-  Serial.println(" [ms]");
+#endif
+}
+
+McJob mcJobs[MC_CORES];
 
-  Serial.println("Metoda Monte Carlo");
-  start = millis();
-  for (n = 0; n < 100; n++)
+#ifdef ARDUINO
+TaskHandle_t mcWorkers[MC_CORES];
+TaskHandle_t mcCaller;
+
+void mcWorkerTask(void *arg)
+{
+  McJob *job = (McJob *)arg;
+  while (1)
   {
-    volatile double out = piGaussLegendre(n);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    runMcJob(*job);
+    xTaskNotifyGive(mcCaller);
   }
-  stop = millis();
-  duration = stop - start;
-  Serial.print("Czas wykonania : ");
-  Serial.print(duration);
-  Serial.println(" [ms]");
 }
 
-/*
-esp32 - D0WDxx
-Metoda Gauss–Legendre
-Czas wykonania : 32 [ms]
-Metoda Brouncker'a
-Czas wykonania : 158 [ms]
-Metoda Monte Carlo
-Czas wykonania : 31 [ms]
-*/
+void mcBegin()
+{
+  mcCaller = xTaskGetCurrentTaskHandle();
+  for (int c = 0; c < MC_CORES; c++)
+    xTaskCreatePinnedToCore(mcWorkerTask, "monteCarlo", 4096, &mcJobs[c], MC_TASK_PRIORITY, &mcWorkers[c], c);
+}
+#else
+void mcBegin() {}
+#endif
 
-/*
-esp32 S2
-Metoda Gauss–Legendre
-Czas wykonania : 37 [ms]
-Metoda Brouncker'a
-Czas wykonania : 219 [ms]
-Metoda Monte Carlo
-Czas wykonania : 37 [ms]
-*/
+// samples punktów podzielonych na cores rdzeni, zwraca przybliżenie pi
+double piMonteCarloParallel(McGenerator generator, uint32_t samples, int cores)
+{
+  for (int c = 0; c < cores; c++)
+  {
+    mcJobs[c].generator = generator;
+    mcJobs[c].part = c;
+    mcJobs[c].samples = samples / cores + (c < (int)(samples % cores) ? 1 : 0);
+    mcJobs[c].hits = 0;
+  }
+  if (cores == 1)
+  {
+    runMcJob(mcJobs[0]); // bez tasków, w bieżącym
+  }
+  else
+  {
+#ifdef ARDUINO
+    for (int c = 0; c < cores; c++)
+      xTaskNotifyGive(mcWorkers[c]);
+    for (int c = 0; c < cores; c++)
+      ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+#else
+    std::thread workers[MC_CORES];
+    for (int c = 0; c < cores; c++)
+      workers[c] = std::thread(runMcJob, std::ref(mcJobs[c]));
+    for (int c = 0; c < cores; c++)
+      workers[c].join();
+#endif
+  }
+  uint32_t hits = 0;
+  for (int c = 0; c < cores; c++)
+    hits += mcJobs[c].hits;
+  return 4.0 * hits / samples;
+}
+
+void benchMcXoshiro1() { benchDoNotOptimize(piMonteCarloParallel(MC_XOSHIRO, MC_SAMPLES, 1)); }
+void benchMcXoshiroAll() { benchDoNotOptimize(piMonteCarloParallel(MC_XOSHIRO, MC_SAMPLES, MC_CORES)); }
+void benchMcPcg1() { benchDoNotOptimize(piMonteCarloParallel(MC_PCG, MC_SAMPLES, 1)); }
+void benchMcPcgAll() { benchDoNotOptimize(piMonteCarloParallel(MC_PCG, MC_SAMPLES, MC_CORES)); }
+
+BenchCase mcXoshiro1("mcXoshiro1", benchMcXoshiro1);
+BenchCase mcXoshiroAll("mcXoshiroAll", benchMcXoshiroAll);
+BenchCase mcPcg1("mcPcg1", benchMcPcg1);
+BenchCase mcPcgAll("mcPcgAll", benchMcPcgAll);
+
+#ifdef ARDUINO
+void benchMcEsp1() { benchDoNotOptimize(piMonteCarloParallel(MC_ESP_RANDOM, MC_SAMPLES, 1)); }
+void benchMcEspAll() { benchDoNotOptimize(piMonteCarloParallel(MC_ESP_RANDOM, MC_SAMPLES, MC_CORES)); }
+
+BenchCase mcEsp1("mcEspRandom1", benchMcEsp1);
+BenchCase mcEspAll("mcEspRandomAll", benchMcEspAll);
+#endif
+
+// przyspieszenie z median, sprawność = przyspieszenie / liczba rdzeni
+void printSpeedup(const char *name, const BenchCase &one, const BenchCase &all)
+{
+  double speedup = (double)one.result.medianCycles / all.result.medianCycles;
+  Serial.printf("%-12s 1 rdzen %10u  %d rdzenie %10u  przyspieszenie %.2fx  sprawnosc %.0f %%\n", name,
+                (unsigned)one.result.medianCycles, MC_CORES, (unsigned)all.result.medianCycles, speedup,
+                100.0 * speedup / MC_CORES);
+  Serial.printf("SPEEDUP,%s,%s,%s,%d,%.3f,%.3f\n", BENCH_TARGET, BENCH_BOARD, name, MC_CORES, speedup,
+                speedup / MC_CORES);
+}
+
+// ---------------------------------------------------------------
+// Dokładność kontra czas dla każdego typu. Czas to mediana w cyklach,
+// błąd |wynik - M_PI|. Monte Carlo ma ten sam ciąg Xoshiro128 dla
+// wszystkich typów, więc różnice błędu to tylko rozdzielczość typu.
+// ---------------------------------------------------------------
+#define TYPE_MC_SAMPLES 20000
+
+void printAccuracy(const char *type, const char *kernel, long int param, double value, const BenchResult &r)
+{
+  Serial.printf("%-7s %-14s %6ld %14.10f %10.2e %12u\n", type, kernel, param, value, fabs(value - M_PI),
+                (unsigned)r.medianCycles);
+  Serial.printf("ACCURACY,%s,%s,%s,%s,%ld,%.10f,%.3e,%u\n", BENCH_TARGET, BENCH_BOARD, type, kernel, param, value,
+                fabs(value - M_PI), (unsigned)r.medianCycles);
+}
+
+template <class T>
+void runTypeTable()
+{
+  typedef NumTraits<T> N;
+
+  const long int iterations[] = {1, 2, 3};
+  for (long int n : iterations)
+  {
+    BenchResult r = benchMeasure([n]()
+                                 { benchDoNotOptimize(piGaussLegendre<T>(n)); });
+    printAccuracy(N::name(), "gaussLegendre", n, piGaussLegendre<T>(n), r);
+  }
+
+  const long int terms[] = {100, 1000, 10000};
+  for (long int n : terms)
+  {
+    if (N::INT_BITS < 15)
+    {
+      Serial.printf("%-7s %-14s %6ld   poza zakresem typu\n", N::name(), "brouncker", n);
+      continue;
+    }
+    BenchResult r = benchMeasure([n]()
+                                 { benchDoNotOptimize(piBrouncker<T>(n)); });
+    printAccuracy(N::name(), "brouncker", n, piBrouncker<T>(n), r);
+  }
+
+  BenchResult r = benchMeasure([]()
+                               {
+                                 Xoshiro128 rng(MC_SEED);
+                                 benchDoNotOptimize(piMonteCarlo<T>(TYPE_MC_SAMPLES, rng)); });
+  Xoshiro128 rng(MC_SEED);
+  printAccuracy(N::name(), "monteCarlo", TYPE_MC_SAMPLES, piMonteCarlo<T>(TYPE_MC_SAMPLES, rng), r);
+}
+
+void runTypeTables()
+{
+  Serial.printf("\n# typy liczbowe: %s / %s, czas w cyklach (mediana z %u)\n", BENCH_TARGET, BENCH_BOARD,
+                (unsigned)BENCH_REPS);
+  Serial.printf("%-7s %-14s %6s %14s %10s %12s\n", "typ", "jadro", "param", "wynik", "blad", "cykle");
+  runTypeTable<float>();
+  runTypeTable<double>();
+  runTypeTable<Q16_16>();
+  runTypeTable<Q1_31>();
+
+  // wybór typu dla płytki według wymaganej liczby bitów ułamka
+  Serial.printf("FastestReal<12> = %s, <16> = %s, <23> = %s, <40> = %s\n", NumTraits<FastestReal<12>::type>::name(),
+                NumTraits<FastestReal<16>::type>::name(), NumTraits<FastestReal<23>::type>::name(),
+                NumTraits<FastestReal<40>::type>::name());
+}
+
+// ---------------------------------------------------------------
+// Gauss-Legendre na liczbach wielokrotnej precyzji (BigFixed.h):
+// ~log2(cyfry) iteracji, w każdej pierwiastek Newtona i kilka mnożeń
+// Karatsuby na setkach słów. Obciąża mnożarkę 32 x 32, dodawanie
+// z przeniesieniem i pamięć (bufory po kilka KB), a nie libm.
+// Pierwsze 100 cyfr porównywane ze stałą, na PC wszystkie cyfry
+// z niezależnie policzonym wzorem Machina (tylko dzielenie przez słowo).
+// ---------------------------------------------------------------
+#define BIGPI_MUL_LIMBS 128
+
+const char *const PI_DIGITS_100 = "1415926535897932384626433832795028841971693993751058209749445923078164062862089986280348253421170679";
+
+class BigPi
+{
+public:
+  BigFixedMath math;
+  limb_t *a, *b, *t, *x, *y;
+  uint32_t digits;
+
+  explicit BigPi(uint32_t piDigits) : math(BigFixedMath::fracLimbsForDigits(piDigits)), digits(piDigits)
+  {
+    a = new (std::nothrow) limb_t[math.limbs()];
+    b = new (std::nothrow) limb_t[math.limbs()];
+    t = new (std::nothrow) limb_t[math.limbs()];
+    x = new (std::nothrow) limb_t[math.limbs()];
+    y = new (std::nothrow) limb_t[math.limbs()];
+  }
+
+  ~BigPi()
+  {
+    delete[] a;
+    delete[] b;
+    delete[] t;
+    delete[] x;
+    delete[] y;
+  }
+
+  BigPi(const BigPi &) = delete;
+  BigPi &operator=(const BigPi &) = delete;
+
+  bool ok() const { return math.ok() && a && b && t && x && y; }
+
+  // pi do y, zwraca liczbę iteracji
+  uint32_t gaussLegendre()
+  {
+    size_t frac = math.fracLimbs();
+    math.setInt(a, 1);
+    math.setInt(x, 2);
+    math.invSqrt(b, x); // b = 1/sqrt(2)
+    math.setDouble(t, 0.25);
+    uint32_t k = 0;
+    for (; k < 40; k++)
+    {
+      // a - b < 2^(-32 frac / 2), dalsze poprawki t poniżej dokładności
+      math.sub(x, a, b);
+      size_t top = frac;
+      while (top > 0 && x[top] == 0)
+        top--;
+      if (x[top] == 0 || top < frac / 2)
+        break;
+
+      math.add(y, a, b);
+      math.shiftRight(y, y, 1); // a(n+1) = (a + b) / 2
+      math.mul(x, a, b);
+      math.sqrtOf(b, x);        // b(n+1) = sqrt(a b)
+      math.sub(x, a, y);
+      math.mul(x, x, x);
+      math.shiftLeft(x, x, k);
+      math.sub(t, t, x);        // t(n+1) = t - 2^n (a - a(n+1))^2
+      math.copy(a, y);
+    }
+    math.add(x, a, b);
+    math.mul(x, x, x);
+    math.shiftLeft(t, t, 2);
+    math.div(y, x, t);          // (a + b)^2 / 4t
+    return k;
+  }
+
+  // pi = 16 atan(1/5) - 4 atan(1/239) do y, szeregi Taylora przez limbDiv1()
+  void machin()
+  {
+    atanInverse(a, 5);
+    math.shiftLeft(a, a, 4);
+    atanInverse(b, 239);
+    math.shiftLeft(b, b, 2);
+    math.sub(y, a, b);
+  }
+
+private:
+  // r = atan(1/n) = sum (-1)^k / ((2k + 1) n^(2k + 1)), w x kolejne 1/n^(2k+1)
+  void atanInverse(limb_t *r, limb_t n)
+  {
+    size_t len = math.limbs();
+    math.setInt(x, 1);
+    limbDiv1(x, x, len, n);
+    math.copy(r, x);
+    for (limb_t k = 1;; k++)
+    {
+      limbDiv1(x, x, len, n * n);
+      limbDiv1(t, x, len, 2 * k + 1);
+      bool zero = true;
+      for (size_t i = 0; i < len && zero; i++)
+        zero = t[i] == 0;
+      if (zero)
+        break;
+      if (k & 1)
+        math.sub(r, r, t);
+      else
+        math.add(r, r, t);
+    }
+  }
+};
+
+// cyfry po przecinku z y, zgodność z PI_DIGITS_100 (i z wzorem Machina na PC)
+bool checkBigPi(BigPi &pi, char *decimals)
+{
+  pi.math.toDecimal(pi.y, decimals, pi.digits);
+  size_t prefix = pi.digits < 100 ? pi.digits : 100;
+  bool ok = pi.y[pi.math.fracLimbs()] == 3 && strncmp(decimals, PI_DIGITS_100, prefix) == 0;
+#ifndef ARDUINO
+  // machin() nadpisuje y, cyfry Gauss-Legendre są już w decimals
+  char *reference = new char[pi.digits + 1];
+  pi.machin();
+  pi.math.toDecimal(pi.y, reference, pi.digits);
+  size_t same = 0;
+  while (same < pi.digits && decimals[same] == reference[same])
+    same++;
+  Serial.printf("  Machin: zgodnych %u z %u cyfr\n", (unsigned)same, (unsigned)pi.digits);
+  ok = ok && same == pi.digits;
+  delete[] reference;
+#endif
+  return ok;
+}
+
+// mnożenie n słów: szkolne i Karatsuba, miliony iloczynów słów na sekundę
+void runLimbMul(uint32_t n)
+{
+  limb_t *a = new limb_t[n], *b = new limb_t[n], *r = new limb_t[2 * n];
+  limb_t *scratch = new limb_t[limbMulScratch(n) + 1];
+  Xoshiro128 rng(MC_SEED);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    a[i] = rng.next();
+    b[i] = rng.next();
+  }
+  BenchResult basecase = benchMeasure([&]()
+                                      { limbMulBasecase(r, a, b, n); benchClobberMemory(); });
+  BenchResult karatsuba = benchMeasure([&]()
+                                       { limbMul(r, a, b, n, scratch); benchClobberMemory(); });
+  double mhz = GetTimeDiv::getCpuHz() / 1e6;
+  Serial.printf("mnozenie %u slow: szkolne %u cykli (%.1f M iloczynow/s), Karatsuba %u cykli\n", (unsigned)n,
+                (unsigned)basecase.medianCycles, (double)n * n * mhz / basecase.medianCycles,
+                (unsigned)karatsuba.medianCycles);
+  Serial.printf("LIMBMUL,%s,%s,%u,%u,%u\n", BENCH_TARGET, BENCH_BOARD, (unsigned)n, (unsigned)basecase.medianCycles,
+                (unsigned)karatsuba.medianCycles);
+  delete[] a;
+  delete[] b;
+  delete[] r;
+  delete[] scratch;
+}
+
+void runBigPi(uint32_t digits, uint32_t reps)
+{
+  BigPi pi(digits);
+  char *decimals = new (std::nothrow) char[digits + 1];
+  if (!pi.ok() || !decimals)
+  {
+    Serial.printf("%6u cyfr: za malo pamieci\n", (unsigned)digits);
+    delete[] decimals;
+    return;
+  }
+  uint32_t iterations = 0;
+  BenchResult r = benchMeasure([&]()
+                               { iterations = pi.gaussLegendre(); },
+                               reps > 1 ? 1 : 0, reps);
+  bool ok = checkBigPi(pi, decimals);
+  double ms = GetTimeDiv::cyclesToNanos(r.medianCycles) / 1e6;
+  Serial.printf("%6u cyfr %5u slow %3u iteracji %12u cykli %9.1f ms  3.%.10s...%s  %s\n", (unsigned)digits,
+                (unsigned)pi.math.limbs(), (unsigned)iterations, (unsigned)r.medianCycles, ms, decimals,
+                decimals + digits - 10, ok ? "OK" : "BLAD");
+  Serial.printf("BIGPI,%s,%s,%u,%u,%u,%u,%.1f,%d\n", BENCH_TARGET, BENCH_BOARD, (unsigned)digits,
+                (unsigned)pi.math.limbs(), (unsigned)iterations, (unsigned)r.medianCycles, ms, ok);
+  delete[] decimals;
+}
+
+void runBigPiTable()
+{
+  Serial.printf("\n# pi wielokrotnej precyzji: %s / %s, Karatsuba od %u slow\n", BENCH_TARGET, BENCH_BOARD,
+                (unsigned)BIGFIXED_KARATSUBA);
+  runLimbMul(BIGPI_MUL_LIMBS);
+  runBigPi(1000, 5);
+  runBigPi(3000, 3);
+  runBigPi(10000, 1);
+}
+
+// wektory referencyjne generatorów: pcg32-demo (seed 42, stream 54),
+// xoshiro128** ze stanem {1, 2, 3, 4} i splitmix64 z ziarnem 1234567
+bool checkRandom()
+{
+  static const uint32_t PCG[] = {0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e};
+  static const uint32_t XOSHIRO[] = {11520, 0, 5927040, 70819200, 2031721883, 1637235492};
+  static const uint64_t SPLITMIX[] = {6457827717110365317ull, 3203168211198807973ull, 9817491932198370423ull};
+  bool ok = true;
+  Pcg32 pcg(42, 54);
+  for (uint32_t i = 0; i < sizeof(PCG) / sizeof(PCG[0]); i++) ok &= pcg.next() == PCG[i];
+  Xoshiro128 xoshiro(1, 2, 3, 4);
+  for (uint32_t i = 0; i < sizeof(XOSHIRO) / sizeof(XOSHIRO[0]); i++) ok &= xoshiro.next() == XOSHIRO[i];
+  uint64_t x = 1234567;
+  for (uint32_t i = 0; i < sizeof(SPLITMIX) / sizeof(SPLITMIX[0]); i++) ok &= splitMix64(x) == SPLITMIX[i];
+  Serial.printf("generatory (pcg32, xoshiro128**, splitmix64) wektory referencyjne: %s\n", ok ? "OK" : "BLAD");
+  return ok;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(500);
+
+  checkRandom();
+  mcBegin();
+  RandGenerator rng;
+  Serial.printf("pi: rand() %.5f  xoshiro %.5f  pcg %.5f\n", piMonteCarlo<double>(MC_SAMPLES, rng),
+                piMonteCarloParallel(MC_XOSHIRO, MC_SAMPLES, MC_CORES), piMonteCarloParallel(MC_PCG, MC_SAMPLES, MC_CORES));
+
+  BenchRunner::runAll(Serial);
+
+  Serial.println();
+  printSpeedup("xoshiro", mcXoshiro1, mcXoshiroAll);
+  printSpeedup("pcg", mcPcg1, mcPcgAll);
+#ifdef ARDUINO
+  printSpeedup("esp_random", mcEsp1, mcEspAll);
+#endif
+
+  runTypeTables();
+  runBigPiTable();
+}
 
 /*
-esp32 C3
-Metoda Gauss–Legendre
-Czas wykonania : 179 [ms]
-Metoda Brouncker'a
-Czas wykonania : 199 [ms]
-Metoda Monte Carlo
-Czas wykonania : 179 [ms]
+pierwsza wersja, jeden przebieg mierzony millis():
+esp32 - D0WDxx   Gauss–Legendre 32 ms,  Brouncker 158 ms
+esp32 S2         Gauss–Legendre 37 ms,  Brouncker 219 ms
+esp32 C3         Gauss–Legendre 179 ms, Brouncker 199 ms
+(wiersz "Monte Carlo" mierzył piGaussLegendre, wyniki do powtórzenia)
+
+PC (x86-64, g++ -O2), pio run -e native, "cykl" = 1 ns:
+benchmark                 reps          min      mediana      srednia      odch.   min [us]
+benchGaussLegendre          11        50461        50708        52864       7201       50.5
+benchBrouncker              11       393375       396323       400422      13312      393.4
+benchMonteCarlo             11       511443       520798       546772      66341      511.4
+mcXoshiro1                  11       644928       653032       864593     432692      644.9
+mcXoshiroAll                11       659223       763497      1082398     656273      659.2
+mcPcg1                      11       607659       679960       762751     227501      607.7
+mcPcgAll                    11       722657       787078      1163577    1297485      722.7
+(maszyna z 1 dostępnym rdzeniem - przyspieszenie 0.86x to tylko koszt wątków,
+ na ESP32 porównać wiersze SPEEDUP dla D0WD; S2 i C3 mają jeden rdzeń)
+
+typy liczbowe: native / host, czas w cyklach (mediana z 11)
+typ     jadro           param          wynik       blad        cykle
+float   gaussLegendre       1   3.1405794621   1.01e-03           26
+float   gaussLegendre       2   3.1415927410   8.74e-08           36
+float   gaussLegendre       3   3.1415927410   8.74e-08           43
+float   brouncker         100   3.1319813728   9.61e-03          810
+float   brouncker        1000   3.1405966282   9.96e-04         7885
+float   brouncker       10000   3.1414928436   9.98e-05        79149
+float   monteCarlo      20000   3.1306000000   1.10e-02       123778
+double  gaussLegendre       1   3.1405792505   1.01e-03           33
+double  gaussLegendre       2   3.1415926462   7.38e-09           45
+double  gaussLegendre       3   3.1415926536   8.88e-16           54
+double  brouncker         100   3.1319812059   9.61e-03          942
+double  brouncker        1000   3.1405966419   9.96e-04         9189
+double  brouncker       10000   3.1414926936   1.00e-04        92407
+double  monteCarlo      20000   3.1306000000   1.10e-02       123366
+Q16.16  gaussLegendre       1   3.1398925781   1.70e-03           90
+Q16.16  gaussLegendre       2   3.1398925781   1.70e-03          141
+Q16.16  gaussLegendre       3   3.1396484375   1.94e-03          185
+Q16.16  brouncker         100   3.1319732666   9.62e-03          946
+Q16.16  brouncker        1000   3.1407928467   8.00e-04         9265
+Q16.16  brouncker       10000   3.1415863037   6.35e-06        92084
+Q16.16  monteCarlo      20000   3.1308000000   1.08e-02       108630
+Q1.31   gaussLegendre       1   3.1405792199   1.01e-03           99
+Q1.31   gaussLegendre       2   3.1415925864   6.72e-08          132
+Q1.31   gaussLegendre       3   3.1415925864   6.72e-08          174
+Q1.31   brouncker         100   poza zakresem typu
+Q1.31   brouncker        1000   poza zakresem typu
+Q1.31   brouncker       10000   poza zakresem typu
+Q1.31   monteCarlo      20000   3.1306000000   1.10e-02       106020
+FastestReal<12> = double, <16> = double, <23> = double, <40> = double
+(PC ma sprzętowy double, na ESP32 FastestReal wybiera float, na S2 i C3 Q16.16)
+
+pi wielokrotnej precyzji: native / host, Karatsuba od 24 slow
+mnozenie 128 slow: szkolne 28523 cykli (574.4 M iloczynow/s), Karatsuba 17877 cykli
+  1000 cyfr   107 slow   9 iteracji      2187410 cykli       2.2 ms  3.1415926535...2164201989  OK
+  3000 cyfr   315 slow  11 iteracji     13484787 cykli      13.5 ms  3.1415926535...6494231961  OK
+ 10000 cyfr  1042 slow  12 iteracji     78877865 cykli      78.9 ms  3.1415926535...5256375678  OK
+(wszystkie cyfry zgodne ze wzorem Machina; na ESP32 porównać wiersze BIGPI
+ i LIMBMUL między LX6, LX7 i RISC-V C3)
 */
 
 void loop()
 {
   delay(10);
 }
+
+#ifndef ARDUINO
+int main()
+{
+  setup();
+  return 0;
+}
+#endif
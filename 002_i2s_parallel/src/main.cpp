@@ -1,12 +1,457 @@
-#include <Arduino.h>
-//#include <I2S.h>
-//#include <driver/i2s.h>
+#include "../../myLib/Platform.h"
+#include "../../myLib/I2sParallel.h"
+#include "../../myLib/LogicCapture.h"
+#include <stdarg.h>
+
+// strona WWW analizatora (softAP "logic"), 0 = tylko Serial
+#ifndef LOGIC_WEB
+#define LOGIC_WEB 1
+#endif
+
+#if LOGIC_WEB && defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+#include <WiFi.h>
+#include <WebServer.h>
+#endif
+
+// ---------------------------------------------------------------
+// Magistrala równoległa z I2S1 + DMA (myLib/I2sParallel.h).
+// Na ESP32: 8 bitów na BUS_PINS, zegar na CLOCK_PIN, na wyjściu licznik
+// 0, 1, 2... (piła na przetworniku R-2R, na analizatorze widać ciągłość
+// między buforami). Callback z przerwania EOF dopisuje kolejny odcinek,
+// co sekundę statystyki: przepustowość, niedobory, pominięte przerwania.
+// Na PC ([env:native]): sprawdzenie pierścienia deskryptorów i liczenia
+// niedoborów na symulowanej kolejności przerwań.
+//
+// Analizator stanów (myLib/LogicCapture.h): I2S0 w trybie kamery
+// czyta LOGIC_PINS z zegarem LOGIC_HZ, RLE w locie do PSRAM (albo DRAM
+// bez PSRAM). Po połączeniu BUS_PINS z LOGIC_PINS widać własną piłę,
+// normalnie przekaźniki, OneWire itp. Obsługa przez WWW (softAP "logic"):
+//   /                              stan zapisu
+//   /arm?trigger=f0&pre=1000&samples=5000000   uzbrojenie
+//   /stop                          koniec zapisu
+//   /capture.vcd                   pobranie, PulseView: Import -> VCD
+// Trigger jak w LogicTrigger::parse: r/f = zbocze, h/l = poziom, np.
+// "f0,h1" opadające D0 przy D1 = 1, pusty = od razu.
+// Na PC dodatkowo test RLE, wyzwalania i zapisu VCD.
+// ---------------------------------------------------------------
+#define BUS_WIDTH 8
+#define BUS_CLOCK_HZ 20000000
+#define BUFFER_SAMPLES 4000  // 8000 B, dwa deskryptory na bufor
+#define BUFFER_COUNT 2
+#define STATS_MS 1000
+
+// bez GPIO16/17 (PSRAM na płytkach WROVER) i pinów tylko wejściowych
+const int8_t BUS_PINS[16] = {4, 5, 18, 19, 21, 22, 23, 13, -1, -1, -1, -1, -1, -1, -1, -1};
+const int8_t CLOCK_PIN = 14;
+
+#define LOGIC_CHANNELS 8
+#define LOGIC_HZ 2000000
+#define LOGIC_BUFFER_SAMPLES 4096
+#define LOGIC_BUFFER_COUNT 4
+#define LOGIC_PSRAM_RESERVE (64 * 1024)  // PSRAM zostawiony innym, reszta na przebiegi
+#define LOGIC_RUNS_DRAM (16 * 1024)      // 64 KB bez PSRAM
+
+// 34-39 tylko wejścia, w sam raz na analizator; zegar LEDC pętlą przez LOGIC_CLOCK_PIN
+const int8_t LOGIC_PINS[16] = {34, 35, 36, 39, 32, 33, 25, 26, -1, -1, -1, -1, -1, -1, -1, -1};
+const int8_t LOGIC_CLOCK_PIN = 27;
+
+struct Ramp {
+  uint16_t next;
+};
+
+Ramp ramp = {0};
+
+// cały bufor naraz, w przerwaniu
+void IRAM_ATTR fillRamp(uint16_t *buffer, uint32_t samples, void *arg) {
+  Ramp *r = (Ramp *)arg;
+  uint16_t v = r->next;
+  for (uint32_t i = 0; i < samples; i++) buffer[I2sParallel::sampleIndex(i)] = v++;
+  r->next = v;
+}
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+I2sParallel bus;
+uint32_t statsTime = 0;
+
+LogicAnalyzer logic;
+RleRun *logicRuns = nullptr;
+uint32_t logicRunCount = 0;
+
+void logicStatus(String &text) {
+  const RleEncoder &rle = logic.getCapture().getRle();
+  static const char *names[] = {"idle", "armed", "capturing", "done"};
+  LogicAnalyzerStats s = logic.getStats();
+  char line[160];
+  snprintf(line, sizeof(line), "%s, %u Hz, %llu probek, %u/%u przebiegow, bufory %u, przepelnienia %u\n",
+           names[logic.getState()], (unsigned)logic.getSampleHz(), (unsigned long long)rle.sampleCount(),
+           (unsigned)rle.runCount(), (unsigned)logicRunCount, (unsigned)s.buffers, (unsigned)s.overruns);
+  text += line;
+}
+
+#if LOGIC_WEB
+WebServer server(80);
+
+// VCD kawałkami przez chunked transfer, zapis może mieć megabajty
+class HttpOut {
+private:
+  char text[1024];
+  size_t used = 0;
+
+public:
+  void flush() {
+    if (used) server.sendContent(text, used);
+    used = 0;
+  }
+
+  void printf(const char *format, ...) {
+    if (used > sizeof(text) - 128) flush();
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text + used, sizeof(text) - used, format, args);
+    va_end(args);
+    if (n > 0) used += (size_t)n < sizeof(text) - used ? (size_t)n : sizeof(text) - used - 1;
+  }
+};
+
+void webBegin() {
+  WiFi.softAP("logic");
+  server.on("/", []() {
+    String page;
+    logicStatus(page);
+    page += "/arm?trigger=f0&pre=1000&samples=5000000, /stop, /capture.vcd\n";
+    server.send(200, "text/plain", page);
+  });
+  server.on("/arm", []() {
+    LogicTrigger t;
+    if (!t.parse(server.arg("trigger").c_str())) {
+      server.send(400, "text/plain", "zly trigger\n");
+      return;
+    }
+    uint32_t pre = server.hasArg("pre") ? server.arg("pre").toInt() : 0;
+    uint64_t samples = server.hasArg("samples") ? (uint64_t)server.arg("samples").toInt() : 0;
+    logic.arm(logicRuns, logicRunCount, t, pre, samples);
+    String page;
+    logicStatus(page);
+    server.send(200, "text/plain", page);
+  });
+  server.on("/stop", []() {
+    logic.stop();
+    String page;
+    logicStatus(page);
+    server.send(200, "text/plain", page);
+  });
+  server.on("/capture.vcd", []() {
+    if (logic.getState() == LOGIC_ARMED || logic.getState() == LOGIC_CAPTURING) logic.stop();
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.sendHeader("Content-Disposition", "attachment; filename=capture.vcd");
+    server.send(200, "text/plain", "");
+    HttpOut out;
+    const LogicCapture &c = logic.getCapture();
+    VcdWriter::write(out, c.getRle(), logic.getChannels(), logic.getSampleHz(), c.getTriggerSample(),
+                     c.isTruncated());
+    out.flush();
+    server.sendContent("");
+  });
+  server.begin();
+  Serial.printf("logic: http://%s/\n", WiFi.softAPIP().toString().c_str());
+}
+#endif
+
+// ESP32 mapuje do 4 MB PSRAM, część zajmuje sterta, więc rozmiar z największego
+// wolnego bloku, a nie stały
+bool logicBegin() {
+  size_t psram = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  logicRunCount = psram > LOGIC_PSRAM_RESERVE ? (psram - LOGIC_PSRAM_RESERVE) / sizeof(RleRun) : 0;
+  if (logicRunCount > LOGIC_RUNS_DRAM)
+    logicRuns = (RleRun *)heap_caps_malloc(logicRunCount * sizeof(RleRun), MALLOC_CAP_SPIRAM);
+  if (!logicRuns) {
+    logicRunCount = LOGIC_RUNS_DRAM;
+    logicRuns = (RleRun *)heap_caps_malloc(logicRunCount * sizeof(RleRun), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (!logicRuns) return false;
+
+  LogicAnalyzerConfig cfg = {};
+  memcpy(cfg.dataPins, LOGIC_PINS, sizeof(cfg.dataPins));
+  cfg.channels = LOGIC_CHANNELS;
+  cfg.clockPin = LOGIC_CLOCK_PIN;
+  cfg.sampleHz = LOGIC_HZ;
+  cfg.samples = LOGIC_BUFFER_SAMPLES;
+  cfg.bufferCount = LOGIC_BUFFER_COUNT;
+  if (!logic.begin(cfg)) return false;
+  Serial.printf("logic: %u kanalow, %u Hz, %u przebiegow (%u KB)\n", LOGIC_CHANNELS, LOGIC_HZ,
+                (unsigned)logicRunCount, (unsigned)(logicRunCount * sizeof(RleRun) / 1024));
+  return true;
+}
 
 void setup() {
   Serial.begin(115200);
   delay(500);
+
+  I2sParallelConfig cfg = {};
+  memcpy(cfg.dataPins, BUS_PINS, sizeof(cfg.dataPins));
+  cfg.busWidth = BUS_WIDTH;
+  cfg.clockPin = CLOCK_PIN;
+  cfg.clockHz = BUS_CLOCK_HZ;
+  cfg.samples = BUFFER_SAMPLES;
+  cfg.bufferCount = BUFFER_COUNT;
+  cfg.fill = fillRamp;
+  cfg.arg = &ramp;
+  if (!bus.begin(cfg)) {
+    Serial.println("I2S parallel: blad inicjalizacji");
+    return;
+  }
+  Serial.printf("I2S parallel: %u bit, %u Hz, %u x %u probek\n", BUS_WIDTH, (unsigned)bus.getClockHz(),
+                BUFFER_COUNT, BUFFER_SAMPLES);
+  statsTime = millis();
+
+  if (!logicBegin()) {
+    Serial.println("logic: blad inicjalizacji");
+    return;
+  }
+#if LOGIC_WEB
+  webBegin();
+#endif
 }
 
 void loop() {
+#if LOGIC_WEB
+  server.handleClient();
+#endif
+  if (millis() - statsTime >= STATS_MS) {
+    statsTime = millis();
+    I2sParallelStats s = bus.takeStats();
+    s.print(Serial, "i2s");
+    Serial.printf("I2SPAR,%u,%u,%u,%u,%u\n", (unsigned)bus.getClockHz(), (unsigned)s.bytesPerSecond(),
+                  (unsigned)s.underruns, (unsigned)s.missed, (unsigned)s.maxFillCycles);
+    if (logic.getState() != LOGIC_IDLE) {
+      String text = "logic: ";
+      logicStatus(text);
+      Serial.print(text);
+    }
+  }
+  delay(2);
 }
 
+#else
+// na PC i na układach bez trybu LCD w I2S1 (S2, C3) tylko test logiki
+bool checkChain(uint32_t samples, uint32_t count) {
+  static uint16_t memory[4][8192];
+  static DmaDescriptor desc[32];
+  uint8_t *buffers[4];
+  for (uint32_t i = 0; i < count; i++) buffers[i] = (uint8_t *)memory[i];
+  uint32_t bytes = samples * 2;
+  uint32_t n = DmaChain::build(desc, 32, buffers, count, bytes);
+  uint32_t ring = DmaChain::check(desc, n, count);
+  bool ok = n == DmaChain::descriptorsFor(bytes) * count && ring == bytes * count;
+  // deskryptor z eof każdego bufora wskazuje na ten bufor
+  for (uint32_t i = 0; i < n && ok; i++)
+    if (desc[i].eof)
+      ok = DmaChain::bufferOf(desc, &desc[i], n / count) == (uint32_t)(desc[i].buf - buffers[0]) / sizeof(memory[0]);
+  Serial.printf("%5u probek x %u: %2u deskryptorow, %6u B na okrazenie  %s\n", (unsigned)samples, (unsigned)count,
+                (unsigned)n, (unsigned)ring, ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// tekst do porównania zamiast Serial / HTTP
+struct TextOut {
+  char text[2048];
+  size_t used;
+
+  void printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text + used, sizeof(text) - used, format, args);
+    va_end(args);
+    if (n > 0) used += (size_t)n < sizeof(text) - used ? (size_t)n : sizeof(text) - used - 1;
+  }
+};
+
+// zapis i odczyt RLE: długie stany (podział > 65535), szybkie zmiany, koniec pamięci
+bool checkRle() {
+  static uint16_t samples[200000];
+  static RleRun runs[4096];
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < 70000; i++) samples[n++] = 0x01;  // przekaźnik: długi stan
+  for (uint32_t i = 0; i < 1000; i++) samples[n++] = (uint16_t)(i & 3);
+  for (uint32_t i = 0; i < 129000; i++) samples[n++] = (uint16_t)((i / 480) & 1 ? 0x80 : 0x00);  // OneWire
+  RleEncoder rle;
+  rle.begin(runs, 4096);
+  bool ok = rle.pushBlock(samples, 100000, 0, 0xFFFF) == 100000;
+  for (uint32_t i = 100000; i < n; i++) ok &= rle.push(samples[i]);
+  ok &= rle.sampleCount() == n && runs[0].count == 65535 && runs[1].value == 0x01;
+  for (uint32_t i = 0; i < n && ok; i += 7) ok = rle.sampleAt(i) == samples[i];
+  Serial.printf("RLE: %u probek -> %u przebiegow (%u B zamiast %u B)  %s\n", (unsigned)n, (unsigned)rle.runCount(),
+                (unsigned)(rle.runCount() * sizeof(RleRun)), (unsigned)(n * 2), ok ? "OK" : "BLAD");
+
+  // koniec pamięci: 4 przebiegi, piąta zmiana nie wchodzi
+  RleEncoder small;
+  small.begin(runs, 4);
+  const uint16_t pattern[] = {1, 1, 2, 3, 3, 3, 4, 5, 5};
+  ok &= small.pushBlock(pattern, 9, 0, 0xFFFF) == 7 && small.full() && small.sampleCount() == 7;
+  return ok;
+}
+
+// wyzwalanie z historią, bloki z zamienionymi połówkami jak z DMA
+bool checkTrigger() {
+  static RleRun runs[256];
+  LogicTrigger t, bad;
+  bool ok = t.parse("f0,h1") && t.falling == 1 && t.mask == 2 && t.value == 2 && !bad.parse("x1") && !bad.parse("r16");
+  ok &= t.matches(0x03, 0x02) && !t.matches(0x01, 0x00) && !t.matches(0x02, 0x02);
+
+  // D0 opada w próbce 10 (przy D1 = 1), wcześniej taki sam spadek przy D1 = 0
+  uint16_t logical[32], block[32];
+  for (uint32_t i = 0; i < 32; i++) logical[i] = (uint16_t)(i < 10 ? (i == 4 ? 0x00 : 0x03) : 0x02);
+  logical[2] = 0x00;
+  logical[3] = 0x01;
+  for (uint32_t i = 0; i < 32; i++) block[I2sParallel::sampleIndex(i)] = logical[i];
+  LogicCapture c;
+  c.arm(runs, 256, t, 3, 20);
+  c.process(block, 8, 1);
+  ok &= c.getState() == LOGIC_ARMED;
+  c.process(block + 8, 24, 1);  // zaczyna się w środku historii, wyzwolenie w tym bloku
+  // próbki 5..9 przed wyzwoleniem, z tego historia 7, 8, 9
+  const RleEncoder &rle = c.getRle();
+  ok &= c.getTriggerSample() == 3 && rle.sampleCount() == 20 && c.getState() == LOGIC_DONE;
+  for (uint32_t i = 0; i < 20 && ok; i++) ok = rle.sampleAt(i) == logical[7 + i];
+
+  // wyzwolenie w nieparzystej próbce: kolejność połówek dalej dobra
+  LogicCapture d;
+  t.parse("r0");
+  uint16_t edge[8] = {0, 0, 0, 1, 1, 0, 1, 1};
+  uint16_t swapped[8];
+  for (uint32_t i = 0; i < 8; i++) swapped[I2sParallel::sampleIndex(i)] = edge[i];
+  d.arm(runs, 256, t, 0, 0);
+  d.process(swapped, 8, 1);
+  ok &= d.getTriggerSample() == 0 && d.getRle().sampleCount() == 5 && d.getRle().sampleAt(2) == 0 &&
+        d.getRle().sampleAt(3) == 1;
+  Serial.printf("wyzwalanie: f0,h1 w probce 10, historia 3  %s\n", ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// utracony bufor: przed wyzwoleniem historia od nowa, po wyzwoleniu koniec zapisu z adnotacją w VCD
+bool checkOverrun() {
+  static RleRun runs[64];
+  LogicTrigger t;
+  t.parse("r0");
+  uint16_t low[8] = {0}, high[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+  LogicCapture c;
+  c.arm(runs, 64, t, 4, 0);
+  c.process(low, 8, 1);
+  c.overrun();
+  c.process(high, 8, 1);  // zbocze na granicy dziury nie wyzwala, brak poprzedniej próbki
+  bool ok = c.getState() == LOGIC_ARMED;
+  c.process(low, 8, 1);
+  c.process(high, 8, 1);
+  ok &= c.getState() == LOGIC_CAPTURING && c.getTriggerSample() == 4 && c.getRle().sampleCount() == 12;
+  c.overrun();
+  c.process(low, 8, 1);  // po przerwaniu nic już nie dochodzi
+  ok &= c.getState() == LOGIC_DONE && c.isTruncated() && c.getRle().sampleCount() == 12;
+
+  static TextOut out;
+  out.used = 0;
+  VcdWriter::write(out, c.getRle(), 1, 1000000, c.getTriggerSample(), c.isTruncated());
+  ok &= strstr(out.text, "$comment capture truncated by DMA overrun at sample 12 $end\n") != nullptr;
+  c.arm(runs, 64, t, 4, 0);
+  ok &= !c.isTruncated();
+  Serial.printf("przepelnienie: historia od nowa, zapis przerwany po 12 probkach  %s\n", ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// VCD dla znanego przebiegu, 1 MHz -> 1000 ns na próbkę
+bool checkVcd() {
+  RleRun runs[8];
+  RleEncoder rle;
+  rle.begin(runs, 8);
+  const uint16_t pattern[] = {0, 0, 1, 1, 1, 3, 2, 2};
+  rle.pushBlock(pattern, 8, 0, 0xFFFF);
+  static TextOut out;
+  out.used = 0;
+  VcdWriter::write(out, rle, 2, 1000000, 2);
+  const char *expected = "$comment ESP32 LogicCapture, 1000000 Hz, trigger at sample 2 $end\n"
+                         "$timescale 1 ns $end\n$scope module logic $end\n"
+                         "$var wire 1 ! D0 $end\n$var wire 1 \" D1 $end\n"
+                         "$upscope $end\n$enddefinitions $end\n"
+                         "#0\n$dumpvars\n0!\n0\"\n$end\n"
+                         "#2000\n1!\n"
+                         "#5000\n1\"\n"
+                         "#6000\n0!\n"
+                         "#8000\n";
+  bool ok = strcmp(out.text, expected) == 0;
+  // 3 MHz: czas z numeru próbki, bez sumowania zaokrągleń
+  ok &= VcdWriter::sampleNanos(3000000, 3000000) == 1000000000ull && VcdWriter::sampleNanos(1, 3000000) == 333;
+  Serial.printf("VCD: %u B  %s\n", (unsigned)out.used, ok ? "OK" : "BLAD");
+  if (!ok) Serial.printf("%s", out.text);
+  return ok;
+}
+
+// zegar 40 MHz / div: div zaokrąglony do najbliższego (15 MHz -> 3, nie 2),
+// ograniczony do 2..255 (100 kHz -> 255, 30 MHz -> 2)
+bool checkClock() {
+  bool ok = true;
+  ok &= I2sParallel::clockFor(I2sParallel::clockDivider(20000000)) == 20000000;
+  ok &= I2sParallel::clockFor(I2sParallel::clockDivider(12000000)) == 13333333;
+  ok &= I2sParallel::clockDivider(15000000) == 3;
+  ok &= I2sParallel::clockDivider(100000) == 255;
+  ok &= I2sParallel::clockFor(I2sParallel::clockDivider(100000)) == 156862;
+  ok &= I2sParallel::clockDivider(30000000) == 2;
+  ok &= I2sParallel::clockDivider(0) == 255;
+  Serial.printf("zegar: 20 MHz -> %u Hz, 12 MHz -> %u Hz, 100 kHz -> %u Hz  %s\n",
+                (unsigned)I2sParallel::clockFor(I2sParallel::clockDivider(20000000)),
+                (unsigned)I2sParallel::clockFor(I2sParallel::clockDivider(12000000)),
+                (unsigned)I2sParallel::clockFor(I2sParallel::clockDivider(100000)), ok ? "OK" : "BLAD");
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  bool ok = true;
+  ok &= checkChain(16, 2);
+  ok &= checkChain(BUFFER_SAMPLES, BUFFER_COUNT);
+  ok &= checkChain(2046, 3);  // dokładnie DMA_DESC_MAX_BYTES
+  ok &= checkChain(8192, 4);
+  DmaDescriptor desc[4];
+  uint8_t oddMemory[8];
+  uint8_t *odd[1] = {oddMemory};
+  ok &= DmaChain::build(desc, 4, odd, 1, 6) == 0;  // nie wielokrotność 4
+
+  // 3 bufory: kolejność EOF 0 1 2 0 2 (pominięty 1) 0, wypełnianie raz za długie
+  DmaRingTracker tracker;
+  tracker.begin(3, 1024);
+  const uint32_t order[] = {0, 1, 2, 0, 2, 0};
+  const uint32_t fillCycles[] = {100, 120, 900, 110, 100, 105};
+  for (uint32_t i = 0; i < 6; i++) {
+    tracker.onEof(order[i]);
+    tracker.onFilled(fillCycles[i], 500);
+  }
+  I2sParallelStats s = tracker.getStats();
+  s.elapsedUs = 1000;
+  s.print(Serial, "symulacja");
+  ok &= s.buffers == 7 && s.missed == 1 && s.underruns == 1 && s.maxFillCycles == 900;
+
+  // ciągłość piły przez granicę buforów
+  uint16_t a[8], b[8];
+  ramp.next = 0;
+  fillRamp(a, 8, &ramp);
+  fillRamp(b, 8, &ramp);
+  ok &= a[I2sParallel::sampleIndex(7)] == 7 && b[I2sParallel::sampleIndex(0)] == 8;
+
+  ok &= checkClock();
+  ok &= checkRle();
+  ok &= checkTrigger();
+  ok &= checkOverrun();
+  ok &= checkVcd();
+  Serial.printf("%s\n", ok ? "wszystko OK" : "BLAD");
+}
+
+void loop() {
+  delay(10);
+}
+#endif
+
+#ifndef ARDUINO
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -20,7 +20,7 @@ void setup() {
 }
 
 void loop() {
-  Timer1.update();
+  TimerService::instance().poll(); // obsługuje wszystkie SoftTimer-y
   if (ticks > 20) {
     Serial.println("Timer1 stop");
     Timer1.stop();
@@ -1,8 +1,26 @@
-#include <Arduino.h>
+#include "../../myLib/Platform.h"
 #include "../../myLib/SoftTimer.h"
 #include "../../myLib/GetTimeDiv.h"
-#include "../../myLib/MovingAverage.h"
+#include "../../myLib/FixedFilter.h"
+#include "../../myLib/RunningMedian.h"
+#include "../../myLib/HotPath.h"
+#include "../../myLib/AdcStream.h"
+#include "../../myLib/AdcCalibration.h"
+#ifdef ARDUINO
 #include "driver/adc.h"
+#endif
+
+// 1 = ciągłe próbkowanie kilku kanałów przez DMA (myLib/AdcStream.h),
+// 0 = analogRead() z GPIO 32 co 100 ms w callbacku timera
+#ifndef ADC_CONTINUOUS
+#define ADC_CONTINUOUS ADC_STREAM_SUPPORTED
+#endif
+
+// tablice raw -> mV (myLib/AdcCalibration.h): 0 = pełne 4096 wartości,
+// jeden odczyt na próbkę; 6 = węzły co 64 kody, 130 B na tłumienność
+#ifndef ADC_CAL_SHIFT
+#define ADC_CAL_SHIFT 0
+#endif
 
 // piny analog (ADC2 używany jest do WiFi)
 // GPIO 4 - ADC2 CH 0
@@ -22,6 +40,7 @@
 // GPIO 39 - ADC1 CH 3
 // GPIO 36 - ADC1 CH 0
 
+#ifdef ARDUINO
 void adcSetup()
 {
   // 9 - 12 (bits)
@@ -36,7 +55,7 @@ void adcSetup()
   // ADC_11db - 150 mV ~ 2450 mV
   analogSetAttenuation(ADC_11db);
 
-  // void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation);
+  // tłumienność pinu: adcCal.setPinAttenuation() (analogSetPinAttenuation() + wybór tablicy mV)
   // bool adcAttachPin(uint8_t pin);
   // void analogSetWidth(uint8_t bits);
   // void analogSetVRefPin(uint8_t pin);
@@ -48,34 +67,412 @@ void adcSetup()
 
 // This function is used to get ADC value for a given pin/ADC channel in millivolts.
 // uint32_t analogReadMilliVolts(uint8_t pin);
+// (liczy kalibrację z eFuse przy każdym wywołaniu, tu zamiast niej adcCal.toMilliVolts())
 
+AdcCalibration adcCal;
 GetTimeDiv tDiv;
-MovingAverage<double> mAVR(32);
+// int32_t na płytkach bez FPU (ESP32-C3/S2), float na pozostałych
+BoardAverage<32> mAVR;
+// pojedyncze szpilki zastępowane medianą 5 próbek, zanim trafią do średniej
+HampelFilter<int32_t, 5> adcSpikes(3.0f, 20);
+
+#if ADC_CONTINUOUS
+// ---------------------------------------------------------------
+// 4 kanały ADC1 po 10 kS/s, ramka 400 próbek (100 skanów) co 10 ms.
+// Task konsumenta dostaje ramki bez kopiowania, kanał GPIO 32 idzie
+// po przeliczeniu na mV przez te same filtry co w wersji z analogRead(),
+// wszystkie kanały do średnich. Każdy pin ma swoją tłumienność (STREAM_ATTEN)
+// i swoją tablicę mV. Timer co 100 ms wypisuje średnie w mV, wyjście
+// filtrów i koszt CPU na próbkę w ns, co sekundę statystyki strat:
+// linia "ADCSTREAM,S/s,ramki,odrzucone,przepelnienia,max w kolejce,ns".
+// Dla porównania analogRead() to kilkanaście us na próbkę z blokowaniem
+// (kolumna ns w wersji ADC_CONTINUOUS=0).
+// ---------------------------------------------------------------
+#define STREAM_HZ 40000
+#define STREAM_FRAME_SAMPLES 400
+#define STREAM_CHANNELS 4
+const int8_t STREAM_PINS[STREAM_CHANNELS] = {32, 33, 34, 35};
+const uint8_t STREAM_ATTEN[STREAM_CHANNELS] = {ADC_11db, ADC_11db, ADC_6db, ADC_0db};
+
+AdcStream adcStream;
+
+// średnie z ostatnich 100 ms, zapisuje task konsumenta
+struct AdcSnapshot
+{
+  uint16_t mean[STREAM_CHANNELS];  // mV
+  uint32_t samples;
+  uint32_t cycles;  // czas konsumenta na te próbki
+  uint32_t gaps;    // ramki brakujące w numeracji
+};
+
+portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+AdcSnapshot snapshot;
+uint32_t statsCount = 0;
+
+void adcConsumerTask(void *)
+{
+  AdcChannelAccumulator window;
+  uint32_t windowCycles = 0, windowGaps = 0, expected = 0;
+  uint32_t windowStart = millis();
+  uint8_t channel0 = adcStream.channelOf(0);
+  const AdcCalTable &mv0 = adcCal.tableFor(STREAM_PINS[0]);
+  while (1)
+  {
+    AdcFrame *f = adcStream.receive(100);
+    if (f)
+    {
+      uint32_t start = GetTimeDiv::cycles();
+      windowGaps += f->sequence - expected;
+      expected = f->sequence + 1;
+      window.add(*f);
+      uint32_t n = f->count();
+      for (uint32_t i = 0; i < n; i++)
+      {
+        AdcSample s = f->at(i);
+        if (s.channel == channel0) mAVR.update(adcSpikes.update(mv0.toMilliVolts(s.value)));
+      }
+      adcStream.release(f);
+      windowCycles += GetTimeDiv::cycles() - start;
+    }
+    if (millis() - windowStart >= 100)
+    {
+      windowStart = millis();
+      AdcSnapshot s;
+      for (uint32_t c = 0; c < STREAM_CHANNELS; c++)
+        s.mean[c] = adcCal.toMilliVolts(STREAM_PINS[c], window.mean(adcStream.channelOf(c)));
+      s.samples = 0;
+      for (uint32_t c = 0; c < STREAM_CHANNELS; c++) s.samples += window.count(adcStream.channelOf(c));
+      s.cycles = windowCycles;
+      s.gaps = windowGaps;
+      portENTER_CRITICAL(&snapshotMux);
+      snapshot = s;
+      portEXIT_CRITICAL(&snapshotMux);
+      window.reset();
+      windowCycles = windowGaps = 0;
+    }
+  }
+}
+
+void onTimerAdcPrint()
+{
+  portENTER_CRITICAL(&snapshotMux);
+  AdcSnapshot s = snapshot;
+  portEXIT_CRITICAL(&snapshotMux);
+  uint32_t nsPerSample = s.samples ? GetTimeDiv::cyclesToNanos(s.cycles) / s.samples : 0;
+  Serial.printf("%u %u %u %u %d %u %u\n", s.mean[0], s.mean[1], s.mean[2], s.mean[3], (int)mAVR.get(),
+                (unsigned)nsPerSample, (unsigned)s.gaps);
+  if (++statsCount % 10 == 0)
+  {
+    AdcStreamStats st = adcStream.takeStats();
+    st.print(Serial, "adc");
+    Serial.printf("ADCSTREAM,%u,%u,%u,%u,%u,%u\n", (unsigned)st.samplesPerSecond(), (unsigned)st.frames,
+                  (unsigned)st.dropped, (unsigned)st.overflows, (unsigned)st.maxReady, (unsigned)nsPerSample);
+  }
+}
+
+SoftTimer TimerADC(100, onTimerAdcPrint, false, TIMER_FIXED_RATE);
 
+void setup()
+{
+  Serial.begin(115200);
+  delay(500);
+  AdcStreamConfig cfg = {};
+  memcpy(cfg.pins, STREAM_PINS, sizeof(STREAM_PINS));
+  cfg.channels = STREAM_CHANNELS;
+  cfg.sampleHz = STREAM_HZ;
+  cfg.frameSamples = STREAM_FRAME_SAMPLES;
+  // piny należą do sterownika DMA, tłumienność tylko do tablic i konfiguracji strumienia
+  for (uint32_t c = 0; c < STREAM_CHANNELS; c++)
+  {
+    adcCal.setPinAttenuation(STREAM_PINS[c], STREAM_ATTEN[c], false);
+    cfg.atten[c] = adcCal.attenuationOf(STREAM_PINS[c]);
+  }
+  uint32_t t0 = micros();
+  if (!adcCal.begin(ADC_CAL_SHIFT))
+  {
+    Serial.println("AdcCalibration: blad inicjalizacji");
+    return;
+  }
+  Serial.printf("AdcCalibration: %u B tablic, %u us\n", (unsigned)adcCal.bytes(), (unsigned)(micros() - t0));
+  if (!adcStream.begin(cfg))
+  {
+    Serial.println("AdcStream: blad inicjalizacji");
+    return;
+  }
+  // bez przypisania do rdzenia, jak task czytający AdcStream (S2/C3 mają jeden rdzeń)
+  if (xTaskCreatePinnedToCore(adcConsumerTask, "adcConsumer", 4096, nullptr, 5, nullptr, tskNO_AFFINITY) != pdPASS)
+  {
+    Serial.println("adcConsumer: blad tworzenia taska");
+    return;
+  }
+  TimerADC.start();
+}
+
+#else
+// we flash: analogRead() i Serial i tak są we flash, w IRAM (-DHOTPATH_IRAM=1)
+// są tylko wywoływane tu update() filtrów
 void onTimerAdcRead()
 {
-  tDiv.start();
-  uint32_t adc_mV = analogReadMilliVolts(GPIO_NUM_32);
-  mAVR.update(adc_mV);
-  tDiv.end();
+  tDiv.startCycles(); // millis() dawało tu zawsze 0
+  uint32_t adc_mV = adcCal.toMilliVolts(GPIO_NUM_32, analogRead(GPIO_NUM_32));
+  mAVR.update(adcSpikes.update(adc_mV));
+  tDiv.endCycles();
   Serial.print(adc_mV);
   Serial.print(" ");
   Serial.print(mAVR.get());
   Serial.print(" ");
-  Serial.println(tDiv.getLastDiv());
+  Serial.println(tDiv.getLastDivNanos()); // ns
 }
 
-SoftTimer TimerADC(100, onTimerAdcRead, false);
+// stała faza 100 ms, okres nie dryfuje przy spóźnionej obsłudze loop()
+SoftTimer TimerADC(100, onTimerAdcRead, false, TIMER_FIXED_RATE);
 
 void setup()
 {
   Serial.begin(115200);
   delay(500);
   adcSetup();
+  adcCal.setPinAttenuation(GPIO_NUM_32, ADC_11db);
+  if (!adcCal.begin(ADC_CAL_SHIFT))
+  {
+    Serial.println("AdcCalibration: blad inicjalizacji");
+    return;
+  }
   TimerADC.start();
 }
 
+#endif
+
 void loop()
 {
-  TimerADC.update();
+  TimerService::instance().poll();
+}
+#endif
+
+#ifndef ARDUINO
+// ---------------------------------------------------------------
+// Na PC ([env:native]): dekodowanie próbek DMA, obieg ramek w puli
+// z liczeniem odrzuconych, ten sam obieg na dwóch wątkach (producent
+// szybszy niż konsument), średnie na kanał i błąd tablic mV względem
+// wzoru kalibracji dla wszystkich 4096 kodów i 4 tłumienności.
+// ---------------------------------------------------------------
+#include <thread>
+
+#define TEST_FRAME_BYTES 64
+
+uint8_t frameMemory[ADC_STREAM_FRAMES * TEST_FRAME_BYTES];
+
+bool checkDecode()
+{
+  const uint8_t type1[] = {0x34, 0x62};              // kanał 6, 0x234
+  const uint8_t type2[] = {0xFF, 0x8F, 0x01, 0x00};  // ADC2, kanał 4, 0xFFF
+  const uint8_t typeS2[] = {0x34, 0xB2};             // ADC2, kanał 6, 0x234 (11 bit)
+  const uint8_t typeS3[] = {0xFF, 0x2F, 0x03, 0x00};  // ADC2, kanał 9, 0xFFF
+  AdcSample a = AdcFrame::decode(type1, ADC_SAMPLE_TYPE1);
+  AdcSample b = AdcFrame::decode(type2, ADC_SAMPLE_TYPE2);
+  AdcSample c = AdcFrame::decode(typeS2, ADC_SAMPLE_TYPE2_S2);
+  AdcSample d = AdcFrame::decode(typeS3, ADC_SAMPLE_TYPE2_S3);
+  bool ok = a.value == 0x234 && a.channel == 6 && a.unit == 0 && b.value == 0xFFF && b.channel == 4 && b.unit == 1;
+  ok &= c.value == 0x468 && c.channel == 6 && c.unit == 1 && d.value == 0xFFF && d.channel == 9 && d.unit == 1;
+  ok &= AdcFrame::sampleBytes(ADC_SAMPLE_TYPE2_S2) == 2 && AdcFrame::sampleBytes(ADC_SAMPLE_TYPE2_S3) == 4;
+  Serial.printf("dekodowanie TYPE1 / TYPE2 / S2 / S3  %s\n", ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// jeden wątek: konsument trzyma ramkę, producent wypełnia resztę puli i zaczyna odrzucać
+bool checkPool()
+{
+  AdcFramePool pool;
+  pool.begin(frameMemory, TEST_FRAME_BYTES, ADC_SAMPLE_TYPE1);
+  uint32_t published = 0, dropped = 0;
+  for (uint32_t i = 0; i < ADC_STREAM_FRAMES + 2; i++)
+  {
+    AdcFrame *f = pool.acquire();
+    if (!f)
+    {
+      dropped++;
+      continue;
+    }
+    f->sequence = i;
+    f->bytes = TEST_FRAME_BYTES;
+    pool.publish(f);
+    published++;
+  }
+  AdcFrame *f = pool.take();
+  bool ok = published == ADC_STREAM_FRAMES && dropped == 2 && f && f->sequence == 0 && f->data == frameMemory;
+  ok &= pool.readyCount() == ADC_STREAM_FRAMES - 1 && !pool.acquire();
+  pool.release(f);
+  AdcFrame *g = pool.acquire();
+  ok &= g == f;  // ta sama pamięć wraca do producenta
+  Serial.printf("pula: %u opublikowanych, %u odrzuconych  %s\n", (unsigned)published, (unsigned)dropped,
+                ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// dwa wątki: każda ramka wypełniona swoim numerem, konsument sprawdza treść i przeskoki numeracji
+bool checkThreads()
+{
+  const uint32_t FRAMES = 200000;
+  AdcFramePool pool;
+  pool.begin(frameMemory, TEST_FRAME_BYTES, ADC_SAMPLE_TYPE1);
+  uint32_t dropped = 0;
+  volatile bool done = false;
+  std::thread producer([&]() {
+    for (uint32_t seq = 0; seq < FRAMES; seq++)
+    {
+      AdcFrame *f = pool.acquire();
+      if (!f)
+      {
+        dropped++;
+        std::this_thread::yield();
+        continue;
+      }
+      memset(f->data, (uint8_t)seq, TEST_FRAME_BYTES);
+      f->sequence = seq;
+      f->bytes = TEST_FRAME_BYTES;
+      pool.publish(f);
+      std::this_thread::yield();  // następna ramka DMA jeszcze niegotowa
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+  });
+
+  uint32_t received = 0, gaps = 0, corrupt = 0, expected = 0;
+  while (true)
+  {
+    AdcFrame *f = pool.take();
+    if (!f)
+    {
+      if (__atomic_load_n(&done, __ATOMIC_ACQUIRE) && !pool.readyCount()) break;
+      std::this_thread::yield();
+      continue;
+    }
+    for (uint32_t i = 0; i < TEST_FRAME_BYTES; i++) corrupt += f->data[i] != (uint8_t)f->sequence;
+    gaps += f->sequence - expected;
+    expected = f->sequence + 1;
+    received++;
+    if (received % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));  // konsument czasem nie nadąża
+    pool.release(f);
+  }
+  producer.join();
+  gaps += FRAMES - expected;
+  bool ok = !corrupt && received + dropped == FRAMES && gaps == dropped;
+  Serial.printf("watki: %u ramek, odebrane %u, odrzucone %u, przeskoki %u, uszkodzone bajty %u  %s\n",
+                (unsigned)FRAMES, (unsigned)received, (unsigned)dropped, (unsigned)gaps, (unsigned)corrupt,
+                ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// 4 kanały na zmianę (jak skan ADC1 CH4..CH7), stałe wartości + szum +-2
+bool checkAccumulator()
+{
+  static uint8_t data[4000 * 2];
+  const uint16_t level[4] = {100, 1000, 2048, 4000};
+  for (uint32_t i = 0; i < 4000; i++)
+  {
+    uint16_t v = (uint16_t)(((4 + i % 4) << 12) | (level[i % 4] + (i / 4) % 5 - 2));
+    data[2 * i] = (uint8_t)v;
+    data[2 * i + 1] = (uint8_t)(v >> 8);
+  }
+  AdcFrame f = {data, sizeof(data), 0, 0, 0, ADC_SAMPLE_TYPE1};
+  AdcChannelAccumulator acc;
+  uint32_t t0 = micros();
+  for (uint32_t r = 0; r < 1000; r++) acc.add(f);
+  uint32_t us = micros() - t0;
+  bool ok = true;
+  for (uint32_t c = 0; c < 4; c++)
+    ok &= acc.mean(4 + c) == level[c] && acc.count(4 + c) == 1000000 && acc.minimum(4 + c) == level[c] - 2 &&
+          acc.maximum(4 + c) == level[c] + 2;
+  Serial.printf("srednie kanalow %u %u %u %u, %.2f ns na probke  %s\n", acc.mean(4), acc.mean(5), acc.mean(6),
+                acc.mean(7), us * 1000.0 / 4000000, ok ? "OK" : "BLAD");
+  return ok;
+}
+
+// wzorzec: wzór liniowy ESP32 (Vref 1114 mV) i dla 11 dB zgięcie powyżej
+// kodu 2880, w przybliżeniu jak korekta nieliniowości w kalibracji IDF
+int32_t referenceMilliVolts(uint16_t raw, uint8_t atten, void *)
+{
+  int32_t mv = AdcCalibration::lineFitting(raw, atten, 1114);
+  if (atten == 3 && raw > 2880) mv -= ((int32_t)(raw - 2880) * (raw - 2880) + 4000) / 8000;
+  return mv;
+}
+
+// największy błąd tablic względem wzoru, -1 gdy tablica nie powstała
+int32_t calibrationError(uint8_t shift, uint8_t atten, uint32_t &bytes)
+{
+  AdcCalibration cal;
+  cal.setPinAttenuation(32, atten);
+  if (!cal.begin(referenceMilliVolts, nullptr, shift)) return -1;
+  bytes = cal.table(atten).bytes();
+  int32_t worst = 0;
+  for (uint32_t raw = 0; raw < ADC_CAL_CODES; raw++)
+  {
+    int32_t e = (int32_t)cal.toMilliVolts(32, raw) - referenceMilliVolts(raw, atten, nullptr);
+    if (e < 0) e = -e;
+    if (e > worst) worst = e;
+  }
+  return worst;
+}
+
+bool checkCalibration()
+{
+  const uint8_t SHIFTS[] = {0, 4, 6, 8};
+  const int32_t LIMIT[] = {0, 2, 2, 3};  // mV, węzły i wzór zaokrąglone do 1 mV
+  bool ok = true;
+  for (uint32_t i = 0; i < sizeof(SHIFTS); i++)
+  {
+    uint32_t bytes = 0;
+    int32_t err[ADC_CAL_ATTENS];
+    for (uint8_t a = 0; a < ADC_CAL_ATTENS; a++)
+    {
+      err[a] = calibrationError(SHIFTS[i], a, bytes);
+      ok &= err[a] >= 0 && err[a] <= LIMIT[i];
+    }
+    Serial.printf("tablica mV co %u kod(y), %u B: blad max %d %d %d %d mV\n", 1u << SHIFTS[i], (unsigned)bytes,
+                  (int)err[0], (int)err[1], (int)err[2], (int)err[3]);
+  }
+
+  // pin bez setPinAttenuation() dostaje 11 dB, jak w Arduino - ta tabela powstaje zawsze
+  AdcCalibration cal;
+  cal.setPinAttenuation(34, 0);
+  cal.setPinAttenuation(35, 2);
+  ok &= cal.begin(referenceMilliVolts, nullptr) && cal.bytes() == 3 * ADC_CAL_CODES * sizeof(uint16_t);
+  ok &= cal.attenuationOf(32) == 3 && cal.table(3).ready() && cal.table(0).ready() && cal.table(2).ready();
+  ok &= cal.toMilliVolts(35, 2000) == referenceMilliVolts(2000, 2, nullptr);
+  ok &= cal.toMilliVolts(32, 3000) == referenceMilliVolts(3000, 3, nullptr);
+  ok &= !cal.table(1).ready() && cal.table(1).toMilliVolts(2000) == 0;  // niezbudowana: 0 zamiast odczytu spod nullptr
+
+  // koszt przeliczenia: tablica kontra wzór (na ESP32 adc_cali_raw_to_voltage() jest dużo droższe)
+  const uint32_t N = 10000000;
+  volatile uint32_t sink = 0;
+  uint32_t t0 = micros();
+  for (uint32_t i = 0; i < N; i++) sink = sink + cal.toMilliVolts(35, i & 0x0FFF);
+  uint32_t usLut = micros() - t0;
+  t0 = micros();
+  for (uint32_t i = 0; i < N; i++) sink = sink + referenceMilliVolts(i & 0x0FFF, 3, nullptr);
+  uint32_t usRef = micros() - t0;
+  Serial.printf("przeliczenie: tablica %.2f ns, wzor %.2f ns  %s\n", usLut * 1000.0 / N, usRef * 1000.0 / N,
+                ok ? "OK" : "BLAD");
+  return ok;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  bool ok = checkDecode();
+  ok &= checkPool();
+  ok &= checkThreads();
+  ok &= checkAccumulator();
+  ok &= checkCalibration();
+  Serial.printf("%s\n", ok ? "wszystko OK" : "BLAD");
+}
+
+void loop()
+{
+}
+
+int main()
+{
+  setup();
+  return 0;
 }
+#endif
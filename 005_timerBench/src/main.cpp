@@ -0,0 +1,389 @@
+#include "../../myLib/Platform.h"
+#include "../../myLib/SoftTimer.h"
+#include "../../myLib/HwSoftTimer.h"
+#include "../../myLib/GetTimeDiv.h"
+#include <algorithm>
+
+// ---------------------------------------------------------------
+// Porównanie kosztu obsługi timerów w loop():
+// - stary SoftTimer, każdy obiekt ma własne update() w pętli
+// - TimerService, jedno poll() na całe koło czasowe
+// Czas jest symulowany (BenchClock), mierzymy tylko koszt CPU pętli.
+// ---------------------------------------------------------------
+
+#define SIM_MS 10000      // symulowany czas pracy
+#define LOOPS_PER_MS 20   // ile razy loop() obraca się w ciągu 1 ms
+
+struct BenchClock {
+  static const uint32_t TICKS_PER_MS = 1;
+  static uint32_t t;
+  static uint32_t now() {
+    return t;
+  }
+  static uint32_t subTickUs() {
+    return 0;
+  }
+};
+uint32_t BenchClock::t = 0;
+
+volatile uint32_t fired = 0;
+void onBenchTimer() {
+  fired++;
+}
+
+// kopia poprzedniej implementacji SoftTimer jako punkt odniesienia
+class LegacySoftTimer {
+private:
+  typedef void (*CallbackFunction)();
+  CallbackFunction callback;
+  uint32_t interval;
+  volatile uint32_t prevTime;
+  volatile uint32_t nowTime;
+  bool f_start;
+
+public:
+  LegacySoftTimer(uint32_t timeInterval, CallbackFunction cb, bool OnOff) {
+    f_start = false;
+    callback = cb;
+    interval = timeInterval;
+    if (OnOff) start();
+  }
+
+  void start() {
+    prevTime = BenchClock::now();
+    f_start = true;
+  }
+
+  void update() {
+    if (f_start) {
+      nowTime = BenchClock::now();
+      if ((prevTime + interval) <= nowTime) {
+        callback();
+        prevTime = nowTime;
+      }
+    }
+  }
+};
+
+uint32_t benchInterval(uint32_t i) {
+  return 10 + (i * 37) % 990;
+}
+
+uint32_t runLegacy(uint32_t n, uint32_t &callbacks) {
+  LegacySoftTimer **timers = new LegacySoftTimer *[n];
+  BenchClock::t = 0;
+  for (uint32_t i = 0; i < n; i++) timers[i] = new LegacySoftTimer(benchInterval(i), onBenchTimer, true);
+
+  fired = 0;
+  uint32_t start = micros();
+  for (uint32_t ms = 0; ms < SIM_MS; ms++) {
+    BenchClock::t++;
+    for (uint32_t l = 0; l < LOOPS_PER_MS; l++)
+      for (uint32_t i = 0; i < n; i++) timers[i]->update();
+  }
+  uint32_t duration = micros() - start;
+  callbacks = fired;
+
+  for (uint32_t i = 0; i < n; i++) delete timers[i];
+  delete[] timers;
+  return duration;
+}
+
+uint32_t runService(uint32_t n, uint32_t &callbacks) {
+  typedef BasicTimerService<BenchClock> BenchService;
+  typedef BasicSoftTimer<BenchService> BenchTimer;
+
+  BenchService *service = new BenchService();
+  BenchTimer **timers = new BenchTimer *[n];
+  BenchClock::t = 0;
+  for (uint32_t i = 0; i < n; i++) timers[i] = new BenchTimer(*service, benchInterval(i), onBenchTimer, true);
+
+  fired = 0;
+  uint32_t start = micros();
+  for (uint32_t ms = 0; ms < SIM_MS; ms++) {
+    BenchClock::t++;
+    for (uint32_t l = 0; l < LOOPS_PER_MS; l++) service->poll();
+  }
+  uint32_t duration = micros() - start;
+  callbacks = fired;
+
+  for (uint32_t i = 0; i < n; i++) delete timers[i];
+  delete[] timers;
+  delete service;
+  return duration;
+}
+
+// ---------------------------------------------------------------
+// Dryf okresu 100 ms: 1 h symulacji przechodzącej przez przekręcenie
+// się licznika, loop() co 7 ms i co 10 s przestój 250 ms (np. handleClient)
+// ---------------------------------------------------------------
+#define DRIFT_SIM_MS 3600000UL
+
+volatile uint32_t firedDelay = 0;
+volatile uint32_t firedRate = 0;
+void onDelayTimer() {
+  firedDelay++;
+}
+void onRateTimer() {
+  firedRate++;
+}
+
+void runDrift() {
+  typedef BasicTimerService<BenchClock> BenchService;
+  typedef BasicSoftTimer<BenchService> BenchTimer;
+
+  BenchService *service = new BenchService();
+  BenchClock::t = 0xFFFFFFFFu - DRIFT_SIM_MS / 2;
+  BenchTimer *delayTimer = new BenchTimer(*service, 100, onDelayTimer, true, TIMER_FIXED_DELAY);
+  BenchTimer *rateTimer = new BenchTimer(*service, 100, onRateTimer, true, TIMER_FIXED_RATE);
+
+  firedDelay = 0;
+  firedRate = 0;
+  for (uint32_t ms = 0; ms < DRIFT_SIM_MS;) {
+    uint32_t step = (ms % 10000) < 7 ? 250 : 7;
+    BenchClock::t += step;
+    ms += step;
+    service->poll();
+  }
+
+  Serial.printf("dryf 1 h, okres 100 ms, oczekiwane %lu wywolan\n", DRIFT_SIM_MS / 100);
+  Serial.printf("fixed-delay: %u wywolan\n", (unsigned)firedDelay);
+  Serial.printf("fixed-rate : %u wywolan + %u pominietych\n", (unsigned)firedRate,
+                (unsigned)rateTimer->getMissedTicks());
+
+  delete delayTimer;
+  delete rateTimer;
+  delete service;
+}
+
+// ---------------------------------------------------------------
+// HwSoftTimer: callback 10 ms przy loop() zajętym po 50 ms naraz.
+// Na PC przerwanie i task dispatchera są symulowane na MockClock.
+// ---------------------------------------------------------------
+char hwLog[64];
+uint32_t hwLogLen = 0;
+void hwLogEvent(char c) {
+  if (hwLogLen < sizeof(hwLog) - 1) hwLog[hwLogLen++] = c;
+  hwLog[hwLogLen] = 0;
+}
+void onHwTimerA() {
+  hwLogEvent('A');
+}
+void onHwTimerB() {
+  hwLogEvent('B');
+}
+void onHwTimerC() {
+  hwLogEvent('C');
+}
+
+#ifdef ARDUINO
+void runHwDispatch() {
+  HwTimerDispatcher &dispatcher = HwTimerDispatcher::instance();
+  if (!dispatcher.begin()) {
+    Serial.println("BLAD: HwTimerDispatcher::begin()");
+    return;
+  }
+  HwSoftTimer hwTimer(10, onHwTimerA, true, TIMER_FIXED_RATE);
+
+  uint32_t start = millis();
+  while (millis() - start < 2000) {
+    uint32_t busy = millis();
+    while (millis() - busy < 50) {  // loop() zajęty np. przez handleClient()
+    }
+  }
+  hwTimer.stop();
+
+  HwTimerStats st = dispatcher.getStats();
+  Serial.printf("hw dispatch: %u callbackow (oczekiwane 200), utracone %u, opoznienie max %u us\n",
+                (unsigned)st.dispatched, (unsigned)st.dropped, (unsigned)st.maxLatency);
+#if SOFTTIMER_STATS
+  hwTimer.getLateness().print(Serial, "hw dispatch lateness");
+#endif
+}
+#else
+void runHwDispatch() {
+  typedef BasicHwTimerDispatcher<MockClock> MockDispatcher;
+  typedef BasicSoftTimer<MockDispatcher> MockHwTimer;
+
+  MockDispatcher *dispatcher = new MockDispatcher();
+  MockClock::set(0);
+  MockHwTimer *a = new MockHwTimer(*dispatcher, 2, onHwTimerA, true, TIMER_FIXED_RATE);
+  MockHwTimer *b = new MockHwTimer(*dispatcher, 3, onHwTimerB, true, TIMER_FIXED_RATE);
+  MockHwTimer *c = new MockHwTimer(*dispatcher, 5, onHwTimerC, true, TIMER_FIXED_RATE);
+
+  // przerwanie co 1000 us, task dispatchera rusza 150 us po przerwaniu
+  hwLogLen = 0;
+  for (uint32_t tick = 1; tick <= 12; tick++) {
+    MockClock::set(tick * 1000);
+    dispatcher->isrTick();
+    MockClock::set(tick * 1000 + 150);
+    dispatcher->dispatchPending();
+  }
+
+  HwTimerStats st = dispatcher->getStats();
+  bool ok = strcmp(hwLog, "ABACBAABACBA") == 0 && st.dispatched == 12 && st.maxLatency == 150;
+  Serial.printf("hw dispatch (MockClock): kolejnosc %s\n", hwLog);
+  Serial.printf("hw dispatch (MockClock): %u callbackow, opoznienie max %u us  %s\n", (unsigned)st.dispatched,
+                (unsigned)st.maxLatency, ok ? "OK" : "BLAD");
+
+  // A w kolejce, stop()/start() przed dispatchem: stare wygaśnięcie odrzucone
+  hwLogLen = 0;
+  MockClock::set(14000);
+  dispatcher->isrTick();
+  a->stop();
+  a->start();
+  bool stale = dispatcher->dispatchPending() == 0;
+  // B i C w kolejce, B zniszczony przed dispatchem: wykonany tylko C
+  MockClock::set(15000);
+  dispatcher->isrTick();
+  delete b;
+  b = nullptr;
+  stale &= dispatcher->dispatchPending() == 1;
+  // A według nowego harmonogramu: start() w 14000 + 2 ms
+  MockClock::set(16000);
+  dispatcher->isrTick();
+  stale &= dispatcher->dispatchPending() == 1 && strcmp(hwLog, "CA") == 0;
+  Serial.printf("hw dispatch (MockClock): stop/start i usuniecie timera w kolejce: %s  %s\n", hwLog,
+                stale ? "OK" : "BLAD");
+#if SOFTTIMER_STATS
+  a->getLateness().print(Serial, "hw dispatch (MockClock) A");
+  char json[160];
+  c->getLateness().toJson(json, sizeof(json));
+  Serial.printf("hw dispatch (MockClock) C: %s\n", json);
+#endif
+
+  delete a;
+  delete b;
+  delete c;
+  delete dispatcher;
+}
+#endif
+
+// ---------------------------------------------------------------
+// Koszt wywołania: goły wskaźnik na funkcję kontra TimerCallback
+// ---------------------------------------------------------------
+#define CALL_COUNT 1000000
+
+struct CallContext {
+  volatile uint32_t counter;
+};
+CallContext callContext;
+
+void plainTarget() {
+  callContext.counter++;
+}
+void contextTarget(void *ctx) {
+  ((CallContext *)ctx)->counter++;
+}
+
+void (*rawCallbacks[1])();
+TimerCallback timerCallbacks[3];
+volatile uint32_t callIndex = 0;
+
+void printCallResult(const char *name, uint32_t duration) {
+  Serial.printf("%-22s %6.2f ns/wywolanie\n", name, duration * 1000.0 / CALL_COUNT);
+}
+
+void runCallCost() {
+  CallContext *ctx = &callContext;
+  rawCallbacks[0] = plainTarget;
+  timerCallbacks[0] = TimerCallback(plainTarget);
+  timerCallbacks[1] = TimerCallback(contextTarget, ctx);
+  timerCallbacks[2] = TimerCallback([ctx]() { ctx->counter++; });
+
+  void (*raw)() = rawCallbacks[callIndex];
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < CALL_COUNT; i++) raw();
+  printCallResult("void(*)()", micros() - start);
+
+  const char *names[] = {"TimerCallback(fn)", "TimerCallback(fn, ctx)", "TimerCallback(lambda)"};
+  for (uint32_t k = 0; k < 3; k++) {
+    const TimerCallback &cb = timerCallbacks[callIndex + k];
+    start = micros();
+    for (uint32_t i = 0; i < CALL_COUNT; i++) cb();
+    printCallResult(names[k], micros() - start);
+  }
+  Serial.printf("sizeof(TimerCallback) = %u B\n", (unsigned)sizeof(TimerCallback));
+}
+
+// ---------------------------------------------------------------
+// LatencyHistogram: percentyle z histogramu kontra dokładne z sortowania,
+// czasy z długim ogonem (1 na 100 żądań wolne jak przy zapisie EEPROM),
+// histogram składany z dwóch połówek przez merge()
+// ---------------------------------------------------------------
+#define LATENCY_SAMPLES 20000
+
+uint32_t latencySamples[LATENCY_SAMPLES];
+LatencyHistogram latencyHalf[2];
+
+void runLatency() {
+  uint32_t seed = 12345;
+  for (uint32_t i = 0; i < LATENCY_SAMPLES; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t v = 20000 + (seed >> 16);                 // 20..85 us
+    if ((seed & 0xFF) < 3) v = 2000000 + (seed >> 8);  // ~1 %: 2..18 ms
+    latencySamples[i] = v;
+    latencyHalf[i & 1].record(v);
+  }
+  LatencyHistogram merged;
+  merged.merge(latencyHalf[0]);
+  merged.merge(latencyHalf[1]);
+  std::sort(latencySamples, latencySamples + LATENCY_SAMPLES);
+
+  const uint32_t perMille[] = {500, 900, 990, 999};
+  const char *names[] = {"p50", "p90", "p99", "p99.9"};
+  for (uint32_t k = 0; k < 4; k++) {
+    uint32_t exact = latencySamples[(LATENCY_SAMPLES * perMille[k] + 999) / 1000 - 1];
+    uint32_t approx = merged.getPercentile(perMille[k]);
+    Serial.printf("%-6s dokladnie %8u  histogram %8u  blad %+.2f %%\n", names[k], (unsigned)exact, (unsigned)approx,
+                  ((double)approx - exact) * 100.0 / exact);
+  }
+  merged.summary().print(Serial, "latency");
+
+  // koszt jednego pomiaru LatencyScope
+  LatencyHistogram cost;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < CALL_COUNT; i++) {
+    LatencyScope scope(cost);
+  }
+  printCallResult("LatencyScope", micros() - start);
+  Serial.printf("sizeof(LatencyHistogram) = %u B\n", (unsigned)sizeof(LatencyHistogram));
+}
+
+void printResult(const char *name, uint32_t n, uint32_t duration, uint32_t callbacks) {
+  double nsPerLoop = duration * 1000.0 / ((double)SIM_MS * LOOPS_PER_MS);
+  Serial.printf("%-8s timers=%4u  czas=%8u us  %8.1f ns/loop  callbacki=%u\n",
+                name, (unsigned)n, (unsigned)duration, nsPerLoop, (unsigned)callbacks);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  const uint32_t counts[] = {1, 16, 256};
+  for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    uint32_t n = counts[c];
+    uint32_t cbLegacy, cbService;
+    uint32_t tLegacy = runLegacy(n, cbLegacy);
+    uint32_t tService = runService(n, cbService);
+    printResult("legacy", n, tLegacy, cbLegacy);
+    printResult("service", n, tService, cbService);
+    if (cbLegacy != cbService) Serial.println("BLAD: rozna liczba callbackow");
+  }
+
+  runDrift();
+  runHwDispatch();
+  runCallCost();
+  runLatency();
+}
+
+void loop() {
+  delay(10);
+}
+
+#ifndef ARDUINO
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,500 @@
+#include "../../myLib/Platform.h"
+#include "../../myLib/MovingAverage.h"
+#include "../../myLib/FixedFilter.h"
+#include "../../myLib/RunningMedian.h"
+#include "../../myLib/FilterBank.h"
+#include <algorithm>
+
+// ---------------------------------------------------------------
+// Porównanie filtrów z myLib:
+// - stara MovingAverage<V>(size), get() sumuje cały bufor
+// - MovingAverage<V>(size) i MovingAverage<V, N> z bieżącą sumą
+// - filtry całkowitoliczbowe z FixedFilter.h (boxcar, EMA, CIC)
+// - RunningMedian / HampelFilter kontra sortowanie okna co próbkę
+// - FilterBank::updateBlock() kontra osobny filtr na każdy kanał
+// Mierzymy koszt update() + get() na próbkę oraz dryf sumy float,
+// a wyniki filtrów całkowitych porównujemy z prostą implementacją
+// i wypisujemy sumę kontrolną - ma być taka sama na ESP32 i na PC.
+// ---------------------------------------------------------------
+
+#define BENCH_SAMPLES 100000    // próbki dla filtrów O(1)
+#define LEGACY_WORK 2000000     // próbki * N dla starej klasy, get() jest O(N)
+#define DRIFT_SAMPLES 1000000   // próbki do sprawdzenia dryfu sumy float
+
+volatile float sinkFloat;
+volatile uint32_t sinkInt;
+
+// kopia poprzedniej implementacji jako punkt odniesienia; poprawione jest tylko
+// zawijanie indeksu (było countData > sizeData, zapis za końcem bufora)
+// i zerowanie bufora, reszta bez zmian
+template <class V>
+class LegacyMovingAverage {
+private:
+  uint32_t countData;
+  uint32_t sizeData;
+  V *dataTab;
+
+public:
+  LegacyMovingAverage(uint32_t size) {
+    countData = 0;
+    sizeData = size;
+    dataTab = new V[size]();
+  }
+
+  ~LegacyMovingAverage() {
+    delete[] dataTab;
+  }
+
+  void update(V dataU) {
+    dataTab[countData++] = dataU;
+    if (countData >= sizeData) countData = 0;
+  }
+
+  V get() {
+    double dataOut = 0;
+    for (uint32_t i = 0; i < sizeData; i++) dataOut += dataTab[i];
+    return (V)(dataOut / sizeData);
+  }
+};
+
+// próbki jak z ADC w mV: 1000..1400 z szumem, generator LCG
+struct SampleSource {
+  uint32_t state;
+  SampleSource() : state(12345) {}
+  uint32_t nextInt() {
+    state = state * 1664525u + 1013904223u;
+    return 1000 + (state >> 23) % 400;
+  }
+  float nextFloat() {
+    return nextInt() + 0.01f * ((state >> 8) % 100);
+  }
+};
+
+void printResult(const char *name, uint32_t n, uint32_t samples, uint32_t duration) {
+  Serial.printf("%-22s N=%5u  %9.1f ns/probka\n", name, (unsigned)n, duration * 1000.0 / samples);
+}
+
+template <class Filter>
+uint32_t benchFloat(Filter &filter, uint32_t samples) {
+  SampleSource src;
+  float acc = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < samples; i++) {
+    filter.update(src.nextFloat());
+    acc += filter.get();
+  }
+  uint32_t duration = micros() - start;
+  sinkFloat = acc;
+  return duration;
+}
+
+template <class Filter>
+uint32_t benchInt(Filter &filter, uint32_t samples) {
+  SampleSource src;
+  uint32_t acc = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < samples; i++) {
+    filter.update(src.nextInt());
+    acc += filter.get();
+  }
+  uint32_t duration = micros() - start;
+  sinkInt = acc;
+  return duration;
+}
+
+template <uint32_t N>
+void runMovingAverage() {
+  uint32_t legacySamples = LEGACY_WORK / N;
+
+  LegacyMovingAverage<float> *legacyF = new LegacyMovingAverage<float>(N);
+  printResult("stara <float>", N, legacySamples, benchFloat(*legacyF, legacySamples));
+  delete legacyF;
+
+  MovingAverage<float> *dynamicF = new MovingAverage<float>(N);
+  printResult("<float>(N)", N, BENCH_SAMPLES, benchFloat(*dynamicF, BENCH_SAMPLES));
+  delete dynamicF;
+
+  MovingAverage<float, N> *staticF = new MovingAverage<float, N>();
+  printResult("<float, N>", N, BENCH_SAMPLES, benchFloat(*staticF, BENCH_SAMPLES));
+  delete staticF;
+
+  LegacyMovingAverage<uint32_t> *legacyI = new LegacyMovingAverage<uint32_t>(N);
+  printResult("stara <uint32_t>", N, legacySamples, benchInt(*legacyI, legacySamples));
+  delete legacyI;
+
+  MovingAverage<uint32_t, N> *staticI = new MovingAverage<uint32_t, N>();
+  printResult("<uint32_t, N>", N, BENCH_SAMPLES, benchInt(*staticI, BENCH_SAMPLES));
+  delete staticI;
+
+  // N nie będące potęgą 2, indeks bez maskowania
+  MovingAverage<uint32_t, N - 1> *staticOdd = new MovingAverage<uint32_t, N - 1>();
+  printResult("<uint32_t, N-1>", N - 1, BENCH_SAMPLES, benchInt(*staticOdd, BENCH_SAMPLES));
+  delete staticOdd;
+}
+
+// ---------------------------------------------------------------
+// Dryf: bieżąca suma float bez kompensacji kontra suma Kahana,
+// odniesieniem jest średnia ostatnich N próbek liczona w double
+// ---------------------------------------------------------------
+#define DRIFT_N 32
+
+struct NaiveRunningAverage {
+  float tab[DRIFT_N];
+  float sum;
+  uint32_t index;
+  NaiveRunningAverage() : sum(0), index(0) {
+    for (uint32_t i = 0; i < DRIFT_N; i++) tab[i] = 0;
+  }
+  void update(float v) {
+    sum += v - tab[index];
+    tab[index] = v;
+    index = (index + 1) % DRIFT_N;
+  }
+  float get() const {
+    return sum / DRIFT_N;
+  }
+};
+
+void runDrift() {
+  NaiveRunningAverage *naive = new NaiveRunningAverage();
+  MovingAverage<float, DRIFT_N> *kahan = new MovingAverage<float, DRIFT_N>();
+  float last[DRIFT_N];
+  SampleSource src;
+  for (uint32_t i = 0; i < DRIFT_SAMPLES; i++) {
+    float v = src.nextFloat();
+    last[i % DRIFT_N] = v;
+    naive->update(v);
+    kahan->update(v);
+  }
+  double exact = 0;
+  for (uint32_t i = 0; i < DRIFT_N; i++) exact += last[i];
+  exact /= DRIFT_N;
+
+  Serial.printf("dryf po %u probkach float: bez kompensacji %.6f, Kahan %.6f\n", (unsigned)DRIFT_SAMPLES,
+                naive->get() - exact, kahan->get() - exact);
+  delete naive;
+  delete kahan;
+}
+
+// średnia w trakcie zapełniania bufora
+void runWarmUp() {
+  MovingAverage<uint32_t, 32> avg;
+  avg.update(10);
+  avg.update(20);
+  avg.update(30);
+  LegacyMovingAverage<uint32_t> legacy(32);
+  legacy.update(10);
+  legacy.update(20);
+  legacy.update(30);
+  Serial.printf("rozbieg po 3 probkach 10/20/30: nowa %u (count %u), stara %u\n", (unsigned)avg.get(),
+                (unsigned)avg.count(), (unsigned)legacy.get());
+}
+
+// ---------------------------------------------------------------
+// Filtry całkowitoliczbowe: koszt i zgodność bit w bit
+// ---------------------------------------------------------------
+#define FIXED_SAMPLES 4096
+#define CIC_STAGES 3
+#define CIC_R 16
+
+// próbka Q15: piła z szumem, pełny zakres ze znakiem
+int32_t fixedSample(uint32_t i, SampleSource &src) {
+  int32_t v = (int32_t)((i * 97u) & 0xFFFF) - 32768 + (int32_t)(src.nextInt() % 64) - 32;
+  return v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v);
+}
+
+// FNV-1a po kolejnych wynikach
+struct Checksum {
+  uint32_t h;
+  Checksum() : h(2166136261u) {}
+  void add(int32_t v) {
+    for (uint32_t b = 0; b < 4; b++) {
+      h ^= ((uint32_t)v >> (8 * b)) & 0xFF;
+      h *= 16777619u;
+    }
+  }
+};
+
+int64_t floorDiv64(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  return (a < 0 && q * b != a) ? q - 1 : q;
+}
+
+void runFixedCost() {
+  // na ESP32-C3/S2 float i double są emulowane programowo
+  MovingAverage<float, 32> *avgF = new MovingAverage<float, 32>();
+  printResult("<float, 32>", 32, BENCH_SAMPLES, benchFloat(*avgF, BENCH_SAMPLES));
+  delete avgF;
+
+  MovingAverage<double, 32> *avgD = new MovingAverage<double, 32>();
+  printResult("<double, 32>", 32, BENCH_SAMPLES, benchFloat(*avgD, BENCH_SAMPLES));
+  delete avgD;
+
+  BoxcarFilter<int32_t, 32, int32_t> *boxcar = new BoxcarFilter<int32_t, 32, int32_t>();
+  printResult("Boxcar<int32_t, 32>", 32, BENCH_SAMPLES, benchInt(*boxcar, BENCH_SAMPLES));
+  delete boxcar;
+
+  EmaFilter<int32_t, 4, int32_t> *ema = new EmaFilter<int32_t, 4, int32_t>();
+  printResult("Ema<int32_t, 4>", 16, BENCH_SAMPLES, benchInt(*ema, BENCH_SAMPLES));
+  delete ema;
+
+  CicDecimator<CIC_STAGES, CIC_R> *cic = new CicDecimator<CIC_STAGES, CIC_R>();
+  printResult("Cic<3, 16>", CIC_R, BENCH_SAMPLES, benchInt(*cic, BENCH_SAMPLES));
+  delete cic;
+}
+
+void runFixedExact() {
+  int32_t *x = new int32_t[FIXED_SAMPLES];
+  SampleSource src;
+  for (uint32_t i = 0; i < FIXED_SAMPLES; i++) x[i] = fixedSample(i, src);
+
+  // boxcar: średnia dostępnych próbek (do 32), zaokrąglenie w dół
+  BoxcarFilter<q15_t, 32> boxcar;
+  Checksum sumBoxcar;
+  uint32_t errBoxcar = 0;
+  for (uint32_t i = 0; i < FIXED_SAMPLES; i++) {
+    boxcar.update((q15_t)x[i]);
+    uint32_t n = i + 1 < 32 ? i + 1 : 32;
+    int64_t acc = 0;
+    for (uint32_t k = 0; k < n; k++) acc += x[i - k];
+    if (boxcar.get() != floorDiv64(acc, n)) errBoxcar++;
+    sumBoxcar.add(boxcar.get());
+  }
+
+  // EMA: y = y + (x - y) / 16 liczone w int64_t
+  EmaFilter<q15_t, 4> ema;
+  Checksum sumEma;
+  uint32_t errEma = 0;
+  int64_t state = 0;
+  for (uint32_t i = 0; i < FIXED_SAMPLES; i++) {
+    ema.update((q15_t)x[i]);
+    state = i == 0 ? (int64_t)x[i] * 16 : state + x[i] - floorDiv64(state, 16);
+    if (ema.get() != floorDiv64(state, 16)) errEma++;
+    sumEma.add(ema.get());
+  }
+
+  // CIC: kaskada CIC_STAGES sum kroczących długości CIC_R, co CIC_R-ta próbka
+  CicDecimator<CIC_STAGES, CIC_R> cic;
+  Checksum sumCic;
+  uint32_t errCic = 0, outputs = 0;
+  int64_t *stage = new int64_t[FIXED_SAMPLES];
+  int64_t *next = new int64_t[FIXED_SAMPLES];
+  for (uint32_t i = 0; i < FIXED_SAMPLES; i++) stage[i] = x[i];
+  for (uint32_t s = 0; s < CIC_STAGES; s++) {
+    for (uint32_t i = 0; i < FIXED_SAMPLES; i++) {
+      int64_t acc = 0;
+      for (uint32_t k = 0; k < CIC_R && k <= i; k++) acc += stage[i - k];
+      next[i] = acc;
+    }
+    int64_t *t = stage;
+    stage = next;
+    next = t;
+  }
+  for (uint32_t i = 0; i < FIXED_SAMPLES; i++) {
+    if (!cic.update(x[i])) continue;
+    outputs++;
+    if (cic.getRaw() != stage[i] || cic.get() != floorDiv64(stage[i], 1 << cic.GAIN_BITS)) errCic++;
+    sumCic.add(cic.get());
+  }
+
+  Serial.printf("Boxcar<q15_t, 32>: %u roznic, suma kontrolna %08x\n", (unsigned)errBoxcar, (unsigned)sumBoxcar.h);
+  Serial.printf("Ema<q15_t, 4>:     %u roznic, suma kontrolna %08x\n", (unsigned)errEma, (unsigned)sumEma.h);
+  Serial.printf("Cic<3, 16>:        %u roznic na %u wynikach, suma kontrolna %08x\n", (unsigned)errCic,
+                (unsigned)outputs, (unsigned)sumCic.h);
+
+  delete[] x;
+  delete[] stage;
+  delete[] next;
+}
+
+// ---------------------------------------------------------------
+// Mediana krocząca: O(log N) kontra sortowanie całego okna co próbkę
+// ---------------------------------------------------------------
+#define MEDIAN_SAMPLES 20000
+#define MEDIAN_WORK 2000000  // próbki * N dla sortowania
+
+template <class T, uint32_t N>
+class SortMedian {
+private:
+  T window[N];
+  T sorted[N];
+  uint32_t index;
+  uint32_t countData;
+
+public:
+  SortMedian() : index(0), countData(0) {}
+
+  void update(T v) {
+    window[index] = v;
+    index = (index + 1) % N;
+    if (countData < N) countData++;
+  }
+
+  T get() {
+    for (uint32_t i = 0; i < countData; i++) sorted[i] = window[i];
+    std::sort(sorted, sorted + countData);
+    return sorted[countData / 2];
+  }
+};
+
+// próbki ADC z pojedynczymi szpilkami co ~50 próbek
+int32_t spikySample(SampleSource &src, bool &spike) {
+  int32_t v = (int32_t)src.nextInt();
+  spike = (src.state >> 4) % 50 == 0;
+  return spike ? v + 2000 : v;
+}
+
+template <uint32_t N>
+void runMedian() {
+  uint32_t sortSamples = std::min<uint32_t>(MEDIAN_SAMPLES, MEDIAN_WORK / N);
+
+  SortMedian<int32_t, N> *naive = new SortMedian<int32_t, N>();
+  printResult("sortowanie okna", N, sortSamples, benchInt(*naive, sortSamples));
+  delete naive;
+
+  RunningMedian<int32_t, N> *median = new RunningMedian<int32_t, N>();
+  printResult("RunningMedian", N, MEDIAN_SAMPLES, benchInt(*median, MEDIAN_SAMPLES));
+  delete median;
+
+  HampelFilter<int32_t, N> *hampel = new HampelFilter<int32_t, N>();
+  SampleSource src;
+  uint32_t start = micros();
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < MEDIAN_SAMPLES; i++) acc += hampel->update(src.nextInt());
+  printResult("HampelFilter", N, MEDIAN_SAMPLES, micros() - start);
+  sinkInt = acc;
+  delete hampel;
+
+  // zgodność z sortowaniem, także w trakcie zapełniania okna
+  naive = new SortMedian<int32_t, N>();
+  median = new RunningMedian<int32_t, N>();
+  uint32_t errors = 0;
+  for (uint32_t i = 0; i < 4 * N + 100; i++) {
+    int32_t v = (int32_t)src.nextInt() % 50;  // dużo powtórzeń
+    naive->update(v);
+    median->update(v);
+    if (naive->get() != median->get()) errors++;
+  }
+  Serial.printf("RunningMedian N=%u: %u roznic z sortowaniem\n", (unsigned)N, (unsigned)errors);
+  delete naive;
+  delete median;
+}
+
+// szpilki: ile wykrył Hampel i jak bardzo rozmazuje je średnia
+// minDeviation 250 mV: szum ma rozkład jednostajny +-200 mV, bez progu
+// krótkie okno daje kilka procent fałszywych (zastąpionych medianą) próbek
+void runHampel() {
+  HampelFilter<int32_t, 9> hampel(3.0f, 250);
+  MovingAverage<int32_t, 9> average;
+  SampleSource src;
+  uint32_t spikes = 0, caught = 0, falseAlarms = 0;
+  int32_t maxAvgError = 0, maxHampelError = 0;
+  for (uint32_t i = 0; i < MEDIAN_SAMPLES; i++) {
+    bool spike;
+    int32_t v = spikySample(src, spike);
+    int32_t clean = spike ? v - 2000 : v;
+    int32_t out = hampel.update(v);
+    average.update(v);
+    spikes += spike;
+    if (spike && hampel.isOutlier()) caught++;
+    if (!spike && hampel.isOutlier()) falseAlarms++;
+    if (i < 9) continue;
+    int32_t eh = out > clean ? out - clean : clean - out;
+    int32_t ea = average.get() > clean ? average.get() - clean : clean - average.get();
+    if (eh > maxHampelError) maxHampelError = eh;
+    if (ea > maxAvgError) maxAvgError = ea;
+  }
+  Serial.printf("Hampel N=9: szpilek %u, wykrytych %u, falszywych %u (%.2f %%)\n", (unsigned)spikes,
+                (unsigned)caught, (unsigned)falseAlarms, falseAlarms * 100.0 / MEDIAN_SAMPLES);
+  Serial.printf("maks. blad: Hampel %d mV, MovingAverage %d mV\n", (int)maxHampelError, (int)maxAvgError);
+}
+
+// DS18B20: 85.0 po resecie czujnika jako pierwszy odczyt - przy 1-2 próbkach
+// w oknie mediana to sama szpilka, więc musi ją odrzucić setRejectValue()
+void runHampelReset() {
+  HampelFilter<float, 5> f(3.0f, 0.5f);
+  f.setRejectValue(85.0f);
+  bool ok = true;
+  f.update(85.0f);
+  ok &= !f.ready() && f.isOutlier();
+  ok &= f.update(21.0f) == 21.0f && f.ready();
+  ok &= f.update(21.5f) == 21.5f;  // rozruch, bez progu
+  ok &= f.update(85.0f) == 21.5f && f.isOutlier();
+  ok &= f.update(21.2f) == 21.2f && !f.isOutlier();
+  ok &= f.update(40.0f) != 40.0f && f.isOutlier();  // zwykła szpilka po rozruchu
+  ok &= f.getOutliers() == 3;
+  Serial.printf("Hampel 85.0 po resecie DS18B20: %s\n", ok ? "OK" : "BLAD");
+}
+
+// ---------------------------------------------------------------
+// Wiele kanałów: MovingAverage na kanał kontra FilterBank (SoA)
+// ---------------------------------------------------------------
+#define BANK_CHANNELS 16
+#define BANK_N 32
+#define BANK_FRAMES 64       // ramek w jednym buforze DMA
+#define BANK_BUFFERS 200
+
+template <class V, class Acc>
+void runFilterBank(const char *type) {
+  V *frames = new V[BANK_FRAMES * BANK_CHANNELS];
+  SampleSource src;
+  for (uint32_t i = 0; i < BANK_FRAMES * BANK_CHANNELS; i++) frames[i] = (V)(src.nextInt() - 1000);
+  const uint32_t samples = BANK_BUFFERS * BANK_FRAMES * BANK_CHANNELS;
+
+  // osobny filtr na kanał, próbka po próbce
+  MovingAverage<V, BANK_N> *single = new MovingAverage<V, BANK_N>[BANK_CHANNELS];
+  uint32_t start = micros();
+  for (uint32_t b = 0; b < BANK_BUFFERS; b++) {
+    const V *p = frames;
+    for (uint32_t f = 0; f < BANK_FRAMES; f++)
+      for (uint32_t c = 0; c < BANK_CHANNELS; c++) single[c].update(*p++);
+  }
+  uint32_t tSingle = micros() - start;
+
+  FilterBank<V, BANK_CHANNELS, BANK_N, Acc> *bank = new FilterBank<V, BANK_CHANNELS, BANK_N, Acc>();
+  start = micros();
+  for (uint32_t b = 0; b < BANK_BUFFERS; b++) bank->updateBlock(frames, BANK_FRAMES);
+  uint32_t tBank = micros() - start;
+
+  uint32_t errors = 0;
+  for (uint32_t c = 0; c < BANK_CHANNELS; c++)
+    if (single[c].get() != bank->get(c)) errors++;
+
+  Serial.printf("%-9s %u kanalow: na kanal %6.2f ns/probka, updateBlock %6.2f ns/probka, roznice %u\n", type,
+                (unsigned)BANK_CHANNELS, tSingle * 1000.0 / samples, tBank * 1000.0 / samples, (unsigned)errors);
+  delete[] single;
+  delete bank;
+  delete[] frames;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  runMovingAverage<32>();
+  runMovingAverage<256>();
+  runMovingAverage<4096>();
+  runDrift();
+  runWarmUp();
+  runFixedCost();
+  runFixedExact();
+  runMedian<5>();
+  runMedian<31>();
+  runMedian<255>();
+  runHampel();
+  runHampelReset();
+  runFilterBank<int32_t, int64_t>("int32_t");
+  runFilterBank<int16_t, int32_t>("int16_t");
+  runFilterBank<float, float>("float");
+}
+
+void loop() {
+  delay(10);
+}
+
+#ifndef ARDUINO
+int main() {
+  setup();
+  return 0;
+}
+#endif
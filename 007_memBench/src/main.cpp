@@ -0,0 +1,438 @@
+#include "../../myLib/Platform.h"
+#include "../../myLib/Bench.h"
+#include "../../myLib/HotPath.h"
+#include "../../myLib/MovingAverage.h"
+#include "../../myLib/RunningMedian.h"
+#include <string.h>
+#include <stdlib.h>
+#ifdef ARDUINO
+#include "esp_heap_caps.h"
+#endif
+
+// 1 = AP "memBench" z WebServerem, pomiar gorącej ścieżki w loop() między
+// obsługą żądań (obciążenie np. pętlą curl na http://192.168.4.1/)
+#ifndef MEMBENCH_WEB
+#define MEMBENCH_WEB 0
+#endif
+
+#if MEMBENCH_WEB && defined(ARDUINO)
+#include <WiFi.h>
+#include <WebServer.h>
+#endif
+
+// ---------------------------------------------------------------
+// Koszt dostępu do różnych rodzajów pamięci ESP32:
+// - DRAM   wewnętrzny SRAM danych
+// - IRAM   wewnętrzny SRAM instrukcji (heap z MALLOC_CAP_EXEC),
+//          tylko dostęp 32-bitowy
+// - PSRAM  zewnętrzny SPI RAM przez cache (płytki D0WDxx_psram)
+// - flash  stała tablica w .rodata, czytana przez cache flash
+// Dla każdej: odczyt i zapis sekwencyjny i losowy (MB/s), opóźnienie
+// zależnych odczytów (adres następnego zależy od odczytanej wartości,
+// jak przy przechodzeniu po liście) i memcpy do / z DRAM.
+// Na końcu kod we flash kontra w IRAM: ta sama funkcja wołana w kółko
+// (trafienia w cache) i CODE_BLOCKS różnych funkcji, razem większych
+// niż cache (chybienia).
+//
+// Bufory PSRAM i flash są większe niż cache (32 KB na ESP32), więc
+// losowy dostęp naprawdę trafia do pamięci zewnętrznej.
+// Na PC ([env:native]) "DRAM" mieści się w L1/L2, "PSRAM" to duży
+// bufor w RAM, IRAM nie ma.
+//
+// Wyniki native (1 rdzeń VM, -O2), MB/s / cykle:
+//          seqRead seqWrite randRead chase memcpyIn
+// DRAM        6959    14149     2121  1.8    89530
+// PSRAM      11286    32474     2194  5.6    52618
+// flash      13110        -     2241  4.8    51992
+// kod: hot 69.7, miss 87.4, kara 17.7 cykli/wywołanie
+// Z płytek: grep ^MEM, log.txt, kolumny jak w nagłówku "# MEM,..."
+// ---------------------------------------------------------------
+
+#define INTERNAL_BYTES (32 * 1024)
+#define EXTERNAL_BYTES (512 * 1024)
+#define FLASH_BYTES (128 * 1024)
+#define COPY_BYTES (8 * 1024)
+#define RANDOM_ACCESSES 32768
+#define CHASE_LOADS 32768
+
+#define MEM_WARMUP 1
+#define MEM_REPS 5
+
+struct MemRegion {
+  const char *name;
+  uint32_t *data;
+  uint32_t words;  // potęga 2
+  bool writable;
+};
+
+// dane we flash: niezerowa inicjalizacja, żeby tablica trafiła do .rodata, a nie do .bss
+static const uint32_t flashData[FLASH_BYTES / 4] = {1, 2, 3, 4};
+
+uint32_t copyBuffer[COPY_BYTES / 4];
+
+// ukrycie pochodzenia wskaźnika, kompilator nie zna zawartości tablicy
+template <class T>
+T *launder(T *p) {
+  asm volatile("" : "+r"(p));
+  return p;
+}
+
+double toMBps(uint32_t bytes, uint32_t cycles) {
+  return cycles ? (double)bytes * (GetTimeDiv::getCpuHz() / 1000000) / cycles : 0;
+}
+
+void printRow(const char *region, const char *test, double value, const char *unit) {
+  Serial.printf("%-6s %-14s %10.2f %s\n", region, test, value, unit);
+  Serial.printf("MEM,%s,%s,%s,%s,%.3f,%s\n", BENCH_TARGET, BENCH_BOARD, region, test, value, unit);
+}
+
+// ---------------------------------------------------------------
+// Testy na jednym obszarze, dostęp zawsze 32-bitowy (wymóg IRAM)
+// ---------------------------------------------------------------
+void memSeqRead(const MemRegion &r) {
+  const uint32_t *p = launder(r.data);
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < r.words; i += 4) sum += p[i] + p[i + 1] + p[i + 2] + p[i + 3];
+  benchDoNotOptimize(sum);
+}
+
+void memSeqWrite(const MemRegion &r) {
+  uint32_t *p = launder(r.data);
+  for (uint32_t i = 0; i < r.words; i += 4) {
+    p[i] = i;
+    p[i + 1] = i;
+    p[i + 2] = i;
+    p[i + 3] = i;
+  }
+  benchClobberMemory();
+}
+
+// niezależne odczyty pod adresami z LCG
+void memRandomRead(const MemRegion &r) {
+  const uint32_t *p = launder(r.data);
+  const uint32_t mask = r.words - 1;
+  uint32_t x = 1, sum = 0;
+  for (uint32_t i = 0; i < RANDOM_ACCESSES; i++) {
+    x = x * 1664525u + 1013904223u;
+    sum += p[(x >> 8) & mask];
+  }
+  benchDoNotOptimize(sum);
+}
+
+void memRandomWrite(const MemRegion &r) {
+  uint32_t *p = launder(r.data);
+  const uint32_t mask = r.words - 1;
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < RANDOM_ACCESSES; i++) {
+    x = x * 1664525u + 1013904223u;
+    p[(x >> 8) & mask] = i;
+  }
+  benchClobberMemory();
+}
+
+// zależne odczyty: następny adres liczony z odczytanej wartości
+void memChase(const MemRegion &r) {
+  const uint32_t *p = launder(r.data);
+  const uint32_t mask = r.words - 1;
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < CHASE_LOADS; i++) x = (x * 1664525u + 1013904223u + p[(x >> 8) & mask]);
+  benchDoNotOptimize(x);
+}
+
+// ten sam rachunek adresu bez odczytu, odejmowany od memChase
+void memChaseBase() {
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < CHASE_LOADS; i++) {
+    x = x * 1664525u + 1013904223u;
+    benchDoNotOptimize(x);
+  }
+}
+
+void memCopyIn(const MemRegion &r) {
+  for (uint32_t off = 0; off < r.words; off += COPY_BYTES / 4) memcpy(copyBuffer, launder(r.data) + off, COPY_BYTES);
+  benchClobberMemory();
+}
+
+void memCopyOut(const MemRegion &r) {
+  for (uint32_t off = 0; off < r.words; off += COPY_BYTES / 4) memcpy(launder(r.data) + off, copyBuffer, COPY_BYTES);
+  benchClobberMemory();
+}
+
+void runRegion(const MemRegion &r) {
+  if (!r.data) {
+    Serial.printf("%-6s brak (nie udalo sie przydzielic pamieci)\n", r.name);
+    return;
+  }
+  const uint32_t bytes = r.words * 4;
+  BenchResult res;
+
+  res = benchMeasure([&]() { memSeqRead(r); }, MEM_WARMUP, MEM_REPS);
+  printRow(r.name, "seqRead", toMBps(bytes, res.medianCycles), "MB/s");
+  if (r.writable) {
+    res = benchMeasure([&]() { memSeqWrite(r); }, MEM_WARMUP, MEM_REPS);
+    printRow(r.name, "seqWrite", toMBps(bytes, res.medianCycles), "MB/s");
+  }
+
+  res = benchMeasure([&]() { memRandomRead(r); }, MEM_WARMUP, MEM_REPS);
+  printRow(r.name, "randomRead", toMBps(RANDOM_ACCESSES * 4, res.medianCycles), "MB/s");
+  if (r.writable) {
+    res = benchMeasure([&]() { memRandomWrite(r); }, MEM_WARMUP, MEM_REPS);
+    printRow(r.name, "randomWrite", toMBps(RANDOM_ACCESSES * 4, res.medianCycles), "MB/s");
+  }
+
+  uint32_t base = benchMeasure(memChaseBase, MEM_WARMUP, MEM_REPS).medianCycles;
+  res = benchMeasure([&]() { memChase(r); }, MEM_WARMUP, MEM_REPS);
+  double cyclesPerLoad = res.medianCycles > base ? (double)(res.medianCycles - base) / CHASE_LOADS : 0;
+  printRow(r.name, "chaseLatency", cyclesPerLoad, "cykli");
+  printRow(r.name, "chaseLatency", cyclesPerLoad * 1000.0 / (GetTimeDiv::getCpuHz() / 1000000), "ns");
+
+  res = benchMeasure([&]() { memCopyIn(r); }, MEM_WARMUP, MEM_REPS);
+  printRow(r.name, "memcpyToDRAM", toMBps(bytes, res.medianCycles), "MB/s");
+  if (r.writable) {
+    res = benchMeasure([&]() { memCopyOut(r); }, MEM_WARMUP, MEM_REPS);
+    printRow(r.name, "memcpyFromDRAM", toMBps(bytes, res.medianCycles), "MB/s");
+  }
+}
+
+// ---------------------------------------------------------------
+// Kod we flash i w IRAM. Każdy blok to ok. 300 B kodu z innymi
+// stałymi, CODE_BLOCKS bloków razem ~40 KB, więcej niż cache.
+// ---------------------------------------------------------------
+#define CODE_BLOCKS 128
+#define CODE_CALLS 4096
+
+#define CODE_STEP(k) x = (x ^ (x >> 7)) * (0x9E3779B1u + (k)) + K;
+#define CODE_STEP8(k) \
+  CODE_STEP(k) CODE_STEP(k + 1) CODE_STEP(k + 2) CODE_STEP(k + 3) CODE_STEP(k + 4) CODE_STEP(k + 5) CODE_STEP(k + 6) CODE_STEP(k + 7)
+#define CODE_BODY CODE_STEP8(0) CODE_STEP8(8) CODE_STEP8(16) CODE_STEP8(24)
+
+typedef uint32_t (*CodeFn)(uint32_t);
+
+template <uint32_t K>
+__attribute__((noinline)) uint32_t codeBlock(uint32_t x) {
+  CODE_BODY
+  return x;
+}
+
+// ta sama treść co codeBlock<0>, w IRAM
+__attribute__((noinline)) IRAM_ATTR uint32_t codeBlockIram(uint32_t x) {
+  const uint32_t K = 0;
+  CODE_BODY
+  return x;
+}
+
+template <uint32_t I>
+struct CodeTable {
+  static void fill(CodeFn *table) {
+    table[I - 1] = codeBlock<I - 1>;
+    CodeTable<I - 1>::fill(table);
+  }
+};
+
+template <>
+struct CodeTable<0> {
+  static void fill(CodeFn *) {}
+};
+
+CodeFn codeBlocks[CODE_BLOCKS];
+
+void codeHot(CodeFn fn) {
+  CodeFn f = launder(fn);
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < CODE_CALLS; i++) x = f(x);
+  benchDoNotOptimize(x);
+}
+
+void codeCold() {
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < CODE_CALLS; i++) x = codeBlocks[i % CODE_BLOCKS](x);
+  benchDoNotOptimize(x);
+}
+
+void runCode() {
+  CodeTable<CODE_BLOCKS>::fill(codeBlocks);
+  uint32_t hot = benchMeasure([]() { codeHot(codeBlocks[0]); }, MEM_WARMUP, MEM_REPS).medianCycles;
+  uint32_t iram = benchMeasure([]() { codeHot(codeBlockIram); }, MEM_WARMUP, MEM_REPS).medianCycles;
+  uint32_t cold = benchMeasure(codeCold, MEM_WARMUP, MEM_REPS).medianCycles;
+  printRow("code", "flashHot", (double)hot / CODE_CALLS, "cykli/wyw");
+  printRow("code", "iram", (double)iram / CODE_CALLS, "cykli/wyw");
+  printRow("code", "flashMiss", (double)cold / CODE_CALLS, "cykli/wyw");
+  printRow("code", "missPenalty", (double)(cold > hot ? cold - hot : 0) / CODE_CALLS, "cykli/wyw");
+}
+
+// ---------------------------------------------------------------
+// Gorąca ścieżka po wyrzuceniu z cache: krok filtr + PID jak w
+// SterownikPID, mierzony pojedynczo po każdym przebiegu codeCold()
+// (albo obsłudze żądania WWW), max i p99 to najgorszy przypadek.
+// hotStepFlash / hotStepIram - ta sama treść z filtrami wstawionymi
+//   inline (flatten), we flash i w IRAM, niezależnie od HOTPATH_IRAM
+// hotStepLib - wywołania filtrów z myLib, położenie zależy od
+//   HOTPATH_IRAM, porównanie env:esp32 z env:esp32_iram
+// ---------------------------------------------------------------
+#define HOT_SAMPLES 2000
+#define HOT_VARIANTS 3
+#define WEB_REPORT_MS 10000
+
+struct HotState {
+  HampelFilter<float, 5> spikes;
+  MovingAverage<float, 32> average;
+  float integral;
+  float prevError;
+
+  HotState() : spikes(3.0f, 0.5f), integral(0), prevError(0) {}
+};
+
+// stałe regulatora, przy HOTPATH_IRAM w DRAM zamiast flash
+HOT_DATA static const float hotGains[4] = {25.0f, 2.0f, 0.5f, 1.0f};  // setpoint, Kp, Ki, Kd
+
+inline float hotStepBody(HotState &s, float x) {
+  s.average.update(s.spikes.update(x));
+  float error = s.average.get() - hotGains[0];
+  s.integral += error * 0.5f;
+  float d = error - s.prevError;
+  s.prevError = error;
+  return hotGains[1] * error + hotGains[2] * s.integral + hotGains[3] * d;
+}
+
+__attribute__((noinline, flatten)) float hotStepFlash(HotState &s, float x) {
+  return hotStepBody(s, x);
+}
+
+__attribute__((noinline, flatten)) IRAM_ATTR float hotStepIram(HotState &s, float x) {
+  return hotStepBody(s, x);
+}
+
+HOT_FN __attribute__((noinline)) float hotStepLib(HotState &s, float x) {
+  return hotStepBody(s, x);
+}
+
+typedef float (*HotStep)(HotState &, float);
+const HotStep hotSteps[HOT_VARIANTS] = {hotStepFlash, hotStepIram, hotStepLib};
+const char *const hotNames[HOT_VARIANTS] = {"hotFlash", "hotIram", "hotLib"};
+
+HotState hotStates[HOT_VARIANTS];
+LatencyHistogram hotHist[HOT_VARIANTS];
+uint32_t hotInput = 1;
+
+// jeden pomiar wariantu v do jego histogramu
+void hotMeasure(uint32_t v) {
+  hotInput = hotInput * 1664525u + 1013904223u;
+  float x = 20.0f + (float)(hotInput >> 24) / 32.0f;
+  GetTimeDiv t;
+  t.accumulate(hotHist[v]);
+  t.startCycles();
+  float out = launder(hotSteps[v])(hotStates[v], x);
+  t.endCycles();
+  benchDoNotOptimize(out);
+}
+
+void printHot(const char *mode) {
+  for (uint32_t v = 0; v < HOT_VARIANTS; v++) {
+    LatencySummary s = GetTimeDiv::summaryNanos(hotHist[v]);
+    char name[32];
+    snprintf(name, sizeof(name), "%s/%s", hotNames[v], mode);
+    s.print(Serial, name);
+    snprintf(name, sizeof(name), "%sMax", mode);
+    printRow(hotNames[v], name, s.max, "ns");
+    snprintf(name, sizeof(name), "%sP99", mode);
+    printRow(hotNames[v], name, s.p99, "ns");
+    hotHist[v].reset();
+  }
+}
+
+void runHotPath() {
+  CodeTable<CODE_BLOCKS>::fill(codeBlocks);
+  Serial.printf("# hotStepLib w %s (HOTPATH_IRAM=%d)\n", hotPathInIram((const void *)hotStepLib) ? "IRAM" : "flash",
+                HOTPATH_IRAM);
+
+  // bez zakłóceń, wszystko w cache
+  for (uint32_t v = 0; v < HOT_VARIANTS; v++)
+    for (uint32_t i = 0; i < HOT_SAMPLES; i++) hotMeasure(v);
+  printHot("warm");
+
+  // przed każdym pomiarem cały cache zajęty przez codeBlocks
+  for (uint32_t i = 0; i < HOT_SAMPLES; i++)
+    for (uint32_t v = 0; v < HOT_VARIANTS; v++) {
+      codeCold();
+      hotMeasure(v);
+    }
+  printHot("thrash");
+}
+
+#if MEMBENCH_WEB && defined(ARDUINO)
+WebServer server(80);
+uint32_t webReportTime = 0;
+
+void webBegin() {
+  WiFi.softAP("memBench");
+  // strona kilka KB, żeby obsługa żądania przeszła przez sporo kodu
+  server.on("/", []() {
+    String page;
+    page.reserve(4096);
+    for (uint32_t i = 0; i < 256; i++) page += String(i) + " memBench\n";
+    server.send(200, "text/plain", page);
+  });
+  server.begin();
+  webReportTime = millis();
+  Serial.printf("# WWW: http://%s/, raport co %u ms\n", WiFi.softAPIP().toString().c_str(), WEB_REPORT_MS);
+}
+
+// pomiar po każdym obiegu obsługi WWW, pod obciążeniem wyrzucającej kod z cache
+void webPoll() {
+  server.handleClient();
+  for (uint32_t v = 0; v < HOT_VARIANTS; v++) hotMeasure(v);
+  if (millis() - webReportTime >= WEB_REPORT_MS) {
+    webReportTime = millis();
+    printHot("web");
+  }
+}
+#endif
+
+// ---------------------------------------------------------------
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  MemRegion regions[4];
+#ifdef ARDUINO
+  regions[0] = {"DRAM", (uint32_t *)heap_caps_malloc(INTERNAL_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                INTERNAL_BYTES / 4, true};
+  regions[1] = {"IRAM", (uint32_t *)heap_caps_malloc(INTERNAL_BYTES / 2, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT),
+                INTERNAL_BYTES / 8, true};
+  regions[2] = {"PSRAM", (uint32_t *)heap_caps_malloc(EXTERNAL_BYTES, MALLOC_CAP_SPIRAM), EXTERNAL_BYTES / 4, true};
+#else
+  regions[0] = {"DRAM", (uint32_t *)malloc(INTERNAL_BYTES), INTERNAL_BYTES / 4, true};
+  regions[1] = {"IRAM", nullptr, INTERNAL_BYTES / 8, true};
+  regions[2] = {"PSRAM", (uint32_t *)malloc(EXTERNAL_BYTES), EXTERNAL_BYTES / 4, true};
+#endif
+  regions[3] = {"flash", (uint32_t *)flashData, FLASH_BYTES / 4, false};
+
+  GetTimeDiv::overheadCycles();
+  Serial.printf("# %s / %s, %u MHz\n", BENCH_TARGET, BENCH_BOARD, (unsigned)(GetTimeDiv::getCpuHz() / 1000000));
+  Serial.printf("# MEM,cel,plytka,obszar,test,wartosc,jednostka\n");
+  for (uint32_t i = 0; i < 4; i++) {
+    if (regions[i].data && regions[i].writable)
+      for (uint32_t w = 0; w < regions[i].words; w++) regions[i].data[w] = 0;  // nie memset, IRAM tylko po 32 bity
+    runRegion(regions[i]);
+  }
+  runCode();
+  runHotPath();
+#if MEMBENCH_WEB && defined(ARDUINO)
+  webBegin();
+#endif
+}
+
+void loop() {
+#if MEMBENCH_WEB && defined(ARDUINO)
+  webPoll();
+#else
+  delay(10);
+#endif
+}
+
+#ifndef ARDUINO
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,204 @@
+#include "../../myLib/Platform.h"
+#include "../../myLib/Vga.h"
+
+// ---------------------------------------------------------------
+// Tablica stanu na VGA 640x480@60 (myLib/Vga.h), płytka TTGO_VGA_1.2A.
+// Tekst 80x30 (czcionka 8x8, wiersze podwojone) i paski z kafelków,
+// bez bufora ramki: w RAM są tylko komórki i VGA_LINE_BUFFERS linii.
+// Co sekundę nowe wartości na ekranie i linia "VGA,..." na Serial:
+// klatki/s, pominięte przerwania, niedobory, najdłuższe rysowanie linii.
+// Na PC ([env:native]): ta sama tablica z przykładowymi wartościami,
+// dwie klatki przez VgaScanout jak z DMA, kontrola synchronizacji
+// i pikseli znaków, zapis do dashboard.ppm i czas rysowania linii.
+// ---------------------------------------------------------------
+#define COLS 80
+#define ROWS 30
+#define UPDATE_MS 1000
+#define ADC_PIN 36
+
+VgaCell cells[COLS * ROWS];
+VgaTextLayer text;
+
+struct DashValues {
+  uint32_t uptimeS;
+  uint32_t cpuMhz;
+  uint32_t heapFree;
+  uint32_t heapTotal;
+  uint32_t heapMin;
+  float tempC;
+  uint16_t adc;
+  uint32_t fps;
+  uint32_t missed;
+  uint32_t underruns;
+  float lineUs;    // najdłuższe rysowanie linii
+  float budgetUs;  // zapas DMA na linię
+};
+
+void drawLabel(uint16_t row, const char *label) {
+  text.print(2, row, label, VGA_GRAY, VGA_BLACK);
+}
+
+void drawStatic() {
+  text.clear(VGA_WHITE, VGA_BLACK);
+  for (uint16_t c = 0; c < COLS; c++) text.put(c, 0, ' ', VGA_WHITE, VGA_DARK_BLUE);
+  text.print(2, 0, "ESP32 VGA dashboard", VGA_WHITE, VGA_DARK_BLUE);
+  text.print(COLS - 16, 0, "640x480 @ 60 Hz", VGA_YELLOW, VGA_DARK_BLUE);
+  drawLabel(2, "czas pracy");
+  drawLabel(3, "CPU");
+  drawLabel(5, "heap wolny");
+  drawLabel(6, "heap min");
+  drawLabel(8, "temperatura");
+  drawLabel(9, "ADC");
+  text.print(2, 12, "VGA", VGA_CYAN, VGA_BLACK);
+  drawLabel(13, "klatki/s");
+  drawLabel(14, "pominiete");
+  drawLabel(15, "niedobory");
+  drawLabel(16, "linia max");
+  text.printf(2, ROWS - 1, VGA_GRAY, VGA_BLACK, "RAM: komorki %u B, linie %u x %u B", (unsigned)text.bytes(),
+              VGA_LINE_BUFFERS, (unsigned)(VGA_640x480_60.hTotal() * 2));
+}
+
+void drawValues(const DashValues &v) {
+  text.printf(16, 2, VGA_WHITE, VGA_BLACK, "%02u:%02u:%02u", (unsigned)(v.uptimeS / 3600),
+              (unsigned)(v.uptimeS / 60 % 60), (unsigned)(v.uptimeS % 60));
+  text.printf(16, 3, VGA_WHITE, VGA_BLACK, "%u MHz", (unsigned)v.cpuMhz);
+  text.printf(16, 5, VGA_WHITE, VGA_BLACK, "%7u B ", (unsigned)v.heapFree);
+  text.bar(30, 5, 40, v.heapFree, v.heapTotal, VGA_GREEN, VGA_BLACK);
+  text.printf(16, 6, VGA_WHITE, VGA_BLACK, "%7u B ", (unsigned)v.heapMin);
+  text.bar(30, 6, 40, v.heapMin, v.heapTotal, VGA_GREEN, VGA_BLACK);
+  text.printf(16, 8, VGA_WHITE, VGA_BLACK, "%5.1f C ", v.tempC);
+  text.bar(30, 8, 40, v.tempC > 0 ? (uint32_t)v.tempC : 0, 100, v.tempC > 70 ? VGA_RED : VGA_YELLOW, VGA_BLACK);
+  text.printf(16, 9, VGA_WHITE, VGA_BLACK, "%4u    ", (unsigned)v.adc);
+  text.bar(30, 9, 40, v.adc, 4095, VGA_CYAN, VGA_BLACK);
+  text.printf(16, 13, VGA_WHITE, VGA_BLACK, "%u  ", (unsigned)v.fps);
+  text.printf(16, 14, v.missed ? VGA_RED : VGA_WHITE, VGA_BLACK, "%u  ", (unsigned)v.missed);
+  text.printf(16, 15, v.underruns ? VGA_RED : VGA_WHITE, VGA_BLACK, "%u  ", (unsigned)v.underruns);
+  text.printf(16, 16, VGA_WHITE, VGA_BLACK, "%5.2f us ", v.lineUs);
+  text.bar(30, 16, 40, (uint32_t)(v.lineUs * 100), (uint32_t)(v.budgetUs * 100),
+           v.lineUs > v.budgetUs ? VGA_RED : VGA_MAGENTA, VGA_BLACK);
+}
+
+// zapas na narysowanie linii: pozostałe linie w pierścieniu
+float lineBudgetUs() {
+  return (VGA_LINE_BUFFERS - 1) * VGA_640x480_60.hTotal() * 1e6f / VGA_640x480_60.pixelHz;
+}
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+Vga vga;
+uint32_t updateTime = 0;
+uint32_t lastFrames = 0;
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  text.begin(cells, COLS, ROWS);
+  drawStatic();
+  if (!vga.begin(VGA_PINS_TTGO, VGA_640x480_60, &text)) {
+    Serial.println("VGA: blad inicjalizacji");
+    return;
+  }
+  Serial.printf("VGA: %u Hz pikseli, komorki %u B, linie %u x %u B\n", (unsigned)vga.getPixelHz(),
+                (unsigned)text.bytes(), VGA_LINE_BUFFERS, (unsigned)(VGA_640x480_60.hTotal() * 2));
+  updateTime = millis();
+}
+
+void loop() {
+  if (millis() - updateTime < UPDATE_MS) {
+    delay(10);
+    return;
+  }
+  updateTime = millis();
+  I2sParallelStats s = vga.takeStats();
+  uint32_t frames = vga.getFrames();
+
+  DashValues v;
+  v.uptimeS = millis() / 1000;
+  v.cpuMhz = getCpuFrequencyMhz();
+  v.heapFree = ESP.getFreeHeap();
+  v.heapTotal = ESP.getHeapSize();
+  v.heapMin = ESP.getMinFreeHeap();
+  v.tempC = temperatureRead();
+  v.adc = analogRead(ADC_PIN);
+  v.fps = frames - lastFrames;
+  v.missed = s.missed;
+  v.underruns = s.underruns;
+  v.lineUs = s.maxFillCycles / (float)v.cpuMhz;
+  v.budgetUs = lineBudgetUs();
+  lastFrames = frames;
+  drawValues(v);
+
+  Serial.printf("VGA,%u,%u,%u,%u,%.2f\n", (unsigned)v.fps, (unsigned)s.buffers, (unsigned)s.missed,
+                (unsigned)s.underruns, v.lineUs);
+}
+
+#else
+// na PC i na S2/C3 (bez trybu LCD w I2S1) tylko render na hoście
+VgaScanout scanout;
+VgaHostFrame frame;
+
+// piksele komórki zgodne z glifem: zapalone fg, reszta bg
+bool checkCell(uint16_t col, uint16_t row, const uint8_t *glyph, uint8_t fg, uint8_t bg) {
+  for (uint32_t r = 0; r < 16; r++)
+    for (uint32_t k = 0; k < 8; k++) {
+      uint8_t expected = (glyph[r / 2] >> k) & 1 ? fg : bg;
+      if (frame.pixel(col * 8 + k, row * 16 + r) != expected) return false;
+    }
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  text.begin(cells, COLS, ROWS);
+  drawStatic();
+  DashValues v = {3725, 240, 201000, 327680, 183500, 48.5f, 2730, 60, 0, 0, 7.8f, lineBudgetUs()};
+  drawValues(v);
+  scanout.begin(VGA_640x480_60, &text);
+
+  // dwie klatki: druga już na buforach z zapamiętanym rodzajem linii
+  bool ok = frame.capture(scanout) && frame.getSyncErrors() == 0;
+  ok &= frame.capture(scanout) && frame.getSyncErrors() == 0 && frame.getVsyncLines() == VGA_640x480_60.vSync;
+  ok &= scanout.getFrames() == 2 && scanout.getLine() == 0;
+  Serial.printf("synchronizacja: %u blednych probek, %u linii VSYNC  %s\n", (unsigned)frame.getSyncErrors(),
+                (unsigned)frame.getVsyncLines(), ok ? "OK" : "BLAD");
+
+  // 'E' w tytule (kolumna 2) i pełny kafelek paska ADC, tło paska za wartością
+  bool glyphsOk = checkCell(2, 0, &font8x8[('E' - FONT8X8_FIRST) * 8], VGA_WHITE, VGA_DARK_BLUE);
+  glyphsOk &= checkCell(30, 9, &vgaBarTiles[8 * 8], VGA_CYAN, VGA_BLACK);
+  glyphsOk &= checkCell(69, 9, &vgaBarTiles[0], VGA_CYAN, VGA_BLACK);
+  glyphsOk &= frame.pixel(639, 479) == VGA_BLACK;
+  Serial.printf("piksele znakow i paskow  %s\n", glyphsOk ? "OK" : "BLAD");
+  ok &= glyphsOk;
+
+  ApllClock c = I2sParallel::apllFor(VGA_640x480_60.pixelHz);
+  Serial.printf("APLL: %u Hz (sdm2 %u, sdm1 %u, sdm0 %u, odiv %u, div %u)\n", (unsigned)c.hz, c.sdm2, c.sdm1, c.sdm0,
+                c.odiv, c.div);
+  ok &= c.hz > 25170000 && c.hz < 25180000;
+
+  // czas rysowania linii na hoście, na ESP32 w kolumnie "linia max"
+  static uint16_t line[VGA_LINE_BUFFERS][800];
+  const uint32_t frames = 200;
+  uint32_t t0 = micros();
+  for (uint32_t n = 0; n < frames * VGA_640x480_60.vTotal(); n++) scanout.fill(line[n % VGA_LINE_BUFFERS]);
+  uint32_t us = micros() - t0;
+  Serial.printf("rysowanie: %.1f ns na linie, zapas %.1f us\n", us * 1000.0 / (frames * VGA_640x480_60.vTotal()),
+                lineBudgetUs());
+
+  ok &= frame.writePpm("dashboard.ppm");
+  Serial.printf("dashboard.ppm, RAM: komorki %u B + linie %u B zamiast ramki %u B\n", (unsigned)text.bytes(),
+                (unsigned)(VGA_LINE_BUFFERS * VGA_640x480_60.hTotal() * 2), 640u * 480u);
+  Serial.printf("%s\n", ok ? "wszystko OK" : "BLAD");
+}
+
+void loop() {
+  delay(10);
+}
+#endif
+
+#ifndef ARDUINO
+int main() {
+  setup();
+  return 0;
+}
+#endif
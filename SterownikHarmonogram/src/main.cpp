@@ -13,6 +13,8 @@
 #include <DNSServer.h>
 #include <EEPROM.h>
 #include <time.h>
+#include "../../myLib/SoftTimer.h"
+#include "../../myLib/IdleSleep.h"
 
 // ============================================================
 // KONFIGURACJA PINÓW
@@ -46,6 +48,14 @@
 #define NTP_SERVER1 "pool.ntp.org"
 #define NTP_SERVER2 "time.google.com"
 #define NTP_UPDATE_MS 600000 // 10 minut
+#define SCHEDULE_CHECK_MS 1000
+
+// ============================================================
+// KONFIGURACJA USYPIANIA PĘTLI
+// ============================================================
+#define IDLE_SLEEP 1             // 0 = stare delay(1), do porównania wybudzeń
+#define LOOP_MAX_SLEEP_MS 50     // maks. uśpienie loop(), WebServer musi być odpytywany
+#define IDLE_REPORT_MS 60000     // raport wybudzeń/s na Serial
 
 // ============================================================
 // STRUKTURA HARMONOGRAMU
@@ -76,9 +86,7 @@ ScheduleDay schedule[7]; // 0=Poniedziałek, 6=Niedziela
 bool relay1State = false;
 bool relay2State = false;
 
-unsigned long lastNTPUpdate = 0;
 unsigned long resetButtonPressTime = 0;
-unsigned long lastScheduleCheck = 0;
 
 const char *dayNamesShort[] = {"Pon", "Wt", "Sr", "Czw", "Pt", "Sob", "Ndz"};
 const char *dayNamesFull[] = {"Poniedzialek", "Wtorek", "Sroda", "Czwartek", "Piatek", "Sobota", "Niedziela"};
@@ -89,8 +97,10 @@ const char *dayNamesFull[] = {"Poniedzialek", "Wtorek", "Sroda", "Czwartek", "Pi
 void setupWiFi();
 void setupMDNS();
 void setupNTP();
+void updateNTP();
 void checkResetButton();
 void checkSchedule();
+void reportIdleStats();
 void setRelay(int relay, bool state);
 
 void saveWiFiCredentials();
@@ -117,6 +127,13 @@ String getFormattedTime();
 String getFormattedDate();
 int getCurrentDayOfWeek();
 
+// ============================================================
+// TIMERY
+// ============================================================
+SoftTimer timerNTP(NTP_UPDATE_MS, updateNTP, false);
+SoftTimer timerSchedule(SCHEDULE_CHECK_MS, checkSchedule, false);
+SoftTimer timerIdleReport(IDLE_REPORT_MS, reportIdleStats, false);
+
 // ============================================================
 // SETUP
 // ============================================================
@@ -191,6 +208,19 @@ void setup()
     }
     server.begin();
 
+    // Timery i usypianie pętli (light sleep z WiFi w modem sleep)
+    if (!isAPMode)
+    {
+        timerNTP.start();
+        timerSchedule.start();
+    }
+    timerIdleReport.start();
+#if IDLE_SLEEP
+    WiFi.setSleep(true);
+    if (!IdleSleep::instance().begin())
+        Serial.println(F("Light sleep not available, idle only"));
+#endif
+
     Serial.print(F("Free heap: "));
     Serial.println(ESP.getFreeHeap());
     Serial.println(F("System ready!"));
@@ -209,27 +239,14 @@ void loop()
     server.handleClient();
     checkResetButton();
 
-    if (!isAPMode)
-    {
-        // Aktualizacja NTP co 10 minut
-        if (millis() - lastNTPUpdate >= NTP_UPDATE_MS)
-        {
-            configTime(0, 0, NTP_SERVER1, NTP_SERVER2);
-            setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
-            tzset();
-            lastNTPUpdate = millis();
-            Serial.println(F("NTP updated"));
-        }
-
-        // Sprawdzanie harmonogramu co sekundę
-        if (millis() - lastScheduleCheck >= 1000)
-        {
-            checkSchedule();
-            lastScheduleCheck = millis();
-        }
-    }
+    // NTP co 10 minut i harmonogram co sekundę (tylko w trybie STA)
+    TimerService::instance().poll();
 
-    delay(1);
+#if IDLE_SLEEP
+    IdleSleep::instance().idle(LOOP_MAX_SLEEP_MS); // do najbliższego timera
+#else
+    IdleSleep::instance().idleFor(1);
+#endif
 }
 
 // ============================================================
@@ -318,7 +335,6 @@ void setupNTP()
     tzset();
 
     Serial.println(F("NTP configured for Europe/Warsaw"));
-    lastNTPUpdate = millis();
 
     // Czekaj na synchronizację
     int retry = 0;
@@ -333,6 +349,20 @@ void setupNTP()
     Serial.println(getFormattedTime());
 }
 
+// Aktualizacja NTP, wywoływana przez timerNTP
+void updateNTP()
+{
+    configTime(0, 0, NTP_SERVER1, NTP_SERVER2);
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+    Serial.println(F("NTP updated"));
+}
+
+void reportIdleStats()
+{
+    IdleSleep::instance().printStats(IdleSleep::instance().takeStats());
+}
+
 void checkResetButton()
 {
     if (digitalRead(RESET_HW_PIN) == LOW)
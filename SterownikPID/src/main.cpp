@@ -15,6 +15,13 @@
 #include <EEPROM.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include "../../myLib/SoftTimer.h"
+#include "../../myLib/IdleSleep.h"
+#include "../../myLib/RunningMedian.h"
+#include "../../myLib/Profiler.h"
+#include "../../myLib/GetTimeDiv.h"
+#include "../../myLib/Sampler.h"
+#include "../../myLib/HotPath.h"
 
 // ============================================================
 // KONFIGURACJA PINÓW (ESP32)
@@ -64,6 +71,14 @@
 #define PID_INTERVAL_MS 500
 #define HISTORY_SIZE 60
 #define HISTORY_INTERVAL_MS 2000
+#define TEMP_INTERVAL_MS 1000
+
+// ============================================================
+// KONFIGURACJA USYPIANIA PĘTLI
+// ============================================================
+#define IDLE_SLEEP 1             // 0 = stare delay(1), do porównania wybudzeń
+#define LOOP_MAX_SLEEP_MS 50     // maks. uśpienie loop(), WebServer musi być odpytywany
+#define IDLE_REPORT_MS 60000     // raport wybudzeń/s na Serial
 
 // ============================================================
 // ZMIENNE GLOBALNE
@@ -95,12 +110,38 @@ float pidIntegral = 0.0;
 float pidPrevError = 0.0;
 unsigned long pidLastTime = 0;
 
+// odrzucanie pojedynczych błędnych odczytów DS18B20, 85.0 (wartość po resecie
+// czujnika) odrzucana zawsze przez setRejectValue() w setup()
+HampelFilter<float, 5> tempFilter1(3.0f, 0.5f);
+HampelFilter<float, 5> tempFilter2(3.0f, 0.5f);
+
+// czasy obsługi żądań WWW i kroków sterowania (w cyklach CPU), /latency
+enum LatencyPoint
+{
+    LAT_ROOT,
+    LAT_API,
+    LAT_SET,
+    LAT_CHART,
+    LAT_TEMP,
+    LAT_PID,
+    LAT_COUNT
+};
+const char *const latencyNames[LAT_COUNT] = {"root", "api", "set", "chart", "temp", "pid"};
+LatencyHistogram latency[LAT_COUNT];
+
+// cykle liczone przy maksymalnym zegarze, inaczej DFS z IdleSleep (do 40 MHz)
+// zawyżałby czasy w ns; blokada zakładana przed startem pomiaru, zdejmowana po
+struct MeasuredSection
+{
+    IdleSleep::CpuMaxScope cpu;
+    LatencyScope scope;
+    explicit MeasuredSection(LatencyHistogram &h) : scope(h) {}
+};
+
 float tempHistory1[HISTORY_SIZE];
 float tempHistory2[HISTORY_SIZE];
 int historyIndex = 0;
-unsigned long lastHistoryUpdate = 0;
 
-unsigned long lastTempRead = 0;
 unsigned long resetButtonPressTime = 0;
 
 // ============================================================
@@ -112,6 +153,8 @@ void setupPWM();
 void checkResetButton();
 void readTemperatures();
 void runPIDController();
+void updateHistory();
+void reportIdleStats();
 void setFanPWM(int percent);
 
 void saveWiFiCredentials();
@@ -127,9 +170,19 @@ void handleAPI();
 void handleSet();
 void handleReset();
 void handleChart();
+void handleTimers();
+void handleLatency();
 void handleCaptivePortal();
 void handleNotFound();
 
+// ============================================================
+// TIMERY
+// ============================================================
+SoftTimer timerTemperatures(TEMP_INTERVAL_MS, readTemperatures, false);
+SoftTimer timerHistory(HISTORY_INTERVAL_MS, updateHistory, false);
+SoftTimer timerPID(PID_INTERVAL_MS, runPIDController, false, TIMER_FIXED_RATE); // tylko gdy pidRunning
+SoftTimer timerIdleReport(IDLE_REPORT_MS, reportIdleStats, false);
+
 // ============================================================
 // SETUP
 // ============================================================
@@ -153,6 +206,8 @@ void setup()
     sensor2.setResolution(12);
     sensor1.setWaitForConversion(false);
     sensor2.setWaitForConversion(false);
+    tempFilter1.setRejectValue(85.0f);
+    tempFilter2.setRejectValue(85.0f);
 
     Serial.print(F("DS1 sensors found: "));
     Serial.println(sensor1.getDeviceCount());
@@ -212,11 +267,32 @@ void setup()
         server.on("/set", HTTP_POST, handleSet);
         server.on("/reset", HTTP_POST, handleReset);
         server.on("/chart", HTTP_GET, handleChart);
+        server.on("/timers", HTTP_GET, handleTimers);
+        server.on("/latency", HTTP_GET, handleLatency);
         server.onNotFound([]()
                           { server.send(404, "text/plain", "Not Found"); });
     }
     server.begin();
 
+#if SAMPLER_ENABLED
+    // próbkowanie rdzenia loop(), timer trzyma blokadę PM - bez light sleep
+    if (!Sampler::instance().begin())
+        Serial.println(F("Sampler timer not available"));
+#endif
+
+    Serial.print(F("runPIDController: "));
+    Serial.println(hotPathInIram((const void *)runPIDController) ? F("IRAM") : F("flash"));
+
+    // Timery i usypianie pętli (light sleep z WiFi w modem sleep)
+    timerTemperatures.start();
+    timerHistory.start();
+    timerIdleReport.start();
+#if IDLE_SLEEP
+    WiFi.setSleep(true);
+    if (!IdleSleep::instance().begin())
+        Serial.println(F("Light sleep not available, idle only"));
+#endif
+
     Serial.print(F("Free heap: "));
     Serial.println(ESP.getFreeHeap());
     Serial.println(F("System ready!"));
@@ -232,33 +308,46 @@ void loop()
         dnsServer.processNextRequest();
     }
 
-    server.handleClient();
-    checkResetButton();
-
-    if (millis() - lastTempRead >= 1000)
     {
-        readTemperatures();
-        lastTempRead = millis();
+        PROFILE_ZONE("handleClient");
+        server.handleClient();
     }
+    checkResetButton();
 
-    if (millis() - lastHistoryUpdate >= HISTORY_INTERVAL_MS)
+#if PROFILER_ENABLED || SAMPLER_ENABLED
+    if (Serial.available())
     {
-        tempHistory1[historyIndex] = tempDS1;
-        tempHistory2[historyIndex] = tempDS2;
-        historyIndex = (historyIndex + 1) % HISTORY_SIZE;
-        lastHistoryUpdate = millis();
+        int cmd = Serial.read();
+#if PROFILER_ENABLED
+        // 't': zrzut śladu, zapisać jako .json i otworzyć w ui.perfetto.dev
+        if (cmd == 't')
+            Profiler::instance().dumpChromeTrace(Serial);
+#endif
+#if SAMPLER_ENABLED
+        // 's': histogram próbek dla myLib/tools/sampler_symbolize.py, 'r': nowy pomiar
+        if (cmd == 's')
+            Sampler::instance().dump(Serial);
+        if (cmd == 'r')
+            Sampler::instance().reset();
+#endif
     }
+#endif
 
-    if (pidRunning)
+    // odczyt temperatur, historia i PID
     {
-        runPIDController();
+        PROFILE_ZONE("timers");
+        TimerService::instance().poll();
     }
 
     // Wyjścia
     setFanPWM(fanPWM);
     digitalWrite(PUMP_PIN, (pidRunning && pumpState) ? HIGH : LOW);
 
-    delay(1);
+#if IDLE_SLEEP
+    IdleSleep::instance().idle(LOOP_MAX_SLEEP_MS); // do najbliższego timera
+#else
+    IdleSleep::instance().idleFor(1);
+#endif
 }
 
 // ============================================================
@@ -378,25 +467,40 @@ void checkResetButton()
 
 void readTemperatures()
 {
+    PROFILE_ZONE("readTemperatures");
+    MeasuredSection latencyScope(latency[LAT_TEMP]);
     sensor1.requestTemperatures();
     sensor2.requestTemperatures();
 
     float t1 = sensor1.getTempCByIndex(0);
     float t2 = sensor2.getTempCByIndex(0);
 
+    // 85.0 odrzucone zawsze, także jako pierwszy odczyt - zostaje poprzednia wartość
     if (t1 != DEVICE_DISCONNECTED_C && t1 > -50 && t1 < 150)
-        tempDS1 = t1;
+    {
+        float f = tempFilter1.update(t1);
+        if (tempFilter1.ready())
+            tempDS1 = f;
+    }
     if (t2 != DEVICE_DISCONNECTED_C && t2 > -50 && t2 < 150)
-        tempDS2 = t2;
+    {
+        float f = tempFilter2.update(t2);
+        if (tempFilter2.ready())
+            tempDS2 = f;
+    }
 }
 
-void runPIDController()
+// wywoływany przez timerPID co PID_INTERVAL_MS, dt liczone z rzeczywistego odstępu,
+// przy -DHOTPATH_IRAM=1 w IRAM, nie czeka na cache po obsłudze żądań WWW
+HOT_FN void runPIDController()
 {
+    PROFILE_ZONE("runPIDController");
+    MeasuredSection latencyScope(latency[LAT_PID]);
     unsigned long now = millis();
-    if (now - pidLastTime < PID_INTERVAL_MS)
+    if (now == pidLastTime)
         return;
 
-    float dt = (now - pidLastTime) / 1000.0;
+    float dt = (now - pidLastTime) / 1000.0f; // 1000.0 to programowy double we flash
     pidLastTime = now;
 
     float error = tempDS1 - tempSetpoint;
@@ -421,6 +525,25 @@ void runPIDController()
     fanPWM = constrain((int)output, 0, 100);
 }
 
+void updateHistory()
+{
+    tempHistory1[historyIndex] = tempDS1;
+    tempHistory2[historyIndex] = tempDS2;
+    historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+}
+
+void reportIdleStats()
+{
+    IdleSleep::instance().printStats(IdleSleep::instance().takeStats());
+#if SOFTTIMER_STATS
+    // spóźnienia w us względem terminu, czy ruch WWW nie psuje kadencji PID
+    timerPID.getLateness().print(Serial, "PID");
+    timerTemperatures.getLateness().print(Serial, "Temp");
+#endif
+    for (int i = 0; i < LAT_COUNT; i++)
+        GetTimeDiv::summaryNanos(latency[i]).print(Serial, latencyNames[i]);
+}
+
 // ============================================================
 // EEPROM
 // ============================================================
@@ -604,6 +727,7 @@ void handleConnect()
 // ============================================================
 void handleAPI()
 {
+    MeasuredSection latencyScope(latency[LAT_API]);
     String json = "{\"ds1\":" + String(tempDS1, 2) +
                   ",\"ds2\":" + String(tempDS2, 2) +
                   ",\"fan\":" + String(fanPWM) +
@@ -620,6 +744,7 @@ void handleAPI()
 
 void handleSet()
 {
+    MeasuredSection latencyScope(latency[LAT_SET]);
     bool settingsChanged = false;
 
     if (server.hasArg("running"))
@@ -634,9 +759,13 @@ void handleSet()
                 pidIntegral = 0;
                 pidPrevError = 0;
                 pidLastTime = millis();
+                timerPID.start();
+                IdleSleep::instance().holdAwake(true); // LEDC nie działa w light sleep
             }
             else
             {
+                timerPID.stop();
+                IdleSleep::instance().holdAwake(false);
                 pumpState = false;
                 fanPWM = 0;
                 ledcWrite(LEDC_CHANNEL, 0);
@@ -697,6 +826,7 @@ void handleReset()
 
 void handleChart()
 {
+    MeasuredSection latencyScope(latency[LAT_CHART]);
     String json = "{\"ds1\":[";
     for (int i = 0; i < HISTORY_SIZE; i++)
     {
@@ -717,6 +847,47 @@ void handleChart()
     server.send(200, "application/json", json);
 }
 
+// statystyka spóźnień timerów, /timers?reset=1 zeruje po odczycie
+void handleTimers()
+{
+#if SOFTTIMER_STATS
+    char buf[TIMER_STATS_JSON_BYTES];
+    String json = "{\"pidIntervalMs\":" + String(PID_INTERVAL_MS) +
+                  ",\"pidMissed\":" + String(timerPID.getMissedTicks());
+    timerPID.getLateness().toJson(buf, sizeof(buf));
+    json += ",\"pid\":" + String(buf);
+    timerTemperatures.getLateness().toJson(buf, sizeof(buf));
+    json += ",\"temp\":" + String(buf) + "}";
+    if (server.hasArg("reset"))
+    {
+        timerPID.resetLateness();
+        timerTemperatures.resetLateness();
+    }
+    server.send(200, "application/json", json);
+#else
+    server.send(200, "application/json", "{\"enabled\":false}");
+#endif
+}
+
+// czasy obsługi w ns (p50/p90/p99/p99.9), /latency?reset=1 zaczyna nowe okno
+void handleLatency()
+{
+    char buf[192];
+    bool reset = server.hasArg("reset");
+    String json = "{";
+    for (int i = 0; i < LAT_COUNT; i++)
+    {
+        GetTimeDiv::summaryNanos(latency[i]).toJson(buf, sizeof(buf));
+        if (reset)
+            latency[i].reset();
+        if (i > 0)
+            json += ",";
+        json += "\"" + String(latencyNames[i]) + "\":" + String(buf);
+    }
+    json += "}";
+    server.send(200, "application/json", json);
+}
+
 // ============================================================
 // STRONA GŁÓWNA - CSS (w PROGMEM dla oszczędności RAM)
 // ============================================================
@@ -898,6 +1069,7 @@ alert('Urzadzenie restartuje...');});}}
 // ============================================================
 void handleRoot()
 {
+    MeasuredSection latencyScope(latency[LAT_ROOT]);
     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
     server.send(200, "text/html", "");
 
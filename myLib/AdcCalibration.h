@@ -0,0 +1,245 @@
+#ifndef AdcCalibration_h
+#define AdcCalibration_h
+
+#include "Platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------
+// Przeliczanie surowego odczytu ADC (12 bit) na mV tablicą zamiast
+// wzoru kalibracji przy każdym odczycie (analogReadMilliVolts() liczy
+// go za każdym razem z eFuse).
+//
+// begin() raz przy starcie przechodzi przez wszystkie 4096 kodów dla
+// każdej używanej tłumienności i zapisuje wynik kalibracji IDF
+// (IDF 5 adc_cali: line fitting na ESP32, curve fitting na C3/S3;
+// IDF 4 esp_adc_cal na ESP32; w pozostałych przypadkach lineFitting()):
+// - segmentShift = 0: pełna tablica 4096 x uint16_t (8 KB na
+//   tłumienność), przeliczenie to jeden odczyt z tablicy
+// - segmentShift = s: węzły co 2^s kodów, (4096 >> s) + 1 wartości,
+//   interpolacja liniowa, np. s = 6: 130 B i błąd do 2 mV
+//
+// Tłumienność pinu ustawia setPinAttenuation() (woła też
+// analogSetPinAttenuation(), oprócz pinów AdcStream - te należą do
+// sterownika DMA), budowane są tabele tłumienności przypisanych do
+// pinów i zawsze 11 dB - domyślna dla pozostałych pinów, jak w Arduino.
+// Tabela, której nie zbudowano, zwraca 0 mV.
+//
+// lineFitting() to wzór liniowy ESP32 z esp_adc_cal (Vref z eFuse,
+// domyślnie 1100 mV), na PC służy za wzorzec do sprawdzenia błędu tablic.
+// ---------------------------------------------------------------
+
+#define ADC_CAL_CODES 4096
+#define ADC_CAL_ATTENS 4
+
+// numer GPIO < ADC_CAL_PINS (S3 ma GPIO do 48)
+#ifndef ADC_CAL_PINS
+#define ADC_CAL_PINS 49
+#endif
+
+#ifdef ARDUINO
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#define ADC_CAL_IDF 5
+#elif CONFIG_IDF_TARGET_ESP32
+#include "esp_adc_cal.h"
+#define ADC_CAL_IDF 4
+#endif
+#endif
+
+#ifndef ADC_CAL_IDF
+#define ADC_CAL_IDF 0
+#endif
+
+// mV dla surowego kodu przy danej tłumienności, ctx z begin()
+typedef int32_t (*AdcReferenceFn)(uint16_t raw, uint8_t atten, void *ctx);
+
+class AdcCalTable {
+private:
+  uint16_t *points;
+  uint8_t shift;
+
+public:
+  AdcCalTable() : points(nullptr), shift(0) {}
+
+  ~AdcCalTable() {
+    free(points);
+  }
+
+  AdcCalTable(const AdcCalTable &) = delete;
+  AdcCalTable &operator=(const AdcCalTable &) = delete;
+
+  static uint32_t entriesFor(uint8_t segmentShift) {
+    return segmentShift ? (ADC_CAL_CODES >> segmentShift) + 1 : ADC_CAL_CODES;
+  }
+
+  // węzeł za ostatnim kodem (4096) z nachylenia na końcu zakresu
+  bool build(AdcReferenceFn fn, uint8_t atten, void *ctx, uint8_t segmentShift) {
+    if (segmentShift > 10) return false;
+    uint32_t n = entriesFor(segmentShift);
+    uint16_t *p = (uint16_t *)realloc(points, n * sizeof(uint16_t));
+    if (!p) return false;
+    points = p;
+    shift = segmentShift;
+    for (uint32_t i = 0; i < n; i++) {
+      uint32_t raw = i << shift;
+      int32_t mv = raw < ADC_CAL_CODES ? fn((uint16_t)raw, atten, ctx)
+                                       : 2 * fn(ADC_CAL_CODES - 1, atten, ctx) - fn(ADC_CAL_CODES - 2, atten, ctx);
+      points[i] = (uint16_t)(mv < 0 ? 0 : mv > 0xFFFF ? 0xFFFF : mv);
+    }
+    return true;
+  }
+
+  bool ready() const {
+    return points != nullptr;
+  }
+
+  uint8_t getShift() const {
+    return shift;
+  }
+
+  uint32_t bytes() const {
+    return points ? entriesFor(shift) * sizeof(uint16_t) : 0;
+  }
+
+  uint16_t toMilliVolts(uint16_t raw) const {
+    if (!points) return 0;
+    raw &= ADC_CAL_CODES - 1;
+    if (!shift) return points[raw];
+    uint32_t k = raw >> shift;
+    uint32_t frac = raw & ((1u << shift) - 1);
+    int32_t a = points[k];
+    int32_t b = points[k + 1];
+    return (uint16_t)(a + (((b - a) * (int32_t)frac + (1 << (shift - 1))) >> shift));
+  }
+};
+
+class AdcCalibration {
+private:
+  AdcCalTable tables[ADC_CAL_ATTENS];
+  uint8_t pinAtten[ADC_CAL_PINS];
+  uint8_t used;  // bity tłumienności przypisanych do pinów, 11 dB zawsze
+
+#if ADC_CAL_IDF == 5
+  static int32_t caliReference(uint16_t raw, uint8_t, void *ctx) {
+    int mv = 0;
+    adc_cali_raw_to_voltage(*(adc_cali_handle_t *)ctx, raw, &mv);
+    return mv;
+  }
+#elif ADC_CAL_IDF == 4
+  static int32_t caliReference(uint16_t raw, uint8_t, void *ctx) {
+    return (int32_t)esp_adc_cal_raw_to_voltage(raw, (const esp_adc_cal_characteristics_t *)ctx);
+  }
+#else
+  static int32_t lineReference(uint16_t raw, uint8_t atten, void *) {
+    return lineFitting(raw, atten);
+  }
+#endif
+
+public:
+  AdcCalibration() : used(1 << 3) {
+    memset(pinAtten, 3, sizeof(pinAtten));
+  }
+
+  // atten 0..3 = 0 / 2.5 / 6 / 11 dB (adc_attenuation_t), przed begin();
+  // oneshot = false dla pinów AdcStream (tylko wybór tablicy)
+  void setPinAttenuation(uint8_t pin, uint8_t atten, bool oneshot = true) {
+    if (pin >= ADC_CAL_PINS || atten >= ADC_CAL_ATTENS) return;
+    pinAtten[pin] = atten;
+    used |= 1 << atten;
+#ifdef ARDUINO
+    if (oneshot) analogSetPinAttenuation(pin, (adc_attenuation_t)atten);
+#else
+    (void)oneshot;
+#endif
+  }
+
+  uint8_t attenuationOf(uint8_t pin) const {
+    return pin < ADC_CAL_PINS ? pinAtten[pin] : 3;
+  }
+
+  // tabele z dowolnego wzorca (na PC, testy)
+  bool begin(AdcReferenceFn fn, void *ctx, uint8_t segmentShift = 0) {
+    for (uint8_t a = 0; a < ADC_CAL_ATTENS; a++)
+      if ((used & (1 << a)) && !tables[a].build(fn, a, ctx, segmentShift)) return false;
+    return true;
+  }
+
+#if ADC_CAL_IDF == 5
+  // tabele z kalibracji IDF dla ADC1
+  bool begin(uint8_t segmentShift = 0) {
+    for (uint8_t a = 0; a < ADC_CAL_ATTENS; a++) {
+      if (!(used & (1 << a))) continue;
+      adc_cali_handle_t handle = nullptr;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+      adc_cali_curve_fitting_config_t cfg = {};
+      cfg.unit_id = ADC_UNIT_1;
+      cfg.atten = (adc_atten_t)a;
+      cfg.bitwidth = ADC_BITWIDTH_12;
+      if (adc_cali_create_scheme_curve_fitting(&cfg, &handle) != ESP_OK) return false;
+      bool ok = tables[a].build(caliReference, a, &handle, segmentShift);
+      adc_cali_delete_scheme_curve_fitting(handle);
+#else
+      adc_cali_line_fitting_config_t cfg = {};
+      cfg.unit_id = ADC_UNIT_1;
+      cfg.atten = (adc_atten_t)a;
+      cfg.bitwidth = ADC_BITWIDTH_12;
+#if CONFIG_IDF_TARGET_ESP32
+      cfg.default_vref = 1100;  // układy bez Vref w eFuse, jak w ścieżce IDF 4
+#endif
+      if (adc_cali_create_scheme_line_fitting(&cfg, &handle) != ESP_OK) return false;
+      bool ok = tables[a].build(caliReference, a, &handle, segmentShift);
+      adc_cali_delete_scheme_line_fitting(handle);
+#endif
+      if (!ok) return false;
+    }
+    return true;
+  }
+#elif ADC_CAL_IDF == 4
+  // tabele z esp_adc_cal (Vref z eFuse, bez niego 1100 mV)
+  bool begin(uint8_t segmentShift = 0) {
+    for (uint8_t a = 0; a < ADC_CAL_ATTENS; a++) {
+      if (!(used & (1 << a))) continue;
+      esp_adc_cal_characteristics_t chars;
+      esp_adc_cal_characterize(ADC_UNIT_1, (adc_atten_t)a, ADC_WIDTH_BIT_12, 1100, &chars);
+      if (!tables[a].build(caliReference, a, &chars, segmentShift)) return false;
+    }
+    return true;
+  }
+#else
+  bool begin(uint8_t segmentShift = 0) {
+    return begin(lineReference, nullptr, segmentShift);
+  }
+#endif
+
+  const AdcCalTable &table(uint8_t atten) const {
+    return tables[atten & 3];
+  }
+
+  // tabela tłumienności pinu, np. do przeliczania całych ramek
+  const AdcCalTable &tableFor(uint8_t pin) const {
+    return tables[attenuationOf(pin)];
+  }
+
+  uint16_t toMilliVolts(uint8_t pin, uint16_t raw) const {
+    return tableFor(pin).toMilliVolts(raw);
+  }
+
+  uint32_t bytes() const {
+    uint32_t b = 0;
+    for (uint8_t a = 0; a < ADC_CAL_ATTENS; a++) b += tables[a].bytes();
+    return b;
+  }
+
+  // wzór liniowy ESP32 (esp_adc_cal, Vref z eFuse): mV = raw * A / 65536 + B
+  static int32_t lineFitting(uint16_t raw, uint8_t atten, uint32_t vrefMv = 1100) {
+    static const uint32_t SCALE[ADC_CAL_ATTENS] = {57431, 76236, 105481, 196602};
+    static const uint32_t OFFSET[ADC_CAL_ATTENS] = {75, 78, 107, 142};
+    uint32_t a = vrefMv * SCALE[atten & 3] / ADC_CAL_CODES;
+    return (int32_t)((a * raw + 32768) / 65536 + OFFSET[atten & 3]);
+  }
+};
+
+#endif // AdcCalibration_h
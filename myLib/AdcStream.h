@@ -0,0 +1,513 @@
+#ifndef AdcStream_h
+#define AdcStream_h
+
+#include "Platform.h"
+#include <string.h>
+
+// ---------------------------------------------------------------
+// Ciągłe próbkowanie ADC1 przez DMA (adc_continuous z IDF 5, na
+// klasycznym ESP32 sterownik używa I2S0, na S2 DMA SPI3, na C3/S3 GDMA).
+// Układ próbki w DMA zależy od układu (AdcSampleFormat), obsługiwane
+// są ESP32, S2, S3 i C3 - na innych ADC_STREAM_SUPPORTED = 0.
+// Lista kanałów jest skanowana w kółko z zadaną łączną częstotliwością
+// (ESP32: 20 kS/s .. 2 MS/s), bez udziału CPU na pojedynczą próbkę.
+//
+// Przepływ: przerwanie "ramka gotowa" budzi task czytający, ten wpisuje
+// ramkę wprost do wolnego bufora z puli (AdcFramePool) i przekazuje
+// wskaźnik konsumentowi. Konsument dostaje ramkę przez receive(),
+// przetwarza ją w miejscu i oddaje przez release() - między taskami nic
+// nie jest kopiowane (sam sterownik IDF kopiuje DMA do swojego
+// ringbuffera, tego się przez API nie obejdzie).
+//
+// Straty są liczone osobno:
+// - dropped   - brak wolnej ramki w puli, konsument nie nadąża
+// - overflows - przepełnienie ringbuffera sterownika, task czytający
+//               nie nadąża (albo długo zablokowany)
+// Numer ramki rośnie też dla odrzuconych, przeskok w sequence u
+// konsumenta to dziura w danych.
+//
+// AdcFrame, AdcIndexRing, AdcFramePool i AdcChannelAccumulator nie
+// zależą od sprzętu i działają na PC.
+// ---------------------------------------------------------------
+
+// ramek w puli (w tym jedna zwykle u konsumenta), maks. 255
+#ifndef ADC_STREAM_FRAMES
+#define ADC_STREAM_FRAMES 4
+#endif
+
+#ifndef ADC_STREAM_MAX_CHANNELS
+#define ADC_STREAM_MAX_CHANNELS 8
+#endif
+
+#ifndef ADC_STREAM_TASK_PRIORITY
+#define ADC_STREAM_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#endif
+
+#ifndef ADC_STREAM_TASK_STACK
+#define ADC_STREAM_TASK_STACK 3072
+#endif
+
+#ifdef ARDUINO
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5 && (CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || \
+                                    CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32C3)
+#include "esp_adc/adc_continuous.h"
+#include "esp_heap_caps.h"
+#define ADC_STREAM_SUPPORTED 1
+#if CONFIG_IDF_TARGET_ESP32
+#define ADC_STREAM_FORMAT ADC_SAMPLE_TYPE1
+#elif CONFIG_IDF_TARGET_ESP32S2
+#define ADC_STREAM_FORMAT ADC_SAMPLE_TYPE2_S2
+#elif CONFIG_IDF_TARGET_ESP32S3
+#define ADC_STREAM_FORMAT ADC_SAMPLE_TYPE2_S3
+#else
+#define ADC_STREAM_FORMAT ADC_SAMPLE_TYPE2
+#endif
+#endif
+#endif
+
+#ifndef ADC_STREAM_SUPPORTED
+#define ADC_STREAM_SUPPORTED 0
+#endif
+
+// format wyniku DMA (adc_digi_output_data_t z IDF):
+// TYPE1    (ESP32) 2 B, dane 12 bit, kanał 4 bit od bitu 12
+// TYPE2_S2 (S2)    2 B, dane 11 bit, kanał 4 bit od bitu 11, ADC bit 15;
+//                  wartość przesunięta o 1 bit do skali 0..4095
+// TYPE2    (C3)    4 B, dane 12 bit, kanał 3 bit od bitu 13, ADC bit 16
+// TYPE2_S3 (S3)    4 B, dane 12 bit, kanał 4 bit od bitu 13, ADC bit 17
+enum AdcSampleFormat {
+  ADC_SAMPLE_TYPE1,
+  ADC_SAMPLE_TYPE2,
+  ADC_SAMPLE_TYPE2_S2,
+  ADC_SAMPLE_TYPE2_S3
+};
+
+struct AdcSample {
+  uint16_t value;
+  uint8_t channel;
+  uint8_t unit;  // 0 = ADC1
+};
+
+struct AdcFrame {
+  uint8_t *data;
+  uint32_t bytes;        // ważnych bajtów
+  uint32_t sequence;     // numer ramki od begin(), razem z odrzuconymi
+  uint64_t firstSample;  // numer pierwszej próbki od begin()
+  uint64_t timeUs;       // odczyt ze sterownika, micros64()
+  AdcSampleFormat format;
+
+  static constexpr uint32_t sampleBytes(AdcSampleFormat f) {
+    return f == ADC_SAMPLE_TYPE1 || f == ADC_SAMPLE_TYPE2_S2 ? 2 : 4;
+  }
+
+  static AdcSample decode(const uint8_t *p, AdcSampleFormat f) {
+    AdcSample s;
+    if (sampleBytes(f) == 2) {
+      uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+      if (f == ADC_SAMPLE_TYPE1) {
+        s.value = v & 0x0FFF;
+        s.channel = (uint8_t)(v >> 12);
+        s.unit = 0;
+      } else {
+        s.value = (uint16_t)((v & 0x07FF) << 1);
+        s.channel = (uint8_t)((v >> 11) & 0x0F);
+        s.unit = (uint8_t)(v >> 15);
+      }
+    } else {
+      uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+      s.value = (uint16_t)(v & 0x0FFF);
+      if (f == ADC_SAMPLE_TYPE2_S3) {
+        s.channel = (uint8_t)((v >> 13) & 0x0F);
+        s.unit = (uint8_t)((v >> 17) & 0x01);
+      } else {
+        s.channel = (uint8_t)((v >> 13) & 0x07);
+        s.unit = (uint8_t)((v >> 16) & 0x01);
+      }
+    }
+    return s;
+  }
+
+  uint32_t count() const {
+    return bytes / sampleBytes(format);
+  }
+
+  AdcSample at(uint32_t i) const {
+    return decode(data + i * sampleBytes(format), format);
+  }
+};
+
+// kolejka indeksów jeden producent / jeden konsument, bez blokad
+template <uint32_t N>
+class AdcIndexRing {
+private:
+  uint8_t items[N];
+  uint32_t head;  // pisze tylko producent
+  uint32_t tail;  // pisze tylko konsument
+
+public:
+  AdcIndexRing() : head(0), tail(0) {}
+
+  void clear() {
+    head = tail = 0;
+  }
+
+  bool push(uint8_t v) {
+    uint32_t h = head;
+    if (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == N) return false;
+    items[h % N] = v;
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  bool pop(uint8_t &v) {
+    uint32_t t = tail;
+    if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t) return false;
+    v = items[t % N];
+    __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  uint32_t size() const {
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  }
+};
+
+// ramki krążą: wolne -> producent -> gotowe -> konsument -> wolne
+class AdcFramePool {
+private:
+  AdcFrame frames[ADC_STREAM_FRAMES];
+  AdcIndexRing<ADC_STREAM_FRAMES> freeFrames;
+  AdcIndexRing<ADC_STREAM_FRAMES> readyFrames;
+  uint32_t frameBytes;
+
+  uint8_t indexOf(const AdcFrame *f) const {
+    return (uint8_t)(f - frames);
+  }
+
+public:
+  AdcFramePool() : frameBytes(0) {
+    memset(frames, 0, sizeof(frames));
+  }
+
+  // memory na ADC_STREAM_FRAMES * bytes
+  void begin(uint8_t *memory, uint32_t bytes, AdcSampleFormat format) {
+    frameBytes = bytes;
+    freeFrames.clear();
+    readyFrames.clear();
+    for (uint32_t i = 0; i < ADC_STREAM_FRAMES; i++) {
+      frames[i].data = memory + i * bytes;
+      frames[i].bytes = 0;
+      frames[i].format = format;
+      freeFrames.push((uint8_t)i);
+    }
+  }
+
+  uint32_t getFrameBytes() const {
+    return frameBytes;
+  }
+
+  // producent: wolna ramka albo nullptr, gdy konsument trzyma wszystkie
+  AdcFrame *acquire() {
+    uint8_t i;
+    return freeFrames.pop(i) ? &frames[i] : nullptr;
+  }
+
+  void publish(AdcFrame *f) {
+    readyFrames.push(indexOf(f));
+  }
+
+  // konsument: najstarsza gotowa ramka albo nullptr
+  AdcFrame *take() {
+    uint8_t i;
+    return readyFrames.pop(i) ? &frames[i] : nullptr;
+  }
+
+  void release(const AdcFrame *f) {
+    freeFrames.push(indexOf(f));
+  }
+
+  uint32_t readyCount() const {
+    return readyFrames.size();
+  }
+};
+
+struct AdcStreamStats {
+  uint32_t frames;     // ramki przekazane konsumentowi
+  uint32_t samples;
+  uint32_t dropped;    // ramki odrzucone, brak wolnej ramki
+  uint32_t overflows;  // przepełnienia sterownika
+  uint32_t maxReady;   // najwięcej ramek czekających na konsumenta
+  uint32_t elapsedUs;  // od poprzedniego takeStats()
+
+  uint32_t samplesPerSecond() const {
+    return elapsedUs ? (uint32_t)((uint64_t)samples * 1000000 / elapsedUs) : 0;
+  }
+
+  template <class Out>
+  void print(Out &out, const char *name) const {
+    out.printf("%s: %u ramek, %u S/s, odrzucone %u, przepelnienia %u, max w kolejce %u\n", name, (unsigned)frames,
+               (unsigned)samplesPerSecond(), (unsigned)dropped, (unsigned)overflows, (unsigned)maxReady);
+  }
+};
+
+// suma, min i max na kanał z ramek, bez kopiowania próbek
+class AdcChannelAccumulator {
+private:
+  uint32_t sum[16];
+  uint32_t n[16];
+  uint16_t lo[16];
+  uint16_t hi[16];
+
+public:
+  AdcChannelAccumulator() {
+    reset();
+  }
+
+  void reset() {
+    memset(sum, 0, sizeof(sum));
+    memset(n, 0, sizeof(n));
+    memset(lo, 0xFF, sizeof(lo));
+    memset(hi, 0, sizeof(hi));
+  }
+
+  void add(const AdcFrame &f) {
+    uint32_t count = f.count();
+    for (uint32_t i = 0; i < count; i++) {
+      AdcSample s = f.at(i);
+      uint8_t c = s.channel & 0x0F;
+      sum[c] += s.value;
+      n[c]++;
+      if (s.value < lo[c]) lo[c] = s.value;
+      if (s.value > hi[c]) hi[c] = s.value;
+    }
+  }
+
+  uint32_t count(uint8_t channel) const {
+    return n[channel & 0x0F];
+  }
+
+  uint16_t mean(uint8_t channel) const {
+    uint8_t c = channel & 0x0F;
+    return n[c] ? (uint16_t)((sum[c] + n[c] / 2) / n[c]) : 0;
+  }
+
+  uint16_t minimum(uint8_t channel) const {
+    return n[channel & 0x0F] ? lo[channel & 0x0F] : 0;
+  }
+
+  uint16_t maximum(uint8_t channel) const {
+    return hi[channel & 0x0F];
+  }
+};
+
+struct AdcStreamConfig {
+  int8_t pins[ADC_STREAM_MAX_CHANNELS];  // GPIO z ADC1, w kolejności skanowania
+  uint8_t channels;
+  uint32_t sampleHz;      // konwersji na sekundę, łącznie dla wszystkich kanałów
+  uint32_t frameSamples;  // próbek w ramce, wielokrotność channels
+  uint8_t atten[ADC_STREAM_MAX_CHANNELS];  // na kanał, 0..3 = 0 / 2.5 / 6 / 11 (12) dB
+};
+
+#if ADC_STREAM_SUPPORTED
+class AdcStream {
+private:
+  AdcStreamConfig config;
+  adc_continuous_handle_t handle;
+  AdcFramePool pool;
+  AdcSampleFormat format;
+  uint8_t *memory;
+  uint8_t *scratch;  // ramka do opróżnienia sterownika, gdy pula jest pusta
+  TaskHandle_t reader;
+  TaskHandle_t consumer;
+  volatile bool running;
+  uint32_t sequence;
+  uint64_t samplesRead;
+  AdcStreamStats stats;
+  uint32_t statsTime;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+  static bool IRAM_ATTR onConvDone(adc_continuous_handle_t, const adc_continuous_evt_data_t *, void *arg) {
+    AdcStream *s = (AdcStream *)arg;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s->reader, &woken);
+    return woken == pdTRUE;
+  }
+
+  static bool IRAM_ATTR onPoolOverflow(adc_continuous_handle_t, const adc_continuous_evt_data_t *, void *arg) {
+    AdcStream *s = (AdcStream *)arg;
+    portENTER_CRITICAL_ISR(&s->mux);
+    s->stats.overflows++;
+    portEXIT_CRITICAL_ISR(&s->mux);
+    return false;
+  }
+
+  static void readerTask(void *arg) {
+    AdcStream *s = (AdcStream *)arg;
+    while (1) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      while (s->running) {
+        AdcFrame *f = s->pool.acquire();
+        uint8_t *dst = f ? f->data : s->scratch;
+        uint32_t n = 0;
+        if (adc_continuous_read(s->handle, dst, s->pool.getFrameBytes(), &n, 0) != ESP_OK || !n) {
+          if (f) s->pool.release(f);
+          break;
+        }
+        uint32_t samples = n / AdcFrame::sampleBytes(s->format);
+        if (f) {
+          f->bytes = n;
+          f->sequence = s->sequence;
+          f->firstSample = s->samplesRead;
+          f->timeUs = micros64();
+          s->pool.publish(f);
+        }
+        s->sequence++;
+        s->samplesRead += samples;
+
+        portENTER_CRITICAL(&s->mux);
+        if (f) {
+          s->stats.frames++;
+          s->stats.samples += samples;
+          uint32_t ready = s->pool.readyCount();
+          if (ready > s->stats.maxReady) s->stats.maxReady = ready;
+        } else {
+          s->stats.dropped++;
+        }
+        portEXIT_CRITICAL(&s->mux);
+        if (f && s->consumer) xTaskNotifyGive(s->consumer);
+      }
+    }
+  }
+
+  void releaseMemory() {
+    heap_caps_free(memory);
+    heap_caps_free(scratch);
+    memory = nullptr;
+    scratch = nullptr;
+  }
+
+public:
+  AdcStream()
+      : handle(nullptr), format(ADC_SAMPLE_TYPE1), memory(nullptr), scratch(nullptr), reader(nullptr),
+        consumer(nullptr), running(false), sequence(0), samplesRead(0), stats(), statsTime(0) {
+    memset(&config, 0, sizeof(config));
+  }
+
+  AdcStream(const AdcStream &) = delete;
+  AdcStream &operator=(const AdcStream &) = delete;
+
+  bool begin(const AdcStreamConfig &cfg) {
+    config = cfg;
+    if (!config.channels || config.channels > ADC_STREAM_MAX_CHANNELS || config.channels > SOC_ADC_PATT_LEN_MAX)
+      return false;
+    static_assert(sizeof(adc_digi_output_data_t) == AdcFrame::sampleBytes(ADC_STREAM_FORMAT),
+                  "rozmiar probki DMA niezgodny z AdcSampleFormat");
+    format = ADC_STREAM_FORMAT;
+#if CONFIG_IDF_TARGET_ESP32
+    adc_digi_output_format_t digiFormat = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+#else
+    adc_digi_output_format_t digiFormat = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+#endif
+    // całe skany kanałów i wielokrotność 4 B (SOC_ADC_DIGI_DATA_BYTES_PER_CONV)
+    uint32_t step = config.channels * 2;
+    config.frameSamples = (config.frameSamples + step - 1) / step * step;
+    uint32_t frameBytes = config.frameSamples * AdcFrame::sampleBytes(format);
+
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {};
+    for (uint32_t i = 0; i < config.channels; i++) {
+      adc_unit_t unit;
+      adc_channel_t channel;
+      if (adc_continuous_io_to_channel(config.pins[i], &unit, &channel) != ESP_OK || unit != ADC_UNIT_1)
+        return false;
+      pattern[i].atten = config.atten[i];
+      pattern[i].channel = channel;
+      pattern[i].unit = unit;
+      pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    memory = (uint8_t *)heap_caps_malloc(ADC_STREAM_FRAMES * frameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    scratch = (uint8_t *)heap_caps_malloc(frameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!memory || !scratch) {
+      releaseMemory();
+      return false;
+    }
+    pool.begin(memory, frameBytes, format);
+
+    adc_continuous_handle_cfg_t handleCfg = {};
+    handleCfg.max_store_buf_size = frameBytes * 4;
+    handleCfg.conv_frame_size = frameBytes;
+    if (adc_continuous_new_handle(&handleCfg, &handle) != ESP_OK) {
+      releaseMemory();
+      return false;
+    }
+    adc_continuous_config_t digiCfg = {};
+    digiCfg.pattern_num = config.channels;
+    digiCfg.adc_pattern = pattern;
+    digiCfg.sample_freq_hz = config.sampleHz;
+    digiCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digiCfg.format = digiFormat;
+    adc_continuous_evt_cbs_t cbs = {};
+    cbs.on_conv_done = onConvDone;
+    cbs.on_pool_ovf = onPoolOverflow;
+    if (adc_continuous_config(handle, &digiCfg) != ESP_OK ||
+        adc_continuous_register_event_callbacks(handle, &cbs, this) != ESP_OK ||
+        xTaskCreatePinnedToCore(readerTask, "adcStream", ADC_STREAM_TASK_STACK, this, ADC_STREAM_TASK_PRIORITY,
+                                &reader, tskNO_AFFINITY) != pdPASS) {
+      adc_continuous_deinit(handle);
+      handle = nullptr;
+      releaseMemory();
+      return false;
+    }
+
+    running = true;
+    statsTime = micros();
+    if (adc_continuous_start(handle) != ESP_OK) {
+      running = false;
+      return false;
+    }
+    return true;
+  }
+
+  // następna ramka, czeka najwyżej timeoutMs; oddać przez release()
+  AdcFrame *receive(uint32_t timeoutMs) {
+    consumer = xTaskGetCurrentTaskHandle();
+    uint32_t start = millis();
+    AdcFrame *f;
+    while (!(f = pool.take())) {
+      uint32_t waited = millis() - start;
+      if (waited >= timeoutMs) break;
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs - waited));
+    }
+    return f;
+  }
+
+  void release(const AdcFrame *f) {
+    if (f) pool.release(f);
+  }
+
+  uint8_t channelOf(uint8_t index) const {
+    adc_unit_t unit;
+    adc_channel_t channel;
+    return adc_continuous_io_to_channel(config.pins[index], &unit, &channel) == ESP_OK ? (uint8_t)channel : 0xFF;
+  }
+
+  uint32_t getSampleHz() const {
+    return config.sampleHz;
+  }
+
+  // statystyki od poprzedniego wywołania
+  AdcStreamStats takeStats() {
+    portENTER_CRITICAL(&mux);
+    AdcStreamStats s = stats;
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&mux);
+    uint32_t now = micros();
+    s.elapsedUs = now - statsTime;
+    statsTime = now;
+    return s;
+  }
+};
+#endif
+
+#endif // AdcStream_h
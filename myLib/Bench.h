@@ -0,0 +1,188 @@
+#ifndef Bench_h
+#define Bench_h
+
+#include "Platform.h"
+#include "GetTimeDiv.h"
+#include <math.h>
+
+// ---------------------------------------------------------------
+// Prosty harness benchmarków dla ESP32 i PC ([env:native]).
+// BENCH_REGISTER(fn) dopisuje funkcję void fn() do listy, a
+// BenchRunner::runAll(Serial) dla każdej wykonuje najpierw przebiegi
+// rozgrzewające (cache flash, predyktor), potem BENCH_REPS pomiarów
+// licznikiem cykli (GetTimeDiv::cycles(), na PC ns) i wypisuje
+// min / mediana / średnia / odchylenie standardowe.
+//
+// Wynik benchmarku trzeba przekazać do benchDoNotOptimize(), wtedy
+// kompilator musi go policzyć, a nie ma narzutu zapisu do volatile.
+//
+// Oprócz tabeli każdy wynik to jedna linia CSV z prefiksem "BENCH,"
+// (cel, płytka, MHz, nazwa, powtórzenia, cykle, us), do wyciągnięcia
+// z logu monitora: grep ^BENCH, log.txt > wyniki_c3.csv
+// ---------------------------------------------------------------
+#ifndef BENCH_WARMUP
+#define BENCH_WARMUP 2
+#endif
+
+// nieparzysta liczba, mediana to środkowy pomiar
+#ifndef BENCH_REPS
+#define BENCH_REPS 11
+#endif
+
+#ifndef BENCH_MAX_REPS
+#define BENCH_MAX_REPS 64
+#endif
+
+// nazwa celu i płytki w CSV
+#ifdef ARDUINO
+#ifndef BENCH_TARGET
+#define BENCH_TARGET CONFIG_IDF_TARGET
+#endif
+#if !defined(BENCH_BOARD) && defined(ARDUINO_BOARD)
+#define BENCH_BOARD ARDUINO_BOARD
+#endif
+#ifndef BENCH_BOARD
+#define BENCH_BOARD "esp32"
+#endif
+#else
+#ifndef BENCH_TARGET
+#define BENCH_TARGET "native"
+#endif
+#ifndef BENCH_BOARD
+#define BENCH_BOARD "host"
+#endif
+#endif
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+// wartość "użyta" przez pusty asm, bez zapisu do pamięci
+template <class T>
+inline void benchDoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// wymuszenie zapisu wszystkich wyników do pamięci
+inline void benchClobberMemory() {
+  asm volatile("" : : : "memory");
+}
+
+struct BenchResult {
+  uint32_t reps;
+  uint32_t minCycles;
+  uint32_t medianCycles;
+  uint32_t maxCycles;
+  double meanCycles;
+  double stddevCycles;
+};
+
+// pomiar dowolnego wywoływalnego obiektu, np. lambdy z parametrem:
+// benchMeasure([&]() { benchDoNotOptimize(kernel<float>(n)); })
+template <class Fn>
+BenchResult benchMeasure(Fn fn, uint32_t warmup = BENCH_WARMUP, uint32_t reps = BENCH_REPS) {
+  if (reps == 0) reps = 1;
+  if (reps > BENCH_MAX_REPS) reps = BENCH_MAX_REPS;
+  uint32_t samples[BENCH_MAX_REPS] = {};
+  GetTimeDiv t;
+  for (uint32_t i = 0; i < warmup; i++) fn();
+  for (uint32_t i = 0; i < reps; i++) {
+    t.startCycles();
+    fn();
+    t.endCycles();
+    samples[i] = t.getLastDivCycles();
+  }
+
+  // sortowanie przez wstawianie, najwyżej BENCH_MAX_REPS pomiarów
+  for (uint32_t i = 1; i < reps; i++) {
+    uint32_t v = samples[i];
+    uint32_t j = i;
+    for (; j > 0 && samples[j - 1] > v; j--) samples[j] = samples[j - 1];
+    samples[j] = v;
+  }
+
+  BenchResult r;
+  r.reps = reps;
+  r.minCycles = samples[0];
+  r.medianCycles = samples[reps / 2];
+  r.maxCycles = samples[reps - 1];
+  double sum = 0;
+  for (uint32_t i = 0; i < reps; i++) sum += samples[i];
+  r.meanCycles = sum / reps;
+  double var = 0;
+  for (uint32_t i = 0; i < reps; i++) var += (samples[i] - r.meanCycles) * (samples[i] - r.meanCycles);
+  r.stddevCycles = reps > 1 ? sqrt(var / (reps - 1)) : 0;
+  return r;
+}
+
+class BenchCase {
+public:
+  typedef void (*Function)();
+
+  const char *name;
+  Function fn;
+  uint32_t warmup;
+  uint32_t reps;
+  BenchResult result;  // ostatni wynik z runAll(), np. do przyspieszenia względem innego
+  BenchCase *next;
+
+  BenchCase(const char *benchName, Function benchFn, uint32_t warmupRuns = BENCH_WARMUP,
+            uint32_t repetitions = BENCH_REPS)
+      : name(benchName), fn(benchFn), warmup(warmupRuns),
+        reps(repetitions > BENCH_MAX_REPS ? BENCH_MAX_REPS : (repetitions ? repetitions : 1)), result(),
+        next(nullptr) {
+    BenchCase **tail = &head();
+    while (*tail) tail = &(*tail)->next;
+    *tail = this;  // kolejność jak w pliku
+  }
+
+  BenchCase(const BenchCase &) = delete;
+  BenchCase &operator=(const BenchCase &) = delete;
+
+  static BenchCase *&head() {
+    static BenchCase *first = nullptr;
+    return first;
+  }
+
+  BenchResult run() const {
+    return benchMeasure(fn, warmup, reps);
+  }
+};
+
+// BENCH_REGISTER(fn) albo BENCH_REGISTER_N(fn, rozgrzewka, powtórzenia)
+#define BENCH_REGISTER(fn) static BenchCase BENCH_CONCAT(benchCase, __LINE__)(#fn, fn)
+#define BENCH_REGISTER_N(fn, warmup, reps) static BenchCase BENCH_CONCAT(benchCase, __LINE__)(#fn, fn, warmup, reps)
+
+class BenchRunner {
+public:
+  template <class Out>
+  static void printHeader(Out &out) {
+    out.printf("# %s / %s, %u MHz, rozgrzewka + powtorzenia, czasy w cyklach\n", BENCH_TARGET, BENCH_BOARD,
+               (unsigned)(GetTimeDiv::getCpuHz() / 1000000));
+    out.printf("%-24s %5s %12s %12s %12s %10s %10s\n", "benchmark", "reps", "min", "mediana", "srednia", "odch.",
+               "min [us]");
+  }
+
+  template <class Out>
+  static void print(Out &out, const char *name, const BenchResult &r) {
+    double minUs = GetTimeDiv::cyclesToNanos(r.minCycles) / 1000.0;
+    out.printf("%-24s %5u %12u %12u %12.0f %10.0f %10.1f\n", name, (unsigned)r.reps, (unsigned)r.minCycles,
+               (unsigned)r.medianCycles, r.meanCycles, r.stddevCycles, minUs);
+    out.printf("BENCH,%s,%s,%u,%s,%u,%u,%u,%u,%.0f,%.0f,%.1f\n", BENCH_TARGET, BENCH_BOARD,
+               (unsigned)(GetTimeDiv::getCpuHz() / 1000000), name, (unsigned)r.reps, (unsigned)r.minCycles,
+               (unsigned)r.medianCycles, (unsigned)r.maxCycles, r.meanCycles, r.stddevCycles, minUs);
+  }
+
+  // wszystkie zarejestrowane benchmarki po kolei
+  template <class Out>
+  static void runAll(Out &out) {
+    GetTimeDiv::overheadCycles();  // kalibracja przed pierwszym pomiarem
+    printHeader(out);
+    out.printf("# BENCH,cel,plytka,MHz,nazwa,reps,min,mediana,max,srednia,odch,min_us\n");
+    for (BenchCase *c = BenchCase::head(); c; c = c->next) {
+      c->result = c->run();
+      print(out, c->name, c->result);
+    }
+  }
+};
+
+#endif // Bench_h
@@ -0,0 +1,442 @@
+#ifndef BigFixed_h
+#define BigFixed_h
+
+#include "Platform.h"
+#include <math.h>
+#include <string.h>
+#include <new>
+
+// ---------------------------------------------------------------
+// Arytmetyka wielokrotnej precyzji na słowach (limbach) 32-bitowych.
+//
+// limb*()      - działania na tablicach słów od najmłodszego, jak w GMP
+//                mpn: dodawanie, odejmowanie, mnożenie i dzielenie przez
+//                słowo, mnożenie szkolne i Karatsuba (powyżej BIGFIXED_KARATSUBA słów)
+// BigFixedMath - liczby stałoprzecinkowe: frac słów ułamka + jedno słowo
+//                części całkowitej, czyli wartości [0, 2^32) z krokiem
+//                2^(-32 * frac). Wszystkie wielkości w Gauss-Legendre są
+//                ograniczone, więc wykładnik (pełny big-float) nie jest
+//                potrzebny. Pierwiastek i odwrotność metodą Newtona
+//                z podwajaniem precyzji, dzielenie jako mnożenie przez
+//                odwrotność.
+//
+// Liczba to tablica limbs() = frac + 1 słów. Działania biorą precyzję p
+// (słów ułamka, p <= frac): używane jest wtedy tylko p + 1 najstarszych
+// słów, czyli widok od d + frac - p. Wyniki są obcinane (w dół).
+// Pamięć jest przydzielana raz w konstruktorze (ok()), potem nic.
+//
+// Mnożenie 32 x 32 -> 64 to na Xtensa mull + muluh, na RISC-V mul + mulhu,
+// reszta to dodawanie z przeniesieniem (na RISC-V bez flagi carry).
+// ---------------------------------------------------------------
+
+// próg przejścia z mnożenia szkolnego na Karatsubę, w słowach
+#ifndef BIGFIXED_KARATSUBA
+#define BIGFIXED_KARATSUBA 24
+#endif
+
+typedef uint32_t limb_t;
+
+// r = a + b, n słów, zwraca przeniesienie
+inline limb_t limbAdd(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    uint64_t c = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        c += (uint64_t)a[i] + b[i];
+        r[i] = (limb_t)c;
+        c >>= 32;
+    }
+    return (limb_t)c;
+}
+
+// r = a - b, n słów, zwraca pożyczkę
+inline limb_t limbSub(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    limb_t borrow = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        limb_t x = a[i], y = b[i];
+        limb_t d = x - y - borrow;
+        borrow = (x < y) || (x == y && borrow);
+        r[i] = d;
+    }
+    return borrow;
+}
+
+// dodanie przeniesienia c od słowa 0, zwraca przeniesienie z ostatniego
+inline limb_t limbAddCarry(limb_t *r, size_t n, limb_t c)
+{
+    for (size_t i = 0; i < n && c; i++)
+    {
+        r[i] += c;
+        c = r[i] < c;
+    }
+    return c;
+}
+
+inline int limbCompare(const limb_t *a, const limb_t *b, size_t n)
+{
+    while (n--)
+    {
+        if (a[n] != b[n])
+            return a[n] < b[n] ? -1 : 1;
+    }
+    return 0;
+}
+
+// r += a * b, n słów, zwraca słowo przeniesienia
+inline limb_t limbAddMul1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+    uint64_t c = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        c += (uint64_t)a[i] * b + r[i];
+        r[i] = (limb_t)c;
+        c >>= 32;
+    }
+    return (limb_t)c;
+}
+
+// r = a * b, n słów, zwraca słowo przeniesienia
+inline limb_t limbMul1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+    uint64_t c = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        c += (uint64_t)a[i] * b;
+        r[i] = (limb_t)c;
+        c >>= 32;
+    }
+    return (limb_t)c;
+}
+
+// r = a / d, n słów od najstarszego, zwraca resztę
+inline limb_t limbDiv1(limb_t *r, const limb_t *a, size_t n, limb_t d)
+{
+    uint64_t rem = 0;
+    while (n--)
+    {
+        rem = (rem << 32) | a[n];
+        r[n] = (limb_t)(rem / d);
+        rem %= d;
+    }
+    return (limb_t)rem;
+}
+
+// r[2n] = a[n] * b[n], mnożenie szkolne O(n^2)
+inline void limbMulBasecase(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+    r[n] = limbMul1(r, a, n, b[0]);
+    for (size_t i = 1; i < n; i++)
+        r[i + n] = limbAddMul1(r + i, a, n, b[i]);
+}
+
+// słów pamięci pomocniczej dla limbMul() przy n słowach
+inline size_t limbMulScratch(size_t n)
+{
+    if (n < BIGFIXED_KARATSUBA)
+        return 0;
+    size_t m = n - n / 2;
+    size_t inner = limbMulScratch(m);
+    return 4 * m + (inner > 2 * m + 1 ? inner : 2 * m + 1);
+}
+
+// |a - b| dla a[na], b[nb], na >= nb, wynik na słowach; zwraca true gdy a < b
+inline bool limbAbsDiff(limb_t *r, const limb_t *a, size_t na, const limb_t *b, size_t nb)
+{
+    bool high = false;
+    for (size_t i = nb; i < na; i++)
+        high = high || a[i];
+    bool less = !high && limbCompare(a, b, nb) < 0;
+    if (less)
+    {
+        limbSub(r, b, a, nb);
+        for (size_t i = nb; i < na; i++)
+            r[i] = 0;
+    }
+    else
+    {
+        limb_t borrow = limbSub(r, a, b, nb);
+        for (size_t i = nb; i < na; i++)
+        {
+            r[i] = a[i] - borrow;
+            borrow = a[i] < borrow;
+        }
+    }
+    return less;
+}
+
+// r[2n] = a[n] * b[n], Karatsuba O(n^1.585):
+// a = a1 X + a0, b = b1 X + b0, X = 2^(32 h)
+// ab = a1 b1 X^2 + (a1 b1 + a0 b0 - (a1 - a0)(b1 - b0)) X + a0 b0
+// scratch co najmniej limbMulScratch(n) słów, r nie może się pokrywać z a i b
+inline void limbMul(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t *scratch)
+{
+    if (n < BIGFIXED_KARATSUBA)
+    {
+        limbMulBasecase(r, a, b, n);
+        return;
+    }
+    size_t h = n / 2, m = n - h; // m >= h
+    limb_t *da = scratch, *db = scratch + m, *mid = scratch + 2 * m, *sum = scratch + 4 * m;
+
+    limbMul(r, a, b, h, scratch);                 // a0 b0 -> r[0, 2h)
+    limbMul(r + 2 * h, a + h, b + h, m, scratch); // a1 b1 -> r[2h, 2n)
+
+    bool negA = limbAbsDiff(da, a + h, m, a, h);
+    bool negB = limbAbsDiff(db, b + h, m, b, h);
+    limbMul(mid, da, db, m, scratch + 4 * m); // |a1 - a0| |b1 - b0|, 2m słów
+    bool negP = negA != negB;
+
+    // sum = a0 b0 + a1 b1 na 2m + 1 słowach, potem -/+ iloczyn różnic
+    memcpy(sum, r, 2 * h * sizeof(limb_t));
+    for (size_t i = 2 * h; i <= 2 * m; i++)
+        sum[i] = 0;
+    sum[2 * m] = limbAdd(sum, sum, r + 2 * h, 2 * m);
+    if (negP)
+        sum[2 * m] += limbAdd(sum, sum, mid, 2 * m);
+    else
+        sum[2 * m] -= limbSub(sum, sum, mid, 2 * m);
+
+    // wynik środkowy dodany od słowa h (h + 2m + 1 <= 2n), przeniesienie mieści się w r
+    limb_t c = limbAdd(r + h, r + h, sum, 2 * m + 1);
+    limbAddCarry(r + h + 2 * m + 1, h - 1, c);
+}
+
+class BigFixedMath
+{
+private:
+    size_t frac;
+    limb_t *scratch; // limbMul + iloczyn 2 (frac + 1) słów
+    limb_t *product;
+    limb_t *one;     // 1.0, wspólna dla wszystkich precyzji
+    limb_t *t1;
+    limb_t *t2;
+    limb_t *t3;
+    limb_t *inv; // wynik Newtona w sqrtOf() i div()
+
+    // kolejne precyzje Newtona od 1 słowa do frac, każda ~2x poprzednia
+    template <class Step>
+    void newtonLadder(Step step)
+    {
+        size_t ladder[40];
+        size_t count = 0;
+        for (size_t p = frac; count < 40; p = p / 2 + 1)
+        {
+            ladder[count++] = p;
+            if (p <= 2)
+                break;
+        }
+        while (count--)
+            step(ladder[count]);
+        step(frac); // dodatkowy krok na pełnej precyzji, błąd obcięć
+    }
+
+    // r = r + sign * r * e / 2^shift przy precyzji p, e = |1 - ...| w t3
+    void newtonUpdate(limb_t *r, size_t p, bool negative, uint32_t shift)
+    {
+        limb_t *rv = r + frac - p;
+        limb_t *c = view(t2, p);
+        mul(c, rv, view(t3, p), p);
+        if (shift)
+            shiftBits(c, c, p, shift);
+        if (negative)
+            limbSub(rv, rv, c, p + 1);
+        else
+            limbAdd(rv, rv, c, p + 1);
+    }
+
+    // t3 = |1 - e| przy precyzji p, zwraca true gdy e > 1
+    bool oneMinus(const limb_t *e, size_t p)
+    {
+        limb_t *d = view(t3, p);
+        const limb_t *o = view(one, p);
+        if (limbCompare(e, o, p + 1) > 0)
+        {
+            limbSub(d, e, o, p + 1);
+            return true;
+        }
+        limbSub(d, o, e, p + 1);
+        return false;
+    }
+
+public:
+    explicit BigFixedMath(size_t fracLimbs)
+    {
+        frac = fracLimbs ? fracLimbs : 1;
+        size_t n = frac + 1;
+        scratch = new (std::nothrow) limb_t[limbMulScratch(n) + 1];
+        product = new (std::nothrow) limb_t[2 * n];
+        one = new (std::nothrow) limb_t[n];
+        t1 = new (std::nothrow) limb_t[n];
+        t2 = new (std::nothrow) limb_t[n];
+        t3 = new (std::nothrow) limb_t[n];
+        inv = new (std::nothrow) limb_t[n];
+        if (one)
+            setInt(one, 1);
+    }
+
+    ~BigFixedMath()
+    {
+        delete[] scratch;
+        delete[] product;
+        delete[] one;
+        delete[] t1;
+        delete[] t2;
+        delete[] t3;
+        delete[] inv;
+    }
+
+    BigFixedMath(const BigFixedMath &) = delete;
+    BigFixedMath &operator=(const BigFixedMath &) = delete;
+
+    bool ok() const { return scratch && product && one && t1 && t2 && t3 && inv; }
+
+    size_t fracLimbs() const { return frac; }
+    size_t limbs() const { return frac + 1; }
+
+    // słów ułamka dla danej liczby cyfr dziesiętnych, z 2 słowami zapasu
+    static size_t fracLimbsForDigits(uint32_t digits) { return (size_t)(digits * 3.3219281 / 32) + 3; }
+
+    // widok liczby x (pełna precyzja) przy precyzji p
+    limb_t *view(limb_t *x, size_t p) const { return x + frac - p; }
+    const limb_t *view(const limb_t *x, size_t p) const { return x + frac - p; }
+
+    void setInt(limb_t *x, limb_t v)
+    {
+        memset(x, 0, frac * sizeof(limb_t));
+        x[frac] = v;
+    }
+
+    // ~53 bity z double, reszta zera
+    void setDouble(limb_t *x, double v)
+    {
+        memset(x, 0, frac * sizeof(limb_t));
+        double ip = floor(v);
+        x[frac] = (limb_t)ip;
+        v = (v - ip) * 4294967296.0;
+        for (size_t i = 1; i <= 2 && i <= frac; i++)
+        {
+            double w = floor(v);
+            x[frac - i] = (limb_t)w;
+            v = (v - w) * 4294967296.0;
+        }
+    }
+
+    double toDouble(const limb_t *x) const
+    {
+        double v = 0;
+        for (size_t i = frac >= 2 ? frac - 2 : 0; i <= frac; i++)
+            v = v / 4294967296.0 + x[i];
+        return v;
+    }
+
+    void copy(limb_t *r, const limb_t *x) { memcpy(r, x, (frac + 1) * sizeof(limb_t)); }
+
+    void add(limb_t *r, const limb_t *a, const limb_t *b) { limbAdd(r, a, b, frac + 1); }
+    void sub(limb_t *r, const limb_t *a, const limb_t *b) { limbSub(r, a, b, frac + 1); }
+
+    // r = a >> bits, p + 1 słów, 0 < bits < 32
+    static void shiftBits(limb_t *r, const limb_t *a, size_t p, uint32_t bits)
+    {
+        for (size_t i = 0; i < p; i++)
+            r[i] = (a[i] >> bits) | (a[i + 1] << (32 - bits));
+        r[p] = a[p] >> bits;
+    }
+
+    // r = x * 2^-k, dowolne k
+    void shiftRight(limb_t *r, const limb_t *x, uint32_t k)
+    {
+        size_t words = k / 32, n = frac + 1;
+        for (size_t i = 0; i < n; i++)
+            r[i] = i + words < n ? x[i + words] : 0;
+        if (k % 32)
+            shiftBits(r, r, frac, k % 32);
+    }
+
+    // r = x * 2^k, bez kontroli przepełnienia części całkowitej
+    void shiftLeft(limb_t *r, const limb_t *x, uint32_t k)
+    {
+        size_t words = k / 32, n = frac + 1;
+        uint32_t bits = k % 32;
+        for (size_t i = n; i-- > 0;)
+        {
+            limb_t hi = i >= words ? x[i - words] : 0;
+            limb_t lo = i >= words + 1 ? x[i - words - 1] : 0;
+            r[i] = bits ? (hi << bits) | (lo >> (32 - bits)) : hi;
+        }
+    }
+
+    // r = a * b przy precyzji p (widoki p + 1 słów), r może być a lub b
+    void mul(limb_t *r, const limb_t *a, const limb_t *b, size_t p)
+    {
+        limbMul(product, a, b, p + 1, scratch);
+        memcpy(r, product + p, (p + 1) * sizeof(limb_t));
+    }
+
+    void mul(limb_t *r, const limb_t *a, const limb_t *b) { mul(r, a, b, frac); }
+
+    // r = 1 / sqrt(x), Newton: y += y (1 - x y^2) / 2, x z zakresu ~[2^-20, 2^20]
+    void invSqrt(limb_t *r, const limb_t *x)
+    {
+        setDouble(r, 1.0 / sqrt(toDouble(x)));
+        newtonLadder([&](size_t p)
+                     {
+                         limb_t *y = view(r, p);
+                         limb_t *e = view(t1, p);
+                         mul(e, y, y, p);
+                         mul(e, e, view(x, p), p);
+                         bool negative = oneMinus(e, p);
+                         newtonUpdate(r, p, negative, 1); });
+    }
+
+    // r = sqrt(x) = x / sqrt(x)
+    void sqrtOf(limb_t *r, const limb_t *x)
+    {
+        invSqrt(inv, x);
+        mul(r, inv, x);
+    }
+
+    // r = 1 / x, Newton: y += y (1 - x y)
+    void reciprocal(limb_t *r, const limb_t *x)
+    {
+        setDouble(r, 1.0 / toDouble(x));
+        newtonLadder([&](size_t p)
+                     {
+                         limb_t *e = view(t1, p);
+                         mul(e, view(r, p), view(x, p), p);
+                         bool negative = oneMinus(e, p);
+                         newtonUpdate(r, p, negative, 0); });
+    }
+
+    // r = a / b
+    void div(limb_t *r, const limb_t *a, const limb_t *b)
+    {
+        reciprocal(inv, b);
+        mul(r, a, inv);
+    }
+
+    // część ułamkowa jako cyfry dziesiętne: out[digits] + '\0', przez 10^9
+    // na kopii w t1, O(frac * digits)
+    void toDecimal(const limb_t *x, char *out, size_t digits)
+    {
+        copy(t1, x);
+        size_t p = frac;
+        size_t pos = 0;
+        while (pos < digits)
+        {
+            t1[frac] = 0;
+            t1[frac] = limbMul1(view(t1, p), view(t1, p), p, 1000000000u);
+            char chunk[10];
+            snprintf(chunk, sizeof(chunk), "%09u", (unsigned)t1[frac]);
+            for (size_t i = 0; i < 9 && pos < digits; i++)
+                out[pos++] = chunk[i];
+            // najmłodsze słowa nie mają już wpływu na kolejne cyfry
+            while (p > 1 && t1[frac - p] == 0)
+                p--;
+        }
+        out[pos] = '\0';
+    }
+};
+
+#endif // BigFixed_h
@@ -0,0 +1,118 @@
+#ifndef FastRandom_h
+#define FastRandom_h
+
+#include "Platform.h"
+
+// ---------------------------------------------------------------
+// Szybkie generatory pseudolosowe z własnym stanem, zamiast rand(),
+// który ma jeden wspólny stan (w newlib chroniony blokadą) i liczy
+// na 64 bitach. Każdy task / rdzeń ma swój obiekt, więc nic nie
+// jest współdzielone.
+//
+// Xoshiro128   - xoshiro128**, tylko 32-bitowe operacje, najszybszy na
+//                ESP32; jump() daje 2^64 kroków dalej, czyli osobny
+//                niezachodzący ciąg dla kolejnego rdzenia
+// Pcg32        - PCG-XSH-RR, mnożenie 64-bitowe (na ESP32 kilka instrukcji
+//                mul), osobny ciąg wybierany parametrem stream
+// EspRandom    - sprzętowy generator esp_random(), tylko na ESP32;
+//                prawdziwie losowy przy włączonym radiu, ale to odczyt
+//                rejestru peryferium dzielonego przez oba rdzenie
+//
+// Wszystkie mają next() zwracające 32 losowe bity.
+// ---------------------------------------------------------------
+
+// rozwinięcie ziarna na stan generatora (splitmix64)
+inline uint64_t splitMix64(uint64_t &x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+class Xoshiro128 {
+private:
+  uint32_t s[4];
+
+  static uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+  }
+
+public:
+  explicit Xoshiro128(uint64_t seed = 1) {
+    uint64_t a = splitMix64(seed);
+    uint64_t b = splitMix64(seed);
+    s[0] = (uint32_t)a;
+    s[1] = (uint32_t)(a >> 32);
+    s[2] = (uint32_t)b;
+    s[3] = (uint32_t)(b >> 32);
+  }
+
+  // stan podany wprost (nie może być cały zerowy), np. do wektorów referencyjnych
+  Xoshiro128(uint32_t s0, uint32_t s1, uint32_t s2, uint32_t s3) {
+    s[0] = s0;
+    s[1] = s1;
+    s[2] = s2;
+    s[3] = s3;
+  }
+
+  uint32_t next() {
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+  }
+
+  // przeskok o 2^64 wywołań next(), do podziału jednego ciągu między rdzenie
+  void jump() {
+    static const uint32_t JUMP[] = {0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+    uint32_t t[4] = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < 4; i++) {
+      for (uint32_t b = 0; b < 32; b++) {
+        if (JUMP[i] & (1u << b)) {
+          t[0] ^= s[0];
+          t[1] ^= s[1];
+          t[2] ^= s[2];
+          t[3] ^= s[3];
+        }
+        next();
+      }
+    }
+    for (uint32_t i = 0; i < 4; i++) s[i] = t[i];
+  }
+};
+
+class Pcg32 {
+private:
+  uint64_t state;
+  uint64_t inc;
+
+public:
+  explicit Pcg32(uint64_t seed = 1, uint64_t stream = 0) : state(0), inc((stream << 1) | 1) {
+    next();
+    state += seed;
+    next();
+  }
+
+  uint32_t next() {
+    uint64_t old = state;
+    state = old * 6364136223846793005ull + inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+  }
+};
+
+#ifdef ARDUINO
+struct EspRandom {
+  uint32_t next() {
+    return esp_random();
+  }
+};
+#endif
+
+#endif // FastRandom_h
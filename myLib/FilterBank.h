@@ -0,0 +1,117 @@
+#ifndef FilterBank_h
+#define FilterBank_h
+
+#include "Platform.h"
+#include "MovingAverage.h"
+#include <stddef.h>
+
+// ---------------------------------------------------------------
+// Średnia krocząca N próbek dla Channels kanałów naraz.
+// Dane są trzymane jako osobne tablice (SoA): historia [N][Channels]
+// i sumy [Channels], więc jedna ramka wszystkich kanałów to ciągły
+// fragment pamięci, a pętla po kanałach ma stałą długość znaną przy
+// kompilacji i kompilator może ją rozwinąć.
+//
+// updateBlock() przyjmuje ramki przeplecione jak z DMA ADC/I2S:
+// ch0, ch1, ... chC-1, ch0, ch1, ...
+// Sumy jak w MovingAverage: int64_t dla liczb całkowitych (albo Acc
+// podane jawnie, np. int32_t dla 12-bitowego ADC), Kahan dla float.
+// ---------------------------------------------------------------
+template <class V, uint32_t Channels, uint32_t N, class Acc = typename MovingAverageSum<V>::Value>
+class FilterBank
+{
+private:
+    static_assert(Channels > 0 && N > 0, "Channels i N musza byc wieksze od 0");
+
+    static const bool KAHAN = std::is_floating_point<Acc>::value;
+    static const bool POW2 = (N & (N - 1)) == 0;
+
+    V history[N][Channels];
+    Acc sum[Channels];
+    Acc compensation[KAHAN ? Channels : 1];
+    uint32_t index;
+    uint32_t countData;
+
+public:
+    FilterBank() { reset(); }
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < N; i++)
+            for (uint32_t c = 0; c < Channels; c++)
+                history[i][c] = 0;
+        for (uint32_t c = 0; c < Channels; c++)
+            sum[c] = 0;
+        for (uint32_t c = 0; c < (KAHAN ? Channels : 1); c++)
+            compensation[c] = 0;
+        index = 0;
+        countData = 0;
+    }
+
+    // frames ramek po Channels próbek
+    void updateBlock(const V *samples, size_t frames)
+    {
+        for (size_t f = 0; f < frames; f++)
+        {
+            V *__restrict oldest = history[index]; // bufor DMA nie nachodzi na historię
+            if (KAHAN)
+            {
+                for (uint32_t c = 0; c < Channels; c++)
+                {
+                    Acc y = ((Acc)samples[c] - (Acc)oldest[c]) - compensation[c];
+                    Acc t = sum[c] + y;
+                    compensation[c] = (t - sum[c]) - y;
+                    sum[c] = t;
+                    oldest[c] = samples[c];
+                }
+            }
+            else
+            {
+                for (uint32_t c = 0; c < Channels; c++)
+                {
+                    sum[c] += (Acc)samples[c] - (Acc)oldest[c];
+                    oldest[c] = samples[c];
+                }
+            }
+            samples += Channels;
+            if (POW2)
+                index = (index + 1) & (N - 1);
+            else if (++index == N)
+                index = 0;
+        }
+        if (frames >= N - countData)
+            countData = N;
+        else
+            countData += (uint32_t)frames;
+    }
+
+    // jedna ramka
+    void update(const V *frame)
+    {
+        updateBlock(frame, 1);
+    }
+
+    V get(uint32_t channel) const
+    {
+        if (countData == 0)
+            return 0;
+        return (V)(sum[channel] / (Acc)countData);
+    }
+
+    // średnie wszystkich kanałów
+    void getAll(V *out) const
+    {
+        for (uint32_t c = 0; c < Channels; c++)
+            out[c] = get(c);
+    }
+
+    uint32_t count() const { return countData; }
+
+    bool isFull() const { return countData == N; }
+
+    static uint32_t channels() { return Channels; }
+
+    static uint32_t size() { return N; }
+};
+
+#endif // FilterBank_h
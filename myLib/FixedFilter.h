@@ -0,0 +1,260 @@
+#ifndef FixedFilter_h
+#define FixedFilter_h
+
+#include "Platform.h"
+#include "MovingAverage.h"
+#include <type_traits>
+
+// ---------------------------------------------------------------
+// Filtry całkowitoliczbowe (int32_t, Q15, Q31) dla układów bez FPU
+// (ESP32-C3, ESP32-S2), gdzie float i double są emulowane programowo.
+//
+// BoxcarFilter<T, N>   - średnia z N próbek, bieżąca suma w Acc
+// EmaFilter<T, Shift>  - średnia wykładnicza, alfa = 2^-Shift
+// CicDecimator<S, R>   - filtr CIC rzędu S z decymacją R
+//
+// Wszystko jest liczone na liczbach całkowitych, a przesunięcia w prawo
+// zaokrąglają w dół (do -nieskończoności), więc wynik jest identyczny
+// bit w bit na ESP32 i na PC - można go sprawdzać w [env:native].
+//
+// FILTER_FIXED_POINT wybiera wariant dla płytki (BoardAverage<N>),
+// domyślnie 1 gdy kompilator nie ma sprzętowego float.
+// ---------------------------------------------------------------
+#ifndef FILTER_FIXED_POINT
+#if (defined(__riscv) && !defined(__riscv_flen)) || defined(__XTENSA_SOFT_FLOAT__)
+#define FILTER_FIXED_POINT 1
+#else
+#define FILTER_FIXED_POINT 0
+#endif
+#endif
+
+typedef int16_t q15_t; // 1.15, zakres [-1, 1)
+typedef int32_t q31_t; // 1.31, zakres [-1, 1)
+
+inline q15_t floatToQ15(float v)
+{
+    if (v >= 1.0f)
+        return INT16_MAX;
+    if (v <= -1.0f)
+        return INT16_MIN;
+    return (q15_t)(v * 32768.0f);
+}
+
+inline float q15ToFloat(q15_t v)
+{
+    return v / 32768.0f;
+}
+
+inline q31_t floatToQ31(double v)
+{
+    if (v >= 1.0)
+        return INT32_MAX;
+    if (v <= -1.0)
+        return INT32_MIN;
+    return (q31_t)(v * 2147483648.0);
+}
+
+inline double q31ToFloat(q31_t v)
+{
+    return v / 2147483648.0;
+}
+
+// mnożenie z zaokrągleniem w dół, wynik w tym samym formacie
+inline q15_t mulQ15(q15_t a, q15_t b)
+{
+    return (q15_t)(((int32_t)a * b) >> 15);
+}
+
+inline q31_t mulQ31(q31_t a, q31_t b)
+{
+    return (q31_t)(((int64_t)a * b) >> 31);
+}
+
+// log2 dla potęg dwójki w czasie kompilacji
+constexpr uint32_t filterLog2(uint32_t n)
+{
+    return n <= 1 ? 0 : 1 + filterLog2(n >> 1);
+}
+
+// domyślny akumulator: int32_t dla próbek do 16 bitów, int64_t dla 32 bitów
+template <class T>
+struct FixedAccumulator
+{
+    typedef typename std::conditional<(sizeof(T) <= 2), int32_t, int64_t>::type type;
+};
+
+// średnia z N próbek; Acc musi pomieścić N * maks. |próbka|,
+// np. BoxcarFilter<int32_t, 32, int32_t> dla 12-bitowego ADC
+template <class T, uint32_t N, class Acc = typename FixedAccumulator<T>::type>
+class BoxcarFilter
+{
+private:
+    static_assert(std::is_integral<T>::value && std::is_integral<Acc>::value, "tylko liczby calkowite");
+    static_assert(N > 0, "N musi byc wieksze od 0");
+
+    static const bool POW2 = (N & (N - 1)) == 0;
+    static const uint32_t LOG2 = filterLog2(N);
+
+    T dataTab[N];
+    uint32_t index;
+    uint32_t countData;
+    Acc sum;
+
+public:
+    BoxcarFilter() { reset(); }
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < N; i++)
+            dataTab[i] = 0;
+        index = 0;
+        countData = 0;
+        sum = 0;
+    }
+
+    HOT_FN void update(T dataU)
+    {
+        sum += (Acc)dataU - (Acc)dataTab[index];
+        dataTab[index] = dataU;
+        if (POW2)
+            index = (index + 1) & (N - 1);
+        else if (++index == N)
+            index = 0;
+        if (countData < N)
+            countData++;
+    }
+
+    // zaokrąglenie w dół, przy N = 2^k to tylko przesunięcie
+    T get() const
+    {
+        if (countData == N)
+            return POW2 ? (T)(sum >> LOG2) : (T)floorDiv(sum, N);
+        if (countData == 0)
+            return 0;
+        return (T)floorDiv(sum, countData);
+    }
+
+    uint32_t count() const { return countData; }
+
+    bool isFull() const { return countData == N; }
+
+    static uint32_t size() { return N; }
+
+private:
+    static Acc floorDiv(Acc a, uint32_t b)
+    {
+        Acc q = a / (Acc)b;
+        return (a < 0 && q * (Acc)b != a) ? q - 1 : q;
+    }
+};
+
+// średnia wykładnicza y += (x - y) / 2^Shift, stan trzymany z Shift bitami
+// części ułamkowej, Acc musi pomieścić maks. |próbka| * 2^Shift;
+// pierwsza próbka ustawia stan bez rozbiegu od zera
+template <class T, uint8_t Shift, class Acc = typename FixedAccumulator<T>::type>
+class EmaFilter
+{
+private:
+    static_assert(std::is_integral<T>::value && std::is_integral<Acc>::value, "tylko liczby calkowite");
+    static_assert(Shift > 0 && Shift < sizeof(Acc) * 8 - 1, "Shift poza zakresem Acc");
+
+    Acc state;
+    bool primed;
+
+public:
+    EmaFilter() { reset(); }
+
+    void reset()
+    {
+        state = 0;
+        primed = false;
+    }
+
+    HOT_FN void update(T dataU)
+    {
+        if (!primed)
+        {
+            state = (Acc)dataU * ((Acc)1 << Shift);
+            primed = true;
+        }
+        else
+        {
+            state += (Acc)dataU - (state >> Shift);
+        }
+    }
+
+    T get() const { return (T)(state >> Shift); }
+};
+
+// CIC (Hogenauer) rzędu Stages z decymacją R i opóźnieniem różniczkującym 1.
+// Arytmetyka modulo 2^32 jest dokładna, o ile InputBits + Stages * log2(R) <= 32.
+// update() zwraca true co R próbek, get() daje wynik w skali wejścia.
+template <uint8_t Stages, uint32_t R, uint8_t InputBits = 16>
+class CicDecimator
+{
+private:
+    static_assert(Stages > 0, "co najmniej jeden stopien");
+    static_assert(R > 1 && (R & (R - 1)) == 0, "R musi byc potega 2");
+
+public:
+    static const uint32_t GAIN_BITS = Stages * filterLog2(R);
+
+private:
+    static_assert(InputBits + GAIN_BITS <= 32, "wynik CIC nie miesci sie w 32 bitach");
+
+    uint32_t integrator[Stages];
+    uint32_t comb[Stages];
+    uint32_t phase;
+    int32_t output;
+
+public:
+    CicDecimator() { reset(); }
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < Stages; i++)
+        {
+            integrator[i] = 0;
+            comb[i] = 0;
+        }
+        phase = 0;
+        output = 0;
+    }
+
+    bool update(int32_t dataU)
+    {
+        uint32_t v = (uint32_t)dataU;
+        for (uint32_t i = 0; i < Stages; i++)
+        {
+            integrator[i] += v;
+            v = integrator[i];
+        }
+        if (++phase < R)
+            return false;
+        phase = 0;
+        for (uint32_t i = 0; i < Stages; i++)
+        {
+            uint32_t prev = comb[i];
+            comb[i] = v;
+            v -= prev;
+        }
+        output = (int32_t)v;
+        return true;
+    }
+
+    // suma ze wzmocnieniem R^Stages
+    int32_t getRaw() const { return output; }
+
+    int32_t get() const { return output >> GAIN_BITS; }
+};
+
+// średnia krocząca dla danej płytki: liczby całkowite bez FPU, float z FPU
+#if FILTER_FIXED_POINT
+template <uint32_t N>
+using BoardAverage = BoxcarFilter<int32_t, N, int32_t>;
+#else
+template <uint32_t N>
+using BoardAverage = MovingAverage<float, N>;
+#endif
+
+#endif // FixedFilter_h
@@ -0,0 +1,198 @@
+#ifndef FixedPoint_h
+#define FixedPoint_h
+
+#include "Platform.h"
+#include <math.h>
+#include <type_traits>
+
+// ---------------------------------------------------------------
+// Liczby stałoprzecinkowe jako typ z operatorami, żeby ten sam kod
+// (szablon) liczył na float, double i liczbach całkowitych.
+//
+// Fixed<Frac>   - int32_t z Frac bitami części ułamkowej
+// Q16_16        - Fixed<16>, zakres [-32768, 32768), krok 1.5e-5
+// Q1_31         - Fixed<31>, zakres [-1, 1), krok 4.7e-10
+//
+// Mnożenie i dzielenie idą przez int64_t, przesunięcia zaokrąglają
+// w dół, przekroczenie zakresu przy konwersji z double jest nasycane,
+// w działaniach nie (jak int32_t).
+//
+// NumTraits<T> daje wspólne funkcje dla wszystkich typów (sqrt,
+// konwersje, mnożenie przez 2^k), a FastestReal<Bits> wybiera
+// najszybszy typ dla płytki, który ma co najmniej Bits bitów
+// ułamka dla wartości rzędu 1.
+// ---------------------------------------------------------------
+
+// sprzętowy float: ESP32 i S3 (Xtensa z FPU), RISC-V z rozszerzeniem F; double tylko na PC
+#ifndef REAL_HW_FLOAT
+#if !defined(ARDUINO) || (defined(__XTENSA__) && !defined(__XTENSA_SOFT_FLOAT__)) || defined(__riscv_flen)
+#define REAL_HW_FLOAT 1
+#else
+#define REAL_HW_FLOAT 0
+#endif
+#endif
+
+#ifndef REAL_HW_DOUBLE
+#if !defined(ARDUINO) || (defined(__riscv_flen) && __riscv_flen >= 64)
+#define REAL_HW_DOUBLE 1
+#else
+#define REAL_HW_DOUBLE 0
+#endif
+#endif
+
+template <uint8_t Frac>
+class Fixed
+{
+private:
+    static_assert(Frac > 0 && Frac < 32, "Frac poza zakresem int32_t");
+
+    static constexpr double SCALE = (double)(1ull << Frac);
+
+    static constexpr int32_t toRaw(double v)
+    {
+        return v * SCALE >= 2147483647.0    ? INT32_MAX
+               : v * SCALE <= -2147483648.0 ? INT32_MIN
+                                            : (int32_t)(v * SCALE + (v < 0 ? -0.5 : 0.5));
+    }
+
+public:
+    static const uint8_t FRAC_BITS = Frac;
+    static const uint8_t INT_BITS = 31 - Frac;
+
+    int32_t raw;
+
+    Fixed() : raw(0) {}
+    constexpr explicit Fixed(double v) : raw(toRaw(v)) {}
+
+    static Fixed fromRaw(int32_t r)
+    {
+        Fixed f;
+        f.raw = r;
+        return f;
+    }
+
+    static Fixed fromInt(int32_t i) { return fromRaw((int32_t)((uint32_t)i << Frac)); }
+
+    double toDouble() const { return raw / SCALE; }
+
+    Fixed operator+(Fixed b) const { return fromRaw(raw + b.raw); }
+    Fixed operator-(Fixed b) const { return fromRaw(raw - b.raw); }
+    Fixed operator-() const { return fromRaw(-raw); }
+    Fixed operator*(Fixed b) const { return fromRaw((int32_t)(((int64_t)raw * b.raw) >> Frac)); }
+    Fixed operator/(Fixed b) const { return fromRaw((int32_t)(((int64_t)raw << Frac) / b.raw)); }
+
+    Fixed &operator+=(Fixed b) { return *this = *this + b; }
+    Fixed &operator-=(Fixed b) { return *this = *this - b; }
+    Fixed &operator*=(Fixed b) { return *this = *this * b; }
+    Fixed &operator/=(Fixed b) { return *this = *this / b; }
+
+    bool operator<(Fixed b) const { return raw < b.raw; }
+    bool operator<=(Fixed b) const { return raw <= b.raw; }
+    bool operator>(Fixed b) const { return raw > b.raw; }
+    bool operator>=(Fixed b) const { return raw >= b.raw; }
+    bool operator==(Fixed b) const { return raw == b.raw; }
+    bool operator!=(Fixed b) const { return raw != b.raw; }
+};
+
+template <uint8_t Frac>
+constexpr double Fixed<Frac>::SCALE;
+
+typedef Fixed<16> Q16_16;
+typedef Fixed<31> Q1_31;
+
+// pierwiastek całkowity z liczby 64-bitowej, bit po bicie
+inline uint32_t isqrt64(uint64_t v)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > v)
+        bit >>= 2;
+    while (bit)
+    {
+        if (v >= result + bit)
+        {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+// wspólny interfejs typów liczbowych dla szablonów
+template <class T>
+struct NumTraits
+{
+    static_assert(std::is_floating_point<T>::value, "brak NumTraits dla tego typu");
+
+    static const uint8_t INT_BITS = 127;
+
+    static const char *name() { return sizeof(T) == sizeof(float) ? "float" : "double"; }
+    static T fromDouble(double v) { return (T)v; }
+    static T fromInt(int32_t i) { return (T)i; }
+    static double toDouble(T v) { return (double)v; }
+    static T sqrt(T v) { return std::is_same<T, float>::value ? sqrtf(v) : ::sqrt(v); }
+    static T mulPow2(T v, int k) { return k >= 0 && k < 64 ? v * (T)(1ull << k) : (T)ldexp((double)v, k); }
+
+    // 32 losowe bity na [-0.5, 0.5)
+    static T fromRandom(uint32_t r) { return (T)(r >> 8) * (T)(1.0 / 16777216.0) - (T)0.5; }
+};
+
+template <uint8_t Frac>
+struct NumTraits<Fixed<Frac>>
+{
+    typedef Fixed<Frac> T;
+
+    static const uint8_t INT_BITS = T::INT_BITS;
+
+    static const char *name() { return Frac == 16 ? "Q16.16" : Frac == 31 ? "Q1.31" : "Fixed"; }
+    static T fromDouble(double v) { return T(v); }
+    static T fromInt(int32_t i) { return T::fromInt(i); }
+    static double toDouble(T v) { return v.toDouble(); }
+
+    static T sqrt(T v)
+    {
+        return v.raw <= 0 ? T() : T::fromRaw((int32_t)isqrt64((uint64_t)v.raw << Frac));
+    }
+
+    // z nasyceniem
+    static T mulPow2(T v, int k)
+    {
+        if (v.raw == 0 || k <= 0)
+            return k < 0 ? T::fromRaw(v.raw >> -k) : v;
+        if (k >= 31)
+            return T::fromRaw(v.raw > 0 ? INT32_MAX : INT32_MIN);
+        int64_t r = (int64_t)v.raw << k;
+        if (r > INT32_MAX)
+            r = INT32_MAX;
+        if (r < INT32_MIN)
+            r = INT32_MIN;
+        return T::fromRaw((int32_t)r);
+    }
+
+    static T fromRandom(uint32_t r)
+    {
+        return T::fromRaw((int32_t)(r >> (32 - Frac)) - (int32_t)(1u << (Frac - 1)));
+    }
+};
+
+// najszybszy typ z co najmniej Bits bitami ułamka dla wartości rzędu 1:
+// sprzętowy double, sprzętowy float (23 bity), bez FPU Q16.16 do 16 bitów,
+// potem programowy float, w ostateczności programowy double
+template <uint8_t Bits>
+struct FastestReal
+{
+    typedef typename std::conditional<
+        REAL_HW_DOUBLE, double,
+        typename std::conditional<
+            REAL_HW_FLOAT && Bits <= 23, float,
+            typename std::conditional<
+                Bits <= 16, Q16_16,
+                typename std::conditional<Bits <= 23, float, double>::type>::type>::type>::type type;
+};
+
+#endif // FixedPoint_h
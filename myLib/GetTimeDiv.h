@@ -1,7 +1,190 @@
 #ifndef GetTimeDiv_h
 #define GetTimeDiv_h
 
-#include <Arduino.h>
+#include "Platform.h"
+#include "HotPath.h"
+
+// ---------------------------------------------------------------
+// Pomiar czasu wykonania fragmentu kodu.
+// start()/end()             - millis(), jak dotychczas
+// startMicros()/endMicros() - micros()
+// startCycles()/endCycles() - licznik cykli procesora (CCOUNT na Xtensa,
+//   licznik wydajności przez ESP.getCycleCount() na RISC-V), z odjętym
+//   kosztem samego pomiaru; wynik w cyklach albo ns
+// GetTimeDiv::Scope         - startCycles() w konstruktorze, endCycles() w destruktorze
+//
+// Częstotliwość to F_CPU z pliku płytki (build.f_cpu), można ją zmienić
+// przez setCpuHz(). Licznik cykli jest osobny dla każdego rdzenia i liczy
+// z bieżącym zegarem CPU, więc mierzony kod nie może zmienić rdzenia,
+// a przy esp_pm (IdleSleep::begin) zegar musi być trzymany na maksimum
+// (IdleSleep::CpuMaxScope wokół pomiaru).
+// Przekręca się po 2^32 cykli (~17 s przy 240 MHz).
+// Na PC "cykl" to 1 ns zegara steady_clock.
+//
+// LatencyHistogram zbiera wiele pomiarów w stałej pamięci (histogram
+// log-liniowy jak HdrHistogram): min/max/średnia/liczba i percentyle
+// z błędem względnym do 2^-LATENCY_SUB_BITS. Pomiar trafia do niego przez
+// GetTimeDiv::accumulate() albo LatencyScope.
+// ---------------------------------------------------------------
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+#ifndef F_CPU
+#ifdef ARDUINO
+#define F_CPU 240000000L
+#else
+#define F_CPU 1000000000L
+#endif
+#endif
+
+// podprzedziałów liniowych w każdej potędze 2, 4 bity = błąd do 6.25 %,
+// (33 - bity) * 2^bity liczników po 4 B
+#ifndef LATENCY_SUB_BITS
+#define LATENCY_SUB_BITS 4
+#endif
+
+// podsumowanie histogramu, w jednostkach pomiaru albo po przeliczeniu na ns
+struct LatencySummary {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+
+    template <class Out>
+    void print(Out &out, const char *name) const {
+        out.printf("%s: n=%u min=%u mean=%u max=%u p50=%u p90=%u p99=%u p99.9=%u\n", name, (unsigned)count,
+                   (unsigned)min, (unsigned)mean, (unsigned)max, (unsigned)p50, (unsigned)p90, (unsigned)p99,
+                   (unsigned)p999);
+    }
+
+    int toJson(char *buf, size_t len) const {
+        return snprintf(buf, len,
+                        "{\"count\":%u,\"min\":%u,\"mean\":%u,\"max\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,"
+                        "\"p999\":%u}",
+                        (unsigned)count, (unsigned)min, (unsigned)mean, (unsigned)max, (unsigned)p50, (unsigned)p90,
+                        (unsigned)p99, (unsigned)p999);
+    }
+};
+
+class LatencyHistogram {
+public:
+    static const uint32_t SUB_BITS = LATENCY_SUB_BITS;
+    static const uint32_t SUB = 1u << SUB_BITS;
+    static const uint32_t BUCKETS = (33 - SUB_BITS) << SUB_BITS;
+
+private:
+    uint32_t counts[BUCKETS];
+    uint32_t total;
+    uint32_t minValue;
+    uint32_t maxValue;
+    uint64_t sum;
+
+    // wartości < SUB liniowo, dalej SUB podprzedziałów na każdą potęgę 2
+    HOT_FN static uint32_t bucketOf(uint32_t v) {
+        if (v < SUB) return v;
+        uint32_t e = 31 - __builtin_clz(v);
+        return ((e - SUB_BITS + 1) << SUB_BITS) + ((v >> (e - SUB_BITS)) & (SUB - 1));
+    }
+
+    static uint32_t bucketLow(uint32_t b) {
+        if (b < SUB) return b;
+        uint32_t shift = (b >> SUB_BITS) - 1;
+        return (SUB + (b & (SUB - 1))) << shift;
+    }
+
+    static uint32_t bucketWidth(uint32_t b) {
+        return b < SUB ? 1 : 1u << ((b >> SUB_BITS) - 1);
+    }
+
+public:
+    LatencyHistogram() {
+        reset();
+    }
+
+    void reset() {
+        for (uint32_t i = 0; i < BUCKETS; i++) counts[i] = 0;
+        total = 0;
+        minValue = 0xFFFFFFFFu;
+        maxValue = 0;
+        sum = 0;
+    }
+
+    HOT_FN void record(uint32_t v) {
+        counts[bucketOf(v)]++;
+        total++;
+        sum += v;
+        if (v < minValue) minValue = v;
+        if (v > maxValue) maxValue = v;
+    }
+
+    // dodanie pomiarów z innego histogramu, np. z kilku okien albo rdzeni
+    void merge(const LatencyHistogram &other) {
+        for (uint32_t i = 0; i < BUCKETS; i++) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        if (other.minValue < minValue) minValue = other.minValue;
+        if (other.maxValue > maxValue) maxValue = other.maxValue;
+    }
+
+    // kopia do raportu i wyzerowanie, kolejne okno liczone od nowa
+    LatencyHistogram takeSnapshot() {
+        LatencyHistogram snapshot = *this;
+        reset();
+        return snapshot;
+    }
+
+    uint32_t getCount() const {
+        return total;
+    }
+
+    uint32_t getMin() const {
+        return total ? minValue : 0;
+    }
+
+    uint32_t getMax() const {
+        return maxValue;
+    }
+
+    uint32_t getMean() const {
+        return total ? (uint32_t)(sum / total) : 0;
+    }
+
+    // percentyl w promilach (500 = p50, 999 = p99.9), środek przedziału
+    uint32_t getPercentile(uint32_t perMille) const {
+        if (total == 0) return 0;
+        uint64_t rank = ((uint64_t)total * perMille + 999) / 1000;
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) {
+                uint32_t v = bucketLow(b) + (bucketWidth(b) - 1) / 2;
+                if (v < minValue) v = minValue;
+                if (v > maxValue) v = maxValue;
+                return v;
+            }
+        }
+        return maxValue;
+    }
+
+    LatencySummary summary() const {
+        LatencySummary s;
+        s.count = total;
+        s.min = getMin();
+        s.max = getMax();
+        s.mean = getMean();
+        s.p50 = getPercentile(500);
+        s.p90 = getPercentile(900);
+        s.p99 = getPercentile(990);
+        s.p999 = getPercentile(999);
+        return s;
+    }
+};
 
 class GetTimeDiv {
 
@@ -10,8 +193,65 @@ private:
     uint32_t tempTime;
     uint32_t divTimeMicros;
     uint32_t tempTimeMicros;
+    uint32_t divCycles;
+    uint32_t tempCycles;
+    LatencyHistogram *histogram;
+
+    static uint32_t &cpuHz() {
+        static uint32_t hz = F_CPU;
+        return hz;
+    }
+
+    // najmniejszy odczyt dwóch kolejnych wywołań cycles(), liczony raz
+    static uint32_t calibrate() {
+        uint32_t best = 0xFFFFFFFFu;
+        for (uint32_t i = 0; i < 64; i++) {
+            uint32_t t0 = cycles();
+            uint32_t t1 = cycles();
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        return best;
+    }
 
 public:
+    GetTimeDiv()
+        : divTime(0), tempTime(0), divTimeMicros(0), tempTimeMicros(0), divCycles(0), tempCycles(0),
+          histogram(nullptr) {}
+
+    static inline uint32_t cycles() __attribute__((always_inline)) {
+#if defined(ARDUINO) && defined(__XTENSA__)
+        uint32_t ccount;
+        __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+        return ccount;
+#elif defined(ARDUINO)
+        return ESP.getCycleCount();
+#else
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    // koszt pary startCycles()/endCycles() odejmowany od wyniku; kalibracja
+    // przy pierwszym wywołaniu, przed pomiarami w ISR wywołać raz w setup()
+    static uint32_t overheadCycles() {
+        static const uint32_t overhead = calibrate();
+        return overhead;
+    }
+
+    static uint32_t getCpuHz() {
+        return cpuHz();
+    }
+
+    // np. setCpuHz(getCpuFrequencyMhz() * 1000000) po setCpuFrequencyMhz()
+    static void setCpuHz(uint32_t hz) {
+        cpuHz() = hz;
+    }
+
+    static uint32_t cyclesToNanos(uint32_t c) {
+        return (uint32_t)((uint64_t)c * 1000000000ull / cpuHz());
+    }
+
     void start() {
         tempTime = millis();
     }
@@ -28,6 +268,39 @@ public:
         divTimeMicros = micros() - tempTimeMicros;
     }
 
+    void startCycles() __attribute__((always_inline)) {
+        tempCycles = cycles();
+    }
+
+    void endCycles() __attribute__((always_inline)) {
+        uint32_t d = cycles() - tempCycles;
+        uint32_t o = overheadCycles();
+        divCycles = d > o ? d - o : 0;
+        if (histogram) histogram->record(divCycles);
+    }
+
+    // tryb akumulacji: każdy endCycles() dodaje wynik (w cyklach) do histogramu
+    void accumulate(LatencyHistogram &h) {
+        histogram = &h;
+    }
+
+    void stopAccumulate() {
+        histogram = nullptr;
+    }
+
+    // podsumowanie histogramu w cyklach przeliczone na ns
+    static LatencySummary summaryNanos(const LatencyHistogram &h) {
+        LatencySummary s = h.summary();
+        s.min = cyclesToNanos(s.min);
+        s.max = cyclesToNanos(s.max);
+        s.mean = cyclesToNanos(s.mean);
+        s.p50 = cyclesToNanos(s.p50);
+        s.p90 = cyclesToNanos(s.p90);
+        s.p99 = cyclesToNanos(s.p99);
+        s.p999 = cyclesToNanos(s.p999);
+        return s;
+    }
+
     uint32_t getLastDiv() {
         return divTime;
     }
@@ -35,6 +308,49 @@ public:
     uint32_t getLastDivMicros() {
         return divTimeMicros;
     }
+
+    uint32_t getLastDivCycles() {
+        return divCycles;
+    }
+
+    uint32_t getLastDivNanos() {
+        return cyclesToNanos(divCycles);
+    }
+
+    // pomiar w cyklach do końca bloku:
+    // { GetTimeDiv::Scope scope(tDiv); ... } tDiv.getLastDivNanos();
+    class Scope {
+    private:
+        GetTimeDiv &timeDiv;
+
+    public:
+        explicit Scope(GetTimeDiv &t) : timeDiv(t) {
+            timeDiv.startCycles();
+        }
+        ~Scope() {
+            timeDiv.endCycles();
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+};
+
+// pomiar w cyklach do końca bloku dodawany od razu do histogramu:
+// void handleAPI() { LatencyScope latency(latencyApi); ... }
+class LatencyScope {
+private:
+    LatencyHistogram &histogram;
+    uint32_t startCycles;
+
+public:
+    explicit LatencyScope(LatencyHistogram &h) : histogram(h), startCycles(GetTimeDiv::cycles()) {}
+    ~LatencyScope() {
+        uint32_t d = GetTimeDiv::cycles() - startCycles;
+        uint32_t o = GetTimeDiv::overheadCycles();
+        histogram.record(d > o ? d - o : 0);
+    }
+    LatencyScope(const LatencyScope &) = delete;
+    LatencyScope &operator=(const LatencyScope &) = delete;
 };
 
-#endif // GetTimeDiv_h
\ No newline at end of file
+#endif // GetTimeDiv_h
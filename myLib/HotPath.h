@@ -0,0 +1,59 @@
+#ifndef HotPath_h
+#define HotPath_h
+
+#include "Platform.h"
+
+// ---------------------------------------------------------------
+// Umieszczanie gorących ścieżek w IRAM.
+// Kod z flash wykonuje się przez cache (32 KB na rdzeń na ESP32), który
+// dzielą WiFi, WebServer, String itd. Po obsłudze żądania WWW kod PID
+// czy callbacku ADC jest wyrzucony z cache i pierwsze wykonanie czeka
+// na odczyt z flash SPI, co widać jako max w histogramach /latency.
+// Kod w IRAM i dane w DRAM nie przechodzą przez cache, więc czas
+// wykonania nie zależy od tego, co działało wcześniej.
+//
+// HOT_FN          - funkcja w IRAM przy -DHOTPATH_IRAM=1, bez flagi
+//                   zostaje we flash jak dotychczas (IRAM to ~128 KB
+//                   dzielone z WiFi i przerwaniami, więc tylko wybrane)
+// HOT_INLINE      - małe funkcje pomocnicze gorącej ścieżki: przy
+//                   -DHOTPATH_IRAM=1 zawsze wstawiane inline (przy -Os
+//                   kompilator potrafi je wydzielić do flash), bez flagi
+//                   zwykłe inline
+// HOT_DATA        - stałe tablice używane przez gorącą ścieżkę w DRAM
+//                   zamiast .rodata we flash (zmienne i tak są w DRAM)
+// hotPathInIram() - czy adres funkcji leży w IRAM, do sprawdzenia
+//                   w benchmarku, gdzie linker naprawdę ją położył
+//
+// Oznaczona funkcja wywołująca kod we flash (biblioteki, libm) dalej
+// może czekać na cache - oznaczać trzeba całą ścieżkę albo funkcje
+// wołane muszą się wstawić inline. Kodu bez źródeł (archiwa .a) nie da
+// się oznaczyć makrem; przy budowaniu z framework = espidf (albo Arduino
+// jako komponent IDF) służy do tego fragment linkera myLib/hotpath.lf.
+// ---------------------------------------------------------------
+#ifndef HOTPATH_IRAM
+#define HOTPATH_IRAM 0
+#endif
+
+#if defined(ARDUINO) && HOTPATH_IRAM
+#define HOT_FN IRAM_ATTR
+#define HOT_INLINE inline __attribute__((always_inline))
+#define HOT_DATA DRAM_ATTR
+#else
+#define HOT_FN
+#define HOT_INLINE inline
+#define HOT_DATA
+#endif
+
+#ifdef ARDUINO
+#include "soc/soc.h"
+
+inline bool hotPathInIram(const void *fn) {
+  return (uintptr_t)fn >= SOC_IRAM_LOW && (uintptr_t)fn < SOC_IRAM_HIGH;
+}
+#else
+inline bool hotPathInIram(const void *) {
+  return false;
+}
+#endif
+
+#endif // HotPath_h
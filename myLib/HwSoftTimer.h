@@ -0,0 +1,322 @@
+#ifndef HwSoftTimer_h
+#define HwSoftTimer_h
+
+#include "SoftTimer.h"
+
+// ---------------------------------------------------------------
+// SoftTimer napędzany timerem sprzętowym.
+// Przerwanie timera (GPTimer w IDF 5, timer group w IDF 4) co
+// HW_TIMER_TICK_US obsługuje koło czasowe i tylko wstawia wygasłe timery
+// do kolejki, a callbacki wykonuje osobny task o wysokim priorytecie.
+// Opóźnienie callbacka nie zależy więc od tego co robi loop().
+//
+// Callbacki działają w tasku dispatchera, a nie w loop() - dane wspólne
+// z loop() trzeba chronić tak jak przy zwykłych taskach FreeRTOS.
+// Wpis w kolejce pamięta generację węzła: stop()/start() przed wykonaniem
+// unieważnia stare wygaśnięcie, a stop() (też w destruktorze timera)
+// usuwa wpisy węzła z kolejki. Nie wolno tylko niszczyć timera z innego
+// taska w trakcie wykonywania jego callbacka.
+// Na PC (bez ARDUINO) nie ma sprzętu ani taska, isrTick() i
+// dispatchPending() woła się ręcznie razem z MockClock.
+// ---------------------------------------------------------------
+#ifndef HW_TIMER_TICK_US
+#define HW_TIMER_TICK_US 1000
+#endif
+
+#ifndef HW_TIMER_QUEUE_SIZE
+#define HW_TIMER_QUEUE_SIZE 32
+#endif
+
+#ifndef HW_TIMER_TASK_PRIORITY
+#define HW_TIMER_TASK_PRIORITY (configMAX_PRIORITIES - 5)
+#endif
+
+#ifndef HW_TIMER_TASK_STACK
+#define HW_TIMER_TASK_STACK 4096
+#endif
+
+// ostatni rdzeń: 1 na ESP32/S3, 0 na jednordzeniowych S2/C3
+#ifndef HW_TIMER_TASK_CORE
+#define HW_TIMER_TASK_CORE (portNUM_PROCESSORS - 1)
+#endif
+
+#ifdef ARDUINO
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "driver/gptimer.h"
+#else
+#include "driver/timer.h"
+#ifndef HW_TIMER_GROUP
+#define HW_TIMER_GROUP TIMER_GROUP_1
+#endif
+#ifndef HW_TIMER_INDEX
+#define HW_TIMER_INDEX TIMER_0
+#endif
+#endif
+#endif
+
+// statystyki dispatchera, czasy w tickach zegara (us dla MicrosClock)
+struct HwTimerStats {
+  uint32_t dispatched;   // wykonane callbacki
+  uint32_t dropped;      // wygaśnięcia utracone przy pełnej kolejce
+  uint32_t lastLatency;  // od terminu do startu callbacka
+  uint32_t maxLatency;
+};
+
+template <class Clock>
+class BasicHwTimerDispatcher {
+public:
+  static const uint32_t TICKS_PER_MS = Clock::TICKS_PER_MS;
+  static const uint32_t QUEUE_SIZE = HW_TIMER_QUEUE_SIZE;
+
+private:
+  struct Ready {
+    TimerNode *node;  // nullptr gdy wpis usunięty przez cancel()
+    uint32_t deadline;
+    uint32_t generation;
+  };
+
+  // wstawianie wygasłych timerów do kolejki, wołane z koła czasowego w ISR
+  struct Enqueue {
+    BasicHwTimerDispatcher *d;
+    bool queued;
+    void operator()(TimerNode &node, uint32_t deadline) {
+      if (d->head - d->tail >= QUEUE_SIZE) {
+        d->stats.dropped++;
+        node.missed++;
+        return;
+      }
+      Ready &r = d->queue[d->head % QUEUE_SIZE];
+      r.node = &node;
+      r.deadline = deadline;
+      r.generation = node.generation;
+      d->head++;
+      queued = true;
+    }
+  };
+
+  BasicTimerService<Clock> wheel;
+  Ready queue[QUEUE_SIZE];
+  uint32_t head;  // zapis w ISR
+  uint32_t tail;  // odczyt w tasku
+  HwTimerStats stats;
+
+#ifdef ARDUINO
+  mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  TaskHandle_t task = nullptr;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  gptimer_handle_t gptimer = nullptr;
+#endif
+
+  void lock() const {
+    portENTER_CRITICAL(&mux);
+  }
+  void unlock() const {
+    portEXIT_CRITICAL(&mux);
+  }
+  void lockFromIsr() {
+    portENTER_CRITICAL_ISR(&mux);
+  }
+  void unlockFromIsr() {
+    portEXIT_CRITICAL_ISR(&mux);
+  }
+
+  // sprzątanie po nieudanym begin(), zawsze zwraca false
+  bool teardown() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    if (gptimer) {
+      gptimer_disable(gptimer);  // błąd gdy timer nie był włączony, bez skutków
+      gptimer_del_timer(gptimer);
+      gptimer = nullptr;
+    }
+#else
+    timer_deinit(HW_TIMER_GROUP, HW_TIMER_INDEX);
+#endif
+    if (task) vTaskDelete(task);
+    task = nullptr;
+    return false;
+  }
+
+  static void taskFunction(void *arg) {
+    BasicHwTimerDispatcher *d = (BasicHwTimerDispatcher *)arg;
+    while (1) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      d->dispatchPending();
+    }
+  }
+
+  bool onInterrupt() {
+    if (!isrTick()) return false;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    return woken == pdTRUE;
+  }
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  static bool IRAM_ATTR onAlarm(gptimer_handle_t, const gptimer_alarm_event_data_t *, void *arg) {
+    return ((BasicHwTimerDispatcher *)arg)->onInterrupt();
+  }
+#else
+  static bool IRAM_ATTR onAlarm(void *arg) {
+    return ((BasicHwTimerDispatcher *)arg)->onInterrupt();
+  }
+#endif
+#else
+  void lock() const {}
+  void unlock() const {}
+  void lockFromIsr() {}
+  void unlockFromIsr() {}
+#endif
+
+public:
+  BasicHwTimerDispatcher() : head(0), tail(0) {
+    resetStats();
+  }
+
+  BasicHwTimerDispatcher(const BasicHwTimerDispatcher &) = delete;
+  BasicHwTimerDispatcher &operator=(const BasicHwTimerDispatcher &) = delete;
+
+  // domyślna instancja używana przez HwSoftTimer
+  static BasicHwTimerDispatcher &instance() {
+    static BasicHwTimerDispatcher dispatcher;
+    return dispatcher;
+  }
+
+#ifdef ARDUINO
+  // uruchomienie taska dispatchera i timera sprzętowego, wywołać w setup()
+  bool begin(uint32_t tickUs = HW_TIMER_TICK_US) {
+    if (xTaskCreatePinnedToCore(taskFunction, "HwSoftTimer", HW_TIMER_TASK_STACK, this,
+                                HW_TIMER_TASK_PRIORITY, &task, HW_TIMER_TASK_CORE) != pdPASS) {
+      task = nullptr;
+      return false;
+    }
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+    gptimer_config_t config = {};
+    config.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    config.direction = GPTIMER_COUNT_UP;
+    config.resolution_hz = 1000000;  // 1 tick = 1 us
+    if (gptimer_new_timer(&config, &gptimer) != ESP_OK) {
+      gptimer = nullptr;
+      return teardown();
+    }
+
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = onAlarm;
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = tickUs;
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+    if (gptimer_register_event_callbacks(gptimer, &callbacks, this) != ESP_OK ||
+        gptimer_set_alarm_action(gptimer, &alarm) != ESP_OK)
+      return teardown();
+    if (gptimer_enable(gptimer) != ESP_OK || gptimer_start(gptimer) != ESP_OK) return teardown();
+    return true;
+#else
+    timer_config_t config = {};
+    config.divider = 80;  // APB 80 MHz -> 1 us
+    config.counter_dir = TIMER_COUNT_UP;
+    config.counter_en = TIMER_PAUSE;
+    config.alarm_en = TIMER_ALARM_EN;
+    config.auto_reload = TIMER_AUTORELOAD_EN;
+    if (timer_init(HW_TIMER_GROUP, HW_TIMER_INDEX, &config) != ESP_OK) {
+      vTaskDelete(task);
+      task = nullptr;
+      return false;
+    }
+
+    if (timer_set_counter_value(HW_TIMER_GROUP, HW_TIMER_INDEX, 0) != ESP_OK ||
+        timer_set_alarm_value(HW_TIMER_GROUP, HW_TIMER_INDEX, tickUs) != ESP_OK ||
+        timer_enable_intr(HW_TIMER_GROUP, HW_TIMER_INDEX) != ESP_OK ||
+        timer_isr_callback_add(HW_TIMER_GROUP, HW_TIMER_INDEX, onAlarm, this, 0) != ESP_OK ||
+        timer_start(HW_TIMER_GROUP, HW_TIMER_INDEX) != ESP_OK)
+      return teardown();
+    return true;
+#endif
+  }
+#endif
+
+  // interwał w ms, tak jak w SoftTimer
+  void arm(TimerNode &node, uint32_t intervalMs) {
+    const uint32_t maxMs = BasicTimerService<Clock>::MAX_INTERVAL / TICKS_PER_MS;
+    uint32_t ticks = intervalMs > maxMs ? BasicTimerService<Clock>::MAX_INTERVAL : intervalMs * TICKS_PER_MS;
+    lock();
+    node.generation++;
+    wheel.arm(node, ticks);
+    unlock();
+  }
+
+  // zatrzymany timer nie zostanie wywołany nawet jeżeli czeka już w kolejce,
+  // jego wpisy są usuwane z kolejki (węzeł można potem zniszczyć)
+  void cancel(TimerNode &node) {
+    lock();
+    node.generation++;
+    wheel.cancel(node);
+    for (uint32_t i = tail; i != head; i++)
+      if (queue[i % QUEUE_SIZE].node == &node) queue[i % QUEUE_SIZE].node = nullptr;
+    unlock();
+  }
+
+  // callbacki wykonuje task dispatchera, poll() zostało dla zgodności z SoftTimer
+  void poll() {}
+
+  // część wykonywana w przerwaniu, zwraca true gdy coś trafiło do kolejki
+  bool isrTick() {
+    Enqueue fn = {this, false};
+    lockFromIsr();
+    wheel.poll(fn);
+    unlockFromIsr();
+    return fn.queued;
+  }
+
+  // wykonanie oczekujących callbacków w kolejności terminów, zwraca ich liczbę
+  uint32_t dispatchPending() {
+    uint32_t n = 0;
+    while (1) {
+      lock();
+      if (tail == head) {
+        unlock();
+        break;
+      }
+      Ready r = queue[tail % QUEUE_SIZE];
+      tail++;
+      if (!r.node || !r.node->armed() || r.node->generation != r.generation) {
+        unlock();
+        continue;
+      }
+
+      uint32_t latency = Clock::now() - r.deadline;
+      stats.lastLatency = latency;
+      if (latency > stats.maxLatency) stats.maxLatency = latency;
+      stats.dispatched++;
+#if SOFTTIMER_STATS
+      r.node->lateness.add(latency * (1000 / TICKS_PER_MS) + Clock::subTickUs());
+#endif
+      unlock();
+      r.node->callback();
+      n++;
+    }
+    return n;
+  }
+
+  HwTimerStats getStats() const {
+    lock();
+    HwTimerStats s = stats;
+    unlock();
+    return s;
+  }
+
+  void resetStats() {
+    lock();
+    stats.dispatched = 0;
+    stats.dropped = 0;
+    stats.lastLatency = 0;
+    stats.maxLatency = 0;
+    unlock();
+  }
+};
+
+typedef BasicHwTimerDispatcher<MicrosClock> HwTimerDispatcher;
+typedef BasicSoftTimer<HwTimerDispatcher> HwSoftTimer;
+
+#endif // HwSoftTimer_h
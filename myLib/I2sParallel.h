@@ -0,0 +1,466 @@
+#ifndef I2sParallel_h
+#define I2sParallel_h
+
+#include "Platform.h"
+#include "GetTimeDiv.h"
+#include <string.h>
+
+// ---------------------------------------------------------------
+// Równoległa magistrala 8/16 bitów z I2S1 w trybie LCD (tylko ESP32).
+// Próbki wysyła DMA z pierścienia buforów: każdy bufor to jeden lub
+// kilka deskryptorów (maks. DMA_DESC_MAX_BYTES na deskryptor), ostatni
+// deskryptor bufora ma ustawione eof i po jego wysłaniu przychodzi
+// przerwanie OUT_EOF. W przerwaniu wywoływany jest callback wypełniający
+// właśnie wysłany bufor, a DMA w tym czasie wysyła następny, więc CPU
+// nie robi nic na pojedynczą próbkę. Bez callbacka pierścień kręci się
+// w kółko z tą samą zawartością i przerwanie tylko liczy bufory.
+//
+// Zegar magistrali: 80 MHz / (2 * div), div = 2..255, czyli 20 MHz
+// do ~157 kHz. Z apll = true zegar daje APLL / div bez dzielnika BCK
+// (jak w FabGL), dowolna częstotliwość ~1..40 MHz, np. dokładne
+// 25.175 MHz dla VGA; nie działa na ESP32 rev0.
+// Próbki zawsze 16-bitowe (tx_bits_mod = 16), przy magistrali 8-bitowej
+// używany jest młodszy bajt. ESP32 wysyła dwie próbki z jednego słowa
+// 32-bit w odwrotnej kolejności, indeks próbki w buforze daje
+// I2sParallel::sampleIndex().
+//
+// Niedobór (underrun): callback wypełniał bufor dłużej niż trwa
+// wysłanie pozostałych buforów, czyli DMA zaczęło go wysyłać przed
+// końcem wypełniania. Pominięte przerwania (EOF kolejnych buforów
+// obsłużone razem) są liczone osobno, te bufory poszły ze starą treścią.
+//
+// DmaChain i DmaRingTracker nie zależą od sprzętu i działają na PC.
+// ---------------------------------------------------------------
+
+// maks. długość danych jednego deskryptora (pole 12-bit, wyrównana do 4)
+#define DMA_DESC_MAX_BYTES 4092
+
+// flagi esp_intr_alloc(), ESP_INTR_FLAG_IRAM tylko gdy callback też jest w IRAM
+#ifndef I2S_PARALLEL_INTR_FLAGS
+#define I2S_PARALLEL_INTR_FLAGS 0
+#endif
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+#include "esp_idf_version.h"
+#include "esp_intr_alloc.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_gpio.h"
+#include "soc/i2s_struct.h"
+#include "soc/i2s_reg.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/rtc.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_private/periph_ctrl.h"
+#else
+#include "driver/periph_ctrl.h"
+#endif
+#endif
+
+// układ jak lldesc_t z ROM ESP32
+struct DmaDescriptor {
+  volatile uint32_t size : 12;    // rozmiar bufora
+  volatile uint32_t length : 12;  // liczba bajtów do wysłania
+  volatile uint32_t offset : 5;
+  volatile uint32_t sosf : 1;
+  volatile uint32_t eof : 1;      // przerwanie OUT_EOF po tym deskryptorze
+  volatile uint32_t owner : 1;    // 1 = DMA
+  uint8_t *buf;
+  DmaDescriptor *next;            // na ESP32 adres 32-bit
+};
+
+#ifdef ARDUINO
+static_assert(sizeof(DmaDescriptor) == 12, "DmaDescriptor musi mieć układ lldesc_t");
+#endif
+
+class DmaChain {
+public:
+  static uint32_t descriptorsFor(uint32_t bufferBytes) {
+    return (bufferBytes + DMA_DESC_MAX_BYTES - 1) / DMA_DESC_MAX_BYTES;
+  }
+
+  // pierścień deskryptorów dla bufferCount buforów po bufferBytes (wielokrotność 4),
+  // zwraca liczbę użytych deskryptorów albo 0 gdy się nie mieści
+  static uint32_t build(DmaDescriptor *desc, uint32_t maxDesc, uint8_t *const *buffers, uint32_t bufferCount,
+                        uint32_t bufferBytes) {
+    uint32_t perBuffer = descriptorsFor(bufferBytes);
+    uint32_t total = perBuffer * bufferCount;
+    if (!bufferCount || !bufferBytes || (bufferBytes & 3) || total > maxDesc) return 0;
+    uint32_t n = 0;
+    for (uint32_t b = 0; b < bufferCount; b++) {
+      for (uint32_t offset = 0; offset < bufferBytes; offset += DMA_DESC_MAX_BYTES) {
+        uint32_t len = bufferBytes - offset < DMA_DESC_MAX_BYTES ? bufferBytes - offset : DMA_DESC_MAX_BYTES;
+        DmaDescriptor &d = desc[n];
+        d.size = len;
+        d.length = len;
+        d.offset = 0;
+        d.sosf = 0;
+        d.eof = offset + len == bufferBytes;
+        d.owner = 1;
+        d.buf = buffers[b] + offset;
+        d.next = &desc[(n + 1) % total];
+        n++;
+      }
+    }
+    return n;
+  }
+
+  // obejście pierścienia od desc[0]: zwraca bajty na jedno okrążenie, 0 gdy
+  // pierścień nie wraca do początku albo liczba eof nie zgadza się z buforami
+  static uint32_t check(const DmaDescriptor *desc, uint32_t count, uint32_t bufferCount) {
+    uint32_t bytes = 0, eofs = 0;
+    const DmaDescriptor *d = desc;
+    for (uint32_t i = 0; i < count; i++) {
+      if (d < desc || d >= desc + count || !d->owner || d->length > d->size) return 0;
+      bytes += d->length;
+      eofs += d->eof;
+      d = d->next;
+    }
+    return d == desc && eofs == bufferCount ? bytes : 0;
+  }
+
+  // numer bufora dla deskryptora z rejestru out_eof_des_addr
+  static uint32_t bufferOf(const DmaDescriptor *desc, const DmaDescriptor *eofDesc, uint32_t perBuffer) {
+    return (uint32_t)(eofDesc - desc) / perBuffer;
+  }
+};
+
+struct I2sParallelStats {
+  uint32_t buffers;        // bufory wysłane przez DMA
+  uint32_t bytes;
+  uint32_t underruns;      // wypełnianie dłuższe niż zapas DMA
+  uint32_t missed;         // bufory bez obsłużonego przerwania
+  uint32_t maxFillCycles;  // najdłuższy callback
+  uint32_t elapsedUs;      // od poprzedniego takeStats()
+
+  // przepustowość w bajtach/s
+  uint32_t bytesPerSecond() const {
+    return elapsedUs ? (uint32_t)((uint64_t)bytes * 1000000 / elapsedUs) : 0;
+  }
+
+  template <class Out>
+  void print(Out &out, const char *name) const {
+    out.printf("%s: %u buforow, %u B/s, niedobory %u, pominiete %u, max wypelnianie %u cykli\n", name,
+               (unsigned)buffers, (unsigned)bytesPerSecond(), (unsigned)underruns, (unsigned)missed,
+               (unsigned)maxFillCycles);
+  }
+};
+
+// kolejność przerwań EOF i czasy wypełniania, wołane z przerwania
+class DmaRingTracker {
+private:
+  uint32_t count;
+  uint32_t bufferBytes;
+  uint32_t expected;  // bufor, którego EOF powinien przyjść teraz
+  I2sParallelStats stats;
+
+public:
+  DmaRingTracker() : count(1), bufferBytes(0), expected(0) {
+    reset();
+  }
+
+  void begin(uint32_t bufferCount, uint32_t bytes) {
+    count = bufferCount ? bufferCount : 1;
+    bufferBytes = bytes;
+    expected = 0;
+    reset();
+  }
+
+  void reset() {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // EOF bufora index, zwraca liczbę pominiętych wcześniej buforów
+  uint32_t onEof(uint32_t index) {
+    uint32_t skipped = (index + count - expected) % count;
+    stats.missed += skipped;
+    stats.buffers += skipped + 1;
+    stats.bytes += (skipped + 1) * bufferBytes;
+    expected = (index + 1) % count;
+    return skipped;
+  }
+
+  // czas callbacka; budget = cykle wysyłania pozostałych count - 1 buforów
+  void onFilled(uint32_t cycles, uint32_t budget) {
+    if (cycles > stats.maxFillCycles) stats.maxFillCycles = cycles;
+    if (cycles > budget) stats.underruns++;
+  }
+
+  const I2sParallelStats &getStats() const {
+    return stats;
+  }
+};
+
+// bufor do wypełnienia (samples próbek 16-bit), arg z begin()
+typedef void (*I2sFillCallback)(uint16_t *buffer, uint32_t samples, void *arg);
+
+struct I2sParallelConfig {
+  int8_t dataPins[16];  // -1 = nieużywany
+  uint8_t busWidth;     // 8 albo 16
+  int8_t clockPin;      // -1 = bez wyjścia zegara
+  bool invertClock;
+  uint32_t clockHz;     // do 20 MHz, zaokrąglany do 40 MHz / div (div 2..255);
+                        // z apll do 40 MHz, prawie dokładnie; rzeczywistą
+                        // wartość daje I2sParallel::getClockHz()
+  uint32_t samples;     // próbek 16-bit w buforze
+  uint8_t bufferCount;  // >= 2
+  I2sFillCallback fill; // nullptr = stała zawartość
+  void *arg;
+  bool apll;            // zegar z APLL zamiast 80 MHz / div
+};
+
+// ustawienia APLL: f = 40 MHz * (4 + sdm2 + sdm1 / 256 + sdm0 / 65536) / (2 * (odiv + 2)),
+// VCO (licznik przed dzieleniem przez odiv) 350..500 MHz, magistrala f / div
+struct ApllClock {
+  uint8_t sdm0;
+  uint8_t sdm1;
+  uint8_t sdm2;
+  uint8_t odiv;
+  uint8_t div;
+  uint32_t hz;  // rzeczywista częstotliwość magistrali, 0 = poza zakresem
+};
+
+class I2sParallel {
+public:
+  static const uint32_t BASE_HZ = 40000000;  // 80 MHz APB / tx_bck_div_num 2
+
+  // dzielnik zegara i rzeczywista częstotliwość
+  static uint32_t clockDivider(uint32_t hz) {
+    uint32_t div = hz ? (BASE_HZ + hz / 2) / hz : 255;
+    return div < 2 ? 2 : div > 255 ? 255 : div;
+  }
+
+  static uint32_t clockFor(uint32_t div) {
+    return BASE_HZ / div;
+  }
+
+  // najmniejszy div, dla którego VCO mieści się w zakresie dla jakiegoś odiv
+  static ApllClock apllFor(uint32_t hz) {
+    const uint64_t XTAL_HZ = 40000000;
+    ApllClock c = {0, 0, 0, 0, 0, 0};
+    if (!hz || hz > 40000000) return c;
+    for (uint32_t div = 2; div <= 255; div++) {
+      for (uint32_t odiv = 0; odiv <= 31; odiv++) {
+        uint64_t vco = (uint64_t)hz * div * 2 * (odiv + 2);
+        if (vco < 350000000 || vco > 500000000) continue;
+        uint64_t sdm = (vco * 65536 + XTAL_HZ / 2) / XTAL_HZ - 4 * 65536;  // 16 bitów ułamka
+        if (sdm >= 64ull * 65536) continue;
+        c.sdm0 = (uint8_t)(sdm & 0xFF);
+        c.sdm1 = (uint8_t)((sdm >> 8) & 0xFF);
+        c.sdm2 = (uint8_t)(sdm >> 16);
+        c.odiv = (uint8_t)odiv;
+        c.div = (uint8_t)div;
+        uint64_t apll = XTAL_HZ * (sdm + 4 * 65536) / 65536 / (2 * (odiv + 2));
+        c.hz = (uint32_t)((apll + div / 2) / div);
+        return c;
+      }
+    }
+    return c;
+  }
+
+  // miejsce próbki i w buforze: ESP32 wysyła najpierw starsze 16 bitów słowa
+  static uint32_t sampleIndex(uint32_t i) {
+    return i ^ 1;
+  }
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+private:
+  I2sParallelConfig config;
+  uint16_t **buffers;
+  DmaDescriptor *desc;
+  uint32_t descCount;
+  uint32_t perBuffer;
+  uint32_t budgetCycles;
+  uint32_t statsTime;
+  DmaRingTracker tracker;
+  intr_handle_t intr;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+  static void IRAM_ATTR onInterrupt(void *arg) {
+    I2sParallel *p = (I2sParallel *)arg;
+    if (!I2S1.int_st.out_eof) return;
+    const DmaDescriptor *eofDesc = (const DmaDescriptor *)I2S1.out_eof_des_addr;
+    I2S1.int_clr.out_eof = 1;
+    uint32_t index = DmaChain::bufferOf(p->desc, eofDesc, p->perBuffer);
+    if (index >= p->config.bufferCount) return;
+
+    portENTER_CRITICAL_ISR(&p->mux);
+    p->tracker.onEof(index);
+    portEXIT_CRITICAL_ISR(&p->mux);
+    if (!p->config.fill) return;
+
+    uint32_t start = GetTimeDiv::cycles();
+    p->config.fill(p->buffers[index], p->config.samples, p->config.arg);
+    uint32_t cycles = GetTimeDiv::cycles() - start;
+    portENTER_CRITICAL_ISR(&p->mux);
+    p->tracker.onFilled(cycles, p->budgetCycles);
+    portEXIT_CRITICAL_ISR(&p->mux);
+  }
+
+  void releaseMemory() {
+    if (buffers) {
+      for (uint32_t i = 0; i < config.bufferCount; i++) heap_caps_free(buffers[i]);
+      free(buffers);
+    }
+    heap_caps_free(desc);
+    buffers = nullptr;
+    desc = nullptr;
+  }
+
+  static void routePin(int8_t pin, uint32_t signal, bool invert) {
+    if (pin < 0) return;
+    pinMode(pin, OUTPUT);
+    esp_rom_gpio_connect_out_signal(pin, signal, invert, false);
+  }
+
+public:
+  I2sParallel() : buffers(nullptr), desc(nullptr), descCount(0), perBuffer(1), budgetCycles(0), statsTime(0),
+                  intr(nullptr) {
+    memset(&config, 0, sizeof(config));
+  }
+
+  ~I2sParallel() {
+    end();
+  }
+
+  I2sParallel(const I2sParallel &) = delete;
+  I2sParallel &operator=(const I2sParallel &) = delete;
+
+  // bufory w pamięci DMA, wstępnie wypełnione przez callback (albo zerami)
+  bool begin(const I2sParallelConfig &cfg) {
+    end();
+    config = cfg;
+    if (config.bufferCount < 2 || !config.samples || (config.busWidth != 8 && config.busWidth != 16))
+      return false;
+    config.samples = (config.samples + 1) & ~1u;  // całe słowa 32-bit
+    uint32_t bytes = config.samples * 2;
+
+    perBuffer = DmaChain::descriptorsFor(bytes);
+    descCount = perBuffer * config.bufferCount;
+    desc = (DmaDescriptor *)heap_caps_calloc(descCount, sizeof(DmaDescriptor), MALLOC_CAP_DMA);
+    buffers = (uint16_t **)calloc(config.bufferCount, sizeof(uint16_t *));
+    if (!desc || !buffers) {
+      releaseMemory();
+      return false;
+    }
+    for (uint32_t i = 0; i < config.bufferCount; i++) {
+      buffers[i] = (uint16_t *)heap_caps_calloc(1, bytes, MALLOC_CAP_DMA);
+      if (!buffers[i]) {
+        releaseMemory();
+        return false;
+      }
+      if (config.fill) config.fill(buffers[i], config.samples, config.arg);
+    }
+    if (!DmaChain::build(desc, descCount, (uint8_t *const *)buffers, config.bufferCount, bytes)) {
+      releaseMemory();
+      return false;
+    }
+
+    uint32_t div = clockDivider(config.clockHz);
+    uint32_t busHz = clockFor(div);
+    ApllClock apll = apllFor(config.clockHz);
+    if (config.apll) {
+      if (!apll.hz) {
+        releaseMemory();
+        return false;
+      }
+      div = apll.div;
+      busHz = apll.hz;
+#if ESP_IDF_VERSION_MAJOR >= 5
+      rtc_clk_apll_enable(true);
+      rtc_clk_apll_coeff_set(apll.odiv, apll.sdm0, apll.sdm1, apll.sdm2);
+#else
+      rtc_clk_apll_enable(true, apll.sdm0, apll.sdm1, apll.sdm2, apll.odiv);
+#endif
+    }
+    budgetCycles = (uint32_t)((uint64_t)(config.bufferCount - 1) * config.samples * GetTimeDiv::getCpuHz() / busHz);
+    tracker.begin(config.bufferCount, bytes);
+
+    periph_module_enable(PERIPH_I2S1_MODULE);
+    for (uint32_t i = 0; i < config.busWidth; i++) routePin(config.dataPins[i], I2S1O_DATA_OUT8_IDX + i, false);
+    routePin(config.clockPin, I2S1O_WS_OUT_IDX, !config.invertClock);  // WS aktywny niskim stanem
+
+    i2s_dev_t &dev = I2S1;
+    dev.conf.tx_reset = 1;
+    dev.conf.tx_reset = 0;
+    dev.conf.tx_fifo_reset = 1;
+    dev.conf.tx_fifo_reset = 0;
+    dev.lc_conf.out_rst = 1;
+    dev.lc_conf.out_rst = 0;
+    dev.lc_conf.ahbm_rst = 1;
+    dev.lc_conf.ahbm_rst = 0;
+    dev.lc_conf.ahbm_fifo_rst = 1;
+    dev.lc_conf.ahbm_fifo_rst = 0;
+
+    dev.conf2.val = 0;
+    dev.conf2.lcd_en = 1;
+    dev.sample_rate_conf.val = 0;
+    dev.sample_rate_conf.tx_bits_mod = 16;
+    dev.sample_rate_conf.tx_bck_div_num = config.apll ? 1 : 2;
+    dev.clkm_conf.val = 0;
+    dev.clkm_conf.clka_en = config.apll;
+    dev.clkm_conf.clkm_div_a = 1;
+    dev.clkm_conf.clkm_div_b = 0;
+    dev.clkm_conf.clkm_div_num = div;
+    dev.fifo_conf.val = 0;
+    dev.fifo_conf.tx_fifo_mod_force_en = 1;
+    dev.fifo_conf.tx_fifo_mod = 1;  // 16 bit, jeden kanał
+    dev.fifo_conf.tx_data_num = 32;
+    dev.fifo_conf.dscr_en = 1;
+    dev.conf1.val = 0;
+    dev.conf1.tx_stop_en = 0;
+    dev.conf1.tx_pcm_bypass = 1;
+    dev.conf_chan.val = 0;
+    dev.conf_chan.tx_chan_mod = 1;
+    dev.conf.tx_right_first = 1;
+    dev.timing.val = 0;
+
+    dev.int_ena.val = 0;
+    dev.int_clr.val = 0xFFFFFFFF;
+    if (esp_intr_alloc(ETS_I2S1_INTR_SOURCE, I2S_PARALLEL_INTR_FLAGS, onInterrupt, this, &intr) != ESP_OK) {
+      releaseMemory();
+      return false;
+    }
+    dev.int_ena.out_eof = 1;
+
+    dev.lc_conf.val = I2S_OUT_DATA_BURST_EN | I2S_OUTDSCR_BURST_EN;
+    dev.out_link.addr = (uint32_t)desc;
+    dev.out_link.start = 1;
+    statsTime = micros();
+    dev.conf.tx_start = 1;
+    return true;
+  }
+
+  void end() {
+    if (!desc) return;
+    I2S1.conf.tx_start = 0;
+    I2S1.out_link.stop = 1;
+    I2S1.int_ena.out_eof = 0;
+    if (intr) esp_intr_free(intr);
+    intr = nullptr;
+    releaseMemory();
+  }
+
+  uint32_t getClockHz() const {
+    return config.apll ? apllFor(config.clockHz).hz : clockFor(clockDivider(config.clockHz));
+  }
+
+  // bufor i do wypełnienia poza przerwaniem (przy fill == nullptr)
+  uint16_t *buffer(uint32_t i) const {
+    return i < config.bufferCount && buffers ? buffers[i] : nullptr;
+  }
+
+  // statystyki od poprzedniego wywołania
+  I2sParallelStats takeStats() {
+    portENTER_CRITICAL(&mux);
+    I2sParallelStats s = tracker.getStats();
+    tracker.reset();
+    portEXIT_CRITICAL(&mux);
+    uint32_t now = micros();
+    s.elapsedUs = now - statsTime;
+    statsTime = now;
+    return s;
+  }
+#endif
+};
+
+#endif // I2sParallel_h
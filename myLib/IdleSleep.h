@@ -0,0 +1,156 @@
+#ifndef IdleSleep_h
+#define IdleSleep_h
+
+#include "TimerService.h"
+
+// ---------------------------------------------------------------
+// Uśpienie loop() do najbliższego terminu SoftTimer-a zamiast delay(1).
+// idle() blokuje task loop() na czas do następnego wygaśnięcia (ale nie
+// dłużej niż IDLE_MAX_SLEEP_MS, bo WebServer/DNSServer trzeba odpytywać),
+// w tym czasie działa task IDLE. Po begin() z włączonym light sleep
+// (esp_pm + tickless idle w sdkconfig) procesor sam zasypia, a WiFi
+// w trybie modem sleep (WiFi.setSleep(true)) zostaje połączone.
+// Statystyki liczą wybudzenia loop() na sekundę - do porównania z delay(1).
+// Po begin() zegar CPU spada do minFreqMhz, więc pomiary w cyklach
+// (GetTimeDiv, LatencyScope) trzeba objąć IdleSleep::CpuMaxScope.
+// ---------------------------------------------------------------
+#ifndef IDLE_MAX_SLEEP_MS
+#define IDLE_MAX_SLEEP_MS 20
+#endif
+
+#ifdef ARDUINO
+#include "esp_pm.h"
+#include "esp_idf_version.h"
+#endif
+
+struct IdleStats {
+  uint32_t wakeups;  // wybudzenia loop() w oknie pomiaru
+  uint32_t sleptMs;  // czas spędzony w idle()
+  uint32_t windowMs; // długość okna pomiaru
+};
+
+class IdleSleep {
+private:
+  uint32_t wakeups;
+  uint32_t sleptMs;
+  uint32_t windowStart;
+#ifdef ARDUINO
+  esp_pm_lock_handle_t awakeLock = nullptr;
+  esp_pm_lock_handle_t cpuMaxLock = nullptr;  // ESP_PM_CPU_FREQ_MAX, blokada z licznikiem
+  bool awakeHeld = false;
+#endif
+
+  void sleepFor(uint32_t ms) {
+    if (ms == 0) return;
+    delay(ms);  // vTaskDelay, task IDLE może uśpić procesor
+    sleptMs += ms;
+    wakeups++;
+  }
+
+public:
+  IdleSleep() : wakeups(0), sleptMs(0), windowStart(millis()) {}
+
+  static IdleSleep &instance() {
+    static IdleSleep idleSleep;
+    return idleSleep;
+  }
+
+#ifdef ARDUINO
+  // automatyczne skalowanie zegara i light sleep, false gdy sdkconfig go nie obsługuje
+  bool begin(bool lightSleep = true, int minFreqMhz = 40) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config = {};
+#elif CONFIG_IDF_TARGET_ESP32S2
+    esp_pm_config_esp32s2_t config = {};
+#elif CONFIG_IDF_TARGET_ESP32C3
+    esp_pm_config_esp32c3_t config = {};
+#elif CONFIG_IDF_TARGET_ESP32S3
+    esp_pm_config_esp32s3_t config = {};
+#else
+    esp_pm_config_esp32_t config = {};
+#endif
+    config.max_freq_mhz = getCpuFrequencyMhz();
+    config.min_freq_mhz = minFreqMhz;
+    config.light_sleep_enable = lightSleep;
+    if (esp_pm_configure(&config) != ESP_OK) return false;
+    if (!cpuMaxLock) esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "CpuMax", &cpuMaxLock);
+    return true;
+  }
+
+  // blokada light sleep i obniżania APB, potrzebna gdy działa np. PWM z LEDC,
+  // który na zegarze APB zatrzymuje się w light sleep
+  void holdAwake(bool hold) {
+    if (hold == awakeHeld) return;
+    if (!awakeLock && esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "IdleSleep", &awakeLock) != ESP_OK) return;
+    if (hold)
+      esp_pm_lock_acquire(awakeLock);
+    else
+      esp_pm_lock_release(awakeLock);
+    awakeHeld = hold;
+  }
+#endif
+
+  // zegar CPU na maksimum do końca bloku, bez begin() nic nie robi:
+  // { IdleSleep::CpuMaxScope cpu; LatencyScope latency(h); ... }
+  class CpuMaxScope {
+#ifdef ARDUINO
+  private:
+    esp_pm_lock_handle_t lock;
+
+  public:
+    CpuMaxScope() : lock(IdleSleep::instance().cpuMaxLock) {
+      if (lock) esp_pm_lock_acquire(lock);
+    }
+    ~CpuMaxScope() {
+      if (lock) esp_pm_lock_release(lock);
+    }
+#else
+  public:
+    CpuMaxScope() {}
+#endif
+    CpuMaxScope(const CpuMaxScope &) = delete;
+    CpuMaxScope &operator=(const CpuMaxScope &) = delete;
+  };
+
+  // zamiennik delay(1) na końcu loop(): śpi do najbliższego terminu serwisu
+  template <class Service>
+  void idleWith(const Service &service, uint32_t maxSleepMs = IDLE_MAX_SLEEP_MS) {
+    uint32_t ticks = service.ticksToNextExpiry();
+    uint32_t ms = ticks / Service::TICKS_PER_MS;
+    sleepFor(ms < maxSleepMs ? ms : maxSleepMs);
+  }
+
+  void idle(uint32_t maxSleepMs = IDLE_MAX_SLEEP_MS) {
+    idleWith(TimerService::instance(), maxSleepMs);
+  }
+
+  // stałe uśpienie, np. idleFor(1) jako punkt odniesienia dla starego delay(1)
+  void idleFor(uint32_t ms) {
+    sleepFor(ms);
+  }
+
+  // statystyki od ostatniego odczytu, okno zaczyna się od nowa
+  IdleStats takeStats() {
+    uint32_t now = millis();
+    IdleStats st;
+    st.wakeups = wakeups;
+    st.sleptMs = sleptMs;
+    st.windowMs = now - windowStart;
+    wakeups = 0;
+    sleptMs = 0;
+    windowStart = now;
+    return st;
+  }
+
+  // raport: wybudzenia na sekundę i udział czasu w uśpieniu
+  void printStats(IdleStats st) {
+    uint32_t window = st.windowMs ? st.windowMs : 1;
+    Serial.print(F("Idle: wakeups/s "));
+    Serial.print(st.wakeups * 1000.0 / window, 1);
+    Serial.print(F(", sleep "));
+    Serial.print(st.sleptMs * 100.0 / window, 1);
+    Serial.println(F(" %"));
+  }
+};
+
+#endif // IdleSleep_h
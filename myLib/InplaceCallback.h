@@ -0,0 +1,83 @@
+#ifndef InplaceCallback_h
+#define InplaceCallback_h
+
+#include "Platform.h"
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+#include <new>
+
+// ---------------------------------------------------------------
+// Callback bez alokacji na stercie i bez std::function.
+// Przechowuje jedno z trzech:
+//  - zwykłą funkcję void f(),
+//  - funkcję void f(void *ctx) razem ze wskaźnikiem kontekstu,
+//  - małą lambdę / funktor (do Size bajtów) w buforze obiektu.
+// Wywołanie to zawsze jedno pośrednie wywołanie funkcji.
+// Lambda musi być trywialnie kopiowalna (przechwytywanie wskaźników,
+// referencji i liczb), bo obiekt nie woła destruktorów.
+// ---------------------------------------------------------------
+template <size_t Size = 2 * sizeof(void *)>
+class InplaceCallback {
+public:
+  typedef void (*PlainFunction)();
+  typedef void (*ContextFunction)(void *ctx);
+
+private:
+  PlainFunction plain;      // != nullptr dla zwykłej funkcji
+  ContextFunction invoker;  // funkcja z kontekstem albo thunk lambdy
+  void *arg;                // kontekst albo adres bufora z lambdą
+  alignas(void *) unsigned char storage[Size];
+
+  static void nothing() {}
+
+  template <class Fn>
+  static void thunk(void *p) {
+    (*static_cast<Fn *>(p))();
+  }
+
+  void copyFrom(const InplaceCallback &other) {
+    plain = other.plain;
+    invoker = other.invoker;
+    arg = other.arg;
+    if (other.arg == other.storage) {
+      memcpy(storage, other.storage, Size);
+      arg = storage;
+    }
+  }
+
+public:
+  InplaceCallback() : plain(nothing), invoker(nullptr), arg(nullptr) {}
+
+  InplaceCallback(PlainFunction fn) : plain(fn ? fn : nothing), invoker(nullptr), arg(nullptr) {}
+
+  InplaceCallback(ContextFunction fn, void *ctx) : plain(nullptr), invoker(fn), arg(ctx) {}
+
+  // nazwa parametru Fn, bo F() to makro Arduino
+  template <class Fn, class = typename std::enable_if<!std::is_function<Fn>::value && !std::is_pointer<Fn>::value &&
+                                                           !std::is_same<Fn, std::nullptr_t>::value>::type>
+  InplaceCallback(const Fn &fn) : plain(nullptr), invoker(thunk<Fn>), arg(storage) {
+    static_assert(sizeof(Fn) <= Size, "lambda nie miesci sie w buforze InplaceCallback");
+    static_assert(alignof(Fn) <= alignof(void *), "za duze wyrownanie lambdy");
+    static_assert(std::is_trivially_copyable<Fn>::value, "lambda musi byc trywialnie kopiowalna");
+    new (storage) Fn(fn);
+  }
+
+  InplaceCallback(const InplaceCallback &other) {
+    copyFrom(other);
+  }
+
+  InplaceCallback &operator=(const InplaceCallback &other) {
+    if (this != &other) copyFrom(other);
+    return *this;
+  }
+
+  void operator()() const {
+    if (plain)
+      plain();
+    else
+      invoker(arg);
+  }
+};
+
+#endif // InplaceCallback_h
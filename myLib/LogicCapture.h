@@ -0,0 +1,650 @@
+#ifndef LogicCapture_h
+#define LogicCapture_h
+
+#include "Platform.h"
+#include "I2sParallel.h"
+
+// ---------------------------------------------------------------
+// Analizator stanów logicznych: 8 albo 16 kanałów próbkowanych przez
+// I2S0 w trybie kamery (wejście równoległe), ESP32.
+//
+// Zegar próbkowania daje LEDC na pinie clockPin, ten sam pin jest
+// wejściem PCLK I2S0 (przez matrycę GPIO), synchronizacje kamery
+// (VSYNC, HSYNC, HREF) są na stałe w stanie wysokim. DMA zapisuje
+// pierścień buforów tak jak przy wysyłaniu (DmaChain), przerwanie
+// IN_SUC_EOF po każdym buforze wysyła jego numer do taska, a task
+// sprawdza wyzwalanie i koduje próbki RLE w locie. Zapisywane są tylko
+// zmiany, więc przekaźnik czy OneWire (długie stany, rzadkie zbocza)
+// mieszczą się w pamięci przy sekundach zapisu i MHz próbkowania.
+// Task nie nadąża, gdy zboczy jest bardzo dużo - takie bufory są
+// liczone jako przepełnienia (overruns). Utracony bufor przed
+// wyzwoleniem zeruje historię, po wyzwoleniu kończy zapis (dalsze
+// znaczniki czasu byłyby przesunięte), VCD ma wtedy $comment o tym.
+// arm() i stop() zmieniają LogicCapture pod tym samym mutexem co task,
+// więc ponowne uzbrojenie w trakcie zapisu nie psuje stanu RLE.
+//
+// RleEncoder   - przebiegi (wartość, długość do 65535), 4 B na zmianę
+// LogicTrigger - warunek: poziomy kanałów (mask/value) i/lub zbocza
+// LogicCapture - stan wyzwalania + historia przed wyzwoleniem + RLE,
+//                bez sprzętu, działa na PC
+// VcdWriter    - eksport do VCD (Value Change Dump), czytany przez
+//                PulseView/sigrok (Import -> VCD) i GTKWave
+// LogicAnalyzer - sprzęt: LEDC + I2S0 + DMA + task (tylko ESP32)
+// ---------------------------------------------------------------
+
+// maks. próbek historii przed wyzwoleniem
+#ifndef LOGIC_PRETRIGGER_MAX
+#define LOGIC_PRETRIGGER_MAX 1024
+#endif
+
+#ifndef LOGIC_TASK_PRIORITY
+#define LOGIC_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#endif
+
+#ifndef LOGIC_TASK_CORE
+#define LOGIC_TASK_CORE 1
+#endif
+
+#ifndef LOGIC_TASK_STACK
+#define LOGIC_TASK_STACK 3072
+#endif
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+#include "driver/ledc.h"
+#include "driver/gpio.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// stałe wejścia matrycy GPIO (0x30 = 0, 0x38 = 1)
+#ifndef GPIO_MATRIX_CONST_ZERO_INPUT
+#define GPIO_MATRIX_CONST_ZERO_INPUT 0x30
+#endif
+#ifndef GPIO_MATRIX_CONST_ONE_INPUT
+#define GPIO_MATRIX_CONST_ONE_INPUT 0x38
+#endif
+#endif
+
+struct RleRun {
+  uint16_t value;
+  uint16_t count;  // 1..65535
+};
+
+class RleEncoder {
+private:
+  RleRun *runs;
+  uint32_t capacity;
+  uint32_t used;
+  uint64_t samples;
+
+public:
+  RleEncoder() : runs(nullptr), capacity(0), used(0), samples(0) {}
+
+  void begin(RleRun *storage, uint32_t storageRuns) {
+    runs = storage;
+    capacity = storage ? storageRuns : 0;
+    used = 0;
+    samples = 0;
+  }
+
+  // false gdy nie ma miejsca na nowy przebieg (próbka nie zapisana)
+  bool push(uint16_t v) {
+    if (used && runs[used - 1].value == v && runs[used - 1].count != 0xFFFF) {
+      runs[used - 1].count++;
+    } else {
+      if (used == capacity) return false;
+      runs[used].value = v;
+      runs[used].count = 1;
+      used++;
+    }
+    samples++;
+    return true;
+  }
+
+  // blok z DMA, swap = 1 gdy połówki słów 32-bit są zamienione (I2S), mask = kanały;
+  // zwraca liczbę zapisanych próbek, mniej niż n gdy zabrakło miejsca
+  uint32_t pushBlock(const uint16_t *block, uint32_t n, uint32_t swap, uint16_t mask) {
+    if (!n) return 0;
+    RleRun *last = used ? &runs[used - 1] : nullptr;
+    uint32_t i = 0;
+    for (; i < n; i++) {
+      uint16_t v = block[i ^ swap] & mask;
+      if (last && last->value == v && last->count != 0xFFFF) {
+        last->count++;
+        continue;
+      }
+      if (used == capacity) break;
+      last = &runs[used++];
+      last->value = v;
+      last->count = 1;
+    }
+    samples += i;
+    return i;
+  }
+
+  bool full() const {
+    return used == capacity;
+  }
+
+  uint32_t runCount() const {
+    return used;
+  }
+
+  uint64_t sampleCount() const {
+    return samples;
+  }
+
+  const RleRun *data() const {
+    return runs;
+  }
+
+  // próbka o numerze index (0 = pierwsza), do sprawdzania
+  uint16_t sampleAt(uint64_t index) const {
+    for (uint32_t r = 0; r < used; r++) {
+      if (index < runs[r].count) return runs[r].value;
+      index -= runs[r].count;
+    }
+    return 0;
+  }
+};
+
+struct LogicTrigger {
+  uint16_t mask;     // kanały, które muszą mieć poziom z value
+  uint16_t value;
+  uint16_t rising;   // zbocze narastające na którymkolwiek z tych kanałów
+  uint16_t falling;
+
+  // bez warunków = wyzwolenie od razu
+  bool immediate() const {
+    return !mask && !rising && !falling;
+  }
+
+  bool matches(uint16_t prev, uint16_t cur) const {
+    if ((cur & mask) != (value & mask)) return false;
+    if (!(rising | falling)) return true;
+    return ((~prev & cur & rising) | (prev & ~cur & falling)) != 0;
+  }
+
+  // "r0" narastające na D0, "f3" opadające na D3, "h1"/"l2" poziom,
+  // oddzielone przecinkami, np. "f0,h1"; pusty tekst = od razu
+  bool parse(const char *s) {
+    mask = value = rising = falling = 0;
+    while (s && *s) {
+      char kind = *s++;
+      if (*s < '0' || *s > '9') return false;
+      uint32_t ch = 0;
+      while (*s >= '0' && *s <= '9') ch = ch * 10 + (uint32_t)(*s++ - '0');
+      if (ch > 15) return false;
+      uint16_t bit = (uint16_t)(1u << ch);
+      if (kind == 'r') rising |= bit;
+      else if (kind == 'f') falling |= bit;
+      else if (kind == 'h') mask |= bit, value |= bit;
+      else if (kind == 'l') mask |= bit;
+      else return false;
+      if (*s == ',') s++;
+    }
+    return true;
+  }
+};
+
+enum LogicState {
+  LOGIC_IDLE,
+  LOGIC_ARMED,      // czeka na wyzwolenie
+  LOGIC_CAPTURING,
+  LOGIC_DONE        // limit próbek albo koniec pamięci
+};
+
+class LogicCapture {
+private:
+  RleEncoder rle;
+  LogicTrigger trigger;
+  uint16_t history[LOGIC_PRETRIGGER_MAX];
+  uint32_t historyPos;
+  uint32_t historyCount;
+  uint32_t preTrigger;
+  uint64_t limit;
+  uint64_t triggerSample;  // numer próbki wyzwalającej w zapisie
+  uint16_t mask;
+  uint16_t prev;
+  bool havePrev;
+  bool truncated;  // zapis zakończony przez utracony bufor
+  volatile LogicState state;
+
+  // wyzwolenie na próbce v: najpierw historia, potem v
+  void fire(uint16_t v) {
+    uint32_t start = (historyPos + LOGIC_PRETRIGGER_MAX - historyCount) % LOGIC_PRETRIGGER_MAX;
+    for (uint32_t i = 0; i < historyCount; i++) rle.push(history[(start + i) % LOGIC_PRETRIGGER_MAX]);
+    triggerSample = rle.sampleCount();
+    rle.push(v);
+    state = LOGIC_CAPTURING;
+  }
+
+public:
+  LogicCapture()
+      : historyPos(0), historyCount(0), preTrigger(0), limit(0), triggerSample(0), mask(0xFFFF), prev(0),
+        havePrev(false), truncated(false), state(LOGIC_IDLE) {
+    trigger.parse("");
+  }
+
+  // storage na runs przebiegów; pre próbek przed wyzwoleniem; maxSamples = 0 bez limitu
+  void arm(RleRun *storage, uint32_t runs, const LogicTrigger &t, uint32_t pre, uint64_t maxSamples,
+           uint16_t channelMask = 0xFFFF) {
+    rle.begin(storage, runs);
+    trigger = t;
+    preTrigger = pre < LOGIC_PRETRIGGER_MAX ? pre : LOGIC_PRETRIGGER_MAX;
+    limit = maxSamples;
+    mask = channelMask;
+    historyPos = historyCount = 0;
+    triggerSample = 0;
+    havePrev = false;
+    truncated = false;
+    state = LOGIC_ARMED;
+  }
+
+  void stop() {
+    if (state != LOGIC_IDLE) state = LOGIC_DONE;
+  }
+
+  // dziura w danych (bufor utracony): przed wyzwoleniem historia od nowa,
+  // w trakcie zapisu koniec, żeby numer próbki dalej odpowiadał czasowi
+  void overrun() {
+    if (state == LOGIC_ARMED) {
+      historyCount = 0;
+      havePrev = false;
+    } else if (state == LOGIC_CAPTURING) {
+      truncated = true;
+      state = LOGIC_DONE;
+    }
+  }
+
+  // blok próbek w kolejności z DMA (swap jak w RleEncoder::pushBlock)
+  void process(const uint16_t *block, uint32_t n, uint32_t swap = 0) {
+    uint32_t i = 0;
+    if (state == LOGIC_ARMED) {
+      for (; i < n; i++) {
+        uint16_t v = block[i ^ swap] & mask;
+        if (trigger.immediate() || (havePrev && trigger.matches(prev, v))) {
+          fire(v);
+          i++;
+          break;
+        }
+        prev = v;
+        havePrev = true;
+        if (preTrigger) {
+          history[historyPos] = v;
+          historyPos = (historyPos + 1) % LOGIC_PRETRIGGER_MAX;
+          if (historyCount < preTrigger) historyCount++;
+        }
+      }
+    }
+    if (state != LOGIC_CAPTURING || i >= n) return;
+
+    uint32_t count = n - i;
+    if (limit && rle.sampleCount() + count > limit) count = (uint32_t)(limit - rle.sampleCount());
+    // swap musi zachować parzystość indeksu, więc od i zaczyna się przez wskaźnik na słowo
+    uint32_t written;
+    if (swap && (i & 1)) {
+      written = rle.push(block[i ^ 1] & mask) ? 1 : 0;
+      if (written && count > 1) written += rle.pushBlock(block + i + 1, count - 1, swap, mask);
+    } else {
+      written = rle.pushBlock(block + i, count, swap, mask);
+    }
+    if (written < count || (limit && rle.sampleCount() >= limit)) state = LOGIC_DONE;
+  }
+
+  LogicState getState() const {
+    return state;
+  }
+
+  const RleEncoder &getRle() const {
+    return rle;
+  }
+
+  uint64_t getTriggerSample() const {
+    return triggerSample;
+  }
+
+  bool isTruncated() const {
+    return truncated;
+  }
+};
+
+class VcdWriter {
+public:
+  // czas próbki w ns bez narastającego błędu zaokrągleń
+  static uint64_t sampleNanos(uint64_t index, uint32_t sampleHz) {
+    return sampleHz ? index * 1000000000ull / sampleHz : index;
+  }
+
+  // cały zapis do out (Serial albo bufor HTTP), kanały D0..D(channels-1);
+  // truncated = zapis przerwany przez utracony bufor DMA
+  template <class Out>
+  static void write(Out &out, const RleEncoder &rle, uint8_t channels, uint32_t sampleHz, uint64_t triggerSample,
+                    bool truncated = false) {
+    if (channels > 16) channels = 16;
+    out.printf("$comment ESP32 LogicCapture, %u Hz, trigger at sample %llu $end\n", (unsigned)sampleHz,
+               (unsigned long long)triggerSample);
+    if (truncated)
+      out.printf("$comment capture truncated by DMA overrun at sample %llu $end\n",
+                 (unsigned long long)rle.sampleCount());
+    out.printf("$timescale 1 ns $end\n$scope module logic $end\n");
+    for (uint8_t c = 0; c < channels; c++) out.printf("$var wire 1 %c D%u $end\n", '!' + c, (unsigned)c);
+    out.printf("$upscope $end\n$enddefinitions $end\n");
+
+    const RleRun *runs = rle.data();
+    uint64_t index = 0;
+    for (uint32_t r = 0; r < rle.runCount(); r++) {
+      uint16_t v = runs[r].value;
+      uint16_t changed = r ? (uint16_t)(v ^ runs[r - 1].value) : (uint16_t)0xFFFF;
+      if (changed) {
+        out.printf("#%llu\n", (unsigned long long)sampleNanos(index, sampleHz));
+        if (!r) out.printf("$dumpvars\n");
+        for (uint8_t c = 0; c < channels; c++)
+          if (changed & (1u << c)) out.printf("%c%c\n", (v >> c) & 1 ? '1' : '0', '!' + c);
+        if (!r) out.printf("$end\n");
+      }
+      index += runs[r].count;
+    }
+    out.printf("#%llu\n", (unsigned long long)sampleNanos(index, sampleHz));  // koniec zapisu
+  }
+};
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+struct LogicAnalyzerConfig {
+  int8_t dataPins[16];  // -1 = kanał na stałe 0
+  uint8_t channels;     // 8 albo 16
+  int8_t clockPin;      // wyjście LEDC i wejście PCLK, wolny pin wejścia/wyjścia
+  uint32_t sampleHz;    // do 20 MHz
+  uint32_t samples;     // próbek 16-bit w buforze DMA
+  uint8_t bufferCount;  // >= 2
+};
+
+struct LogicAnalyzerStats {
+  uint32_t buffers;   // bufory z DMA
+  uint32_t overruns;  // bufory nadpisane zanim task je przetworzył
+};
+
+class LogicAnalyzer {
+private:
+  struct Block {
+    uint32_t index;
+    uint32_t seq;
+  };
+
+  LogicAnalyzerConfig config;
+  LogicCapture capture;
+  uint16_t **buffers;
+  DmaDescriptor *desc;
+  uint32_t perBuffer;
+  volatile uint32_t seq;  // numer ostatniego bufora z DMA
+  uint32_t expectedSeq;   // następny bufor oczekiwany przez task
+  LogicAnalyzerStats stats;
+  QueueHandle_t queue;
+  SemaphoreHandle_t captureLock;  // capture i expectedSeq: task kontra arm()/stop()
+  TaskHandle_t task;
+  intr_handle_t intr;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+  static void IRAM_ATTR onInterrupt(void *arg) {
+    LogicAnalyzer *a = (LogicAnalyzer *)arg;
+    if (!I2S0.int_st.in_suc_eof) return;
+    const DmaDescriptor *eofDesc = (const DmaDescriptor *)I2S0.in_eof_des_addr;
+    I2S0.int_clr.in_suc_eof = 1;
+    Block b = {DmaChain::bufferOf(a->desc, eofDesc, a->perBuffer), ++a->seq};
+    BaseType_t woken = pdFALSE;
+    bool lost = xQueueSendFromISR(a->queue, &b, &woken) != pdTRUE;
+    portENTER_CRITICAL_ISR(&a->mux);
+    if (lost) a->stats.overruns++;
+    a->stats.buffers++;
+    portEXIT_CRITICAL_ISR(&a->mux);
+    if (woken == pdTRUE) portYIELD_FROM_ISR();
+  }
+
+  static void taskFunction(void *arg) {
+    LogicAnalyzer *a = (LogicAnalyzer *)arg;
+    Block b;
+    while (1) {
+      if (xQueueReceive(a->queue, &b, portMAX_DELAY) != pdTRUE) continue;
+      xSemaphoreTake(a->captureLock, portMAX_DELAY);
+      a->processBlock(b);
+      xSemaphoreGive(a->captureLock);
+    }
+  }
+
+  // wołane z taskiem pod captureLock
+  void processBlock(const Block &b) {
+    // bufor sprzed ostatniego arm(), przerwanie zdążyło go wstawić po xQueueReset()
+    if ((int32_t)(b.seq - expectedSeq) < 0) return;
+    // przeskok numeru: bufor odrzucony w przerwaniu przy pełnej kolejce
+    bool gap = b.seq != expectedSeq;
+    expectedSeq = b.seq + 1;
+    // DMA jest już bufferCount - 1 buforów dalej, ten mógł zostać nadpisany
+    if (seq - b.seq >= (uint32_t)config.bufferCount - 1) {
+      portENTER_CRITICAL(&mux);
+      stats.overruns++;
+      portEXIT_CRITICAL(&mux);
+      capture.overrun();
+      return;
+    }
+    if (gap) capture.overrun();
+    if (b.index < config.bufferCount) capture.process(buffers[b.index], config.samples, 1);
+  }
+
+  void releaseMemory() {
+    if (buffers) {
+      for (uint32_t i = 0; i < config.bufferCount; i++) heap_caps_free(buffers[i]);
+      free(buffers);
+    }
+    heap_caps_free(desc);
+    buffers = nullptr;
+    desc = nullptr;
+  }
+
+  // sprzątanie po nieudanym begin()
+  void teardown() {
+    if (intr) esp_intr_free(intr);
+    if (task) vTaskDelete(task);
+    if (queue) vQueueDelete(queue);
+    if (captureLock) vSemaphoreDelete(captureLock);
+    intr = nullptr;
+    task = nullptr;
+    queue = nullptr;
+    captureLock = nullptr;
+    releaseMemory();
+  }
+
+  bool startClock() {
+    ledc_timer_config_t timer = {};
+    timer.speed_mode = LEDC_HIGH_SPEED_MODE;
+    timer.duty_resolution = LEDC_TIMER_1_BIT;
+    timer.timer_num = LEDC_TIMER_3;
+    timer.freq_hz = config.sampleHz;
+    timer.clk_cfg = LEDC_AUTO_CLK;
+    if (ledc_timer_config(&timer) != ESP_OK) return false;
+    ledc_channel_config_t channel = {};
+    channel.gpio_num = config.clockPin;
+    channel.speed_mode = LEDC_HIGH_SPEED_MODE;
+    channel.channel = LEDC_CHANNEL_7;
+    channel.timer_sel = LEDC_TIMER_3;
+    channel.duty = 1;  // 50 %
+    if (ledc_channel_config(&channel) != ESP_OK) return false;
+    // pin zostaje wyjściem LEDC i jednocześnie wejściem PCLK
+    gpio_set_direction((gpio_num_t)config.clockPin, GPIO_MODE_INPUT_OUTPUT);
+    esp_rom_gpio_connect_in_signal(config.clockPin, I2S0I_WS_IN_IDX, false);
+    return true;
+  }
+
+public:
+  LogicAnalyzer()
+      : buffers(nullptr), desc(nullptr), perBuffer(1), seq(0), expectedSeq(1), stats(), queue(nullptr),
+        captureLock(nullptr), task(nullptr), intr(nullptr) {
+    memset(&config, 0, sizeof(config));
+  }
+
+  LogicAnalyzer(const LogicAnalyzer &) = delete;
+  LogicAnalyzer &operator=(const LogicAnalyzer &) = delete;
+
+  // przydział buforów DMA, zegar, I2S0 i task; zapis zaczyna dopiero arm()
+  bool begin(const LogicAnalyzerConfig &cfg) {
+    config = cfg;
+    if (config.bufferCount < 2 || !config.samples || config.clockPin < 0 ||
+        (config.channels != 8 && config.channels != 16))
+      return false;
+    config.samples = (config.samples + 1) & ~1u;
+    uint32_t bytes = config.samples * 2;
+
+    perBuffer = DmaChain::descriptorsFor(bytes);
+    uint32_t descCount = perBuffer * config.bufferCount;
+    desc = (DmaDescriptor *)heap_caps_calloc(descCount, sizeof(DmaDescriptor), MALLOC_CAP_DMA);
+    buffers = (uint16_t **)calloc(config.bufferCount, sizeof(uint16_t *));
+    if (!desc || !buffers) {
+      releaseMemory();
+      return false;
+    }
+    for (uint32_t i = 0; i < config.bufferCount; i++) {
+      buffers[i] = (uint16_t *)heap_caps_calloc(1, bytes, MALLOC_CAP_DMA);
+      if (!buffers[i]) {
+        releaseMemory();
+        return false;
+      }
+    }
+    if (!DmaChain::build(desc, descCount, (uint8_t *const *)buffers, config.bufferCount, bytes)) {
+      releaseMemory();
+      return false;
+    }
+
+    queue = xQueueCreate(config.bufferCount, sizeof(Block));
+    captureLock = xSemaphoreCreateMutex();
+    if (!queue || !captureLock || xTaskCreatePinnedToCore(taskFunction, "logic", LOGIC_TASK_STACK, this, LOGIC_TASK_PRIORITY,
+                                          &task, LOGIC_TASK_CORE) != pdPASS) {
+      task = nullptr;
+      teardown();
+      return false;
+    }
+
+    periph_module_enable(PERIPH_I2S0_MODULE);
+    for (uint32_t i = 0; i < 16; i++) {
+      bool used = i < config.channels && config.dataPins[i] >= 0;
+      if (used) {
+        pinMode(config.dataPins[i], INPUT);
+        esp_rom_gpio_connect_in_signal(config.dataPins[i], I2S0I_DATA_IN0_IDX + i, false);
+      } else {
+        esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ZERO_INPUT, I2S0I_DATA_IN0_IDX + i, false);
+      }
+    }
+    esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ONE_INPUT, I2S0I_V_SYNC_IDX, false);
+    esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ONE_INPUT, I2S0I_H_SYNC_IDX, false);
+    esp_rom_gpio_connect_in_signal(GPIO_MATRIX_CONST_ONE_INPUT, I2S0I_H_ENABLE_IDX, false);
+    if (!startClock()) {
+      teardown();
+      return false;
+    }
+
+    i2s_dev_t &dev = I2S0;
+    dev.conf.rx_reset = 1;
+    dev.conf.rx_reset = 0;
+    dev.conf.rx_fifo_reset = 1;
+    dev.conf.rx_fifo_reset = 0;
+    dev.lc_conf.in_rst = 1;
+    dev.lc_conf.in_rst = 0;
+    dev.lc_conf.ahbm_rst = 1;
+    dev.lc_conf.ahbm_rst = 0;
+    dev.lc_conf.ahbm_fifo_rst = 1;
+    dev.lc_conf.ahbm_fifo_rst = 0;
+
+    dev.conf.rx_slave_mod = 1;  // zegar z PCLK
+    dev.conf.rx_right_first = 0;
+    dev.conf.rx_msb_right = 0;
+    dev.conf.rx_msb_shift = 0;
+    dev.conf.rx_mono = 0;
+    dev.conf.rx_short_sync = 0;
+    dev.conf2.val = 0;
+    dev.conf2.lcd_en = 1;
+    dev.conf2.camera_en = 1;
+    dev.clkm_conf.val = 0;
+    dev.clkm_conf.clkm_div_a = 1;
+    dev.clkm_conf.clkm_div_b = 0;
+    dev.clkm_conf.clkm_div_num = 2;
+    dev.sample_rate_conf.val = 0;
+    dev.sample_rate_conf.rx_bits_mod = 16;
+    dev.sample_rate_conf.rx_bck_div_num = 1;
+    dev.fifo_conf.val = 0;
+    dev.fifo_conf.rx_fifo_mod_force_en = 1;
+    dev.fifo_conf.rx_fifo_mod = 1;  // 16 bit, jeden kanał
+    dev.fifo_conf.rx_data_num = 32;
+    dev.fifo_conf.dscr_en = 1;
+    dev.conf_chan.val = 0;
+    dev.conf_chan.rx_chan_mod = 1;
+    dev.timing.val = 0;
+    dev.rx_eof_num = bytes / 4;  // IN_SUC_EOF po każdym buforze
+
+    dev.int_ena.val = 0;
+    dev.int_clr.val = 0xFFFFFFFF;
+    if (esp_intr_alloc(ETS_I2S0_INTR_SOURCE, I2S_PARALLEL_INTR_FLAGS, onInterrupt, this, &intr) != ESP_OK) {
+      intr = nullptr;
+      ledc_stop(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_7, 0);
+      teardown();
+      return false;
+    }
+    dev.int_ena.in_suc_eof = 1;
+    return true;
+  }
+
+  // uzbrojenie zapisu do storage i start DMA; czeka, aż task skończy bieżący
+  // bufor, więc można uzbroić ponownie w trakcie zapisu
+  void arm(RleRun *storage, uint32_t runs, const LogicTrigger &t, uint32_t pre, uint64_t maxSamples) {
+    i2s_dev_t &dev = I2S0;
+    dev.conf.rx_start = 0;
+    dev.in_link.stop = 1;
+    dev.int_ena.in_suc_eof = 0;  // EOF zatrzymanego DMA nie trafi już do kolejki
+    dev.int_clr.in_suc_eof = 1;
+    xSemaphoreTake(captureLock, portMAX_DELAY);
+    xQueueReset(queue);
+    portENTER_CRITICAL(&mux);
+    stats.buffers = stats.overruns = 0;
+    portEXIT_CRITICAL(&mux);
+    expectedSeq = seq + 1;
+    capture.arm(storage, runs, t, pre, maxSamples, config.channels == 16 ? 0xFFFF : 0x00FF);
+    xSemaphoreGive(captureLock);
+
+    dev.int_ena.in_suc_eof = 1;
+    dev.lc_conf.val = I2S_INDSCR_BURST_EN;
+    dev.in_link.addr = (uint32_t)desc;
+    dev.in_link.start = 1;
+    dev.conf.rx_start = 1;
+  }
+
+  // zatrzymanie DMA, zapis zostaje do pobrania
+  void stop() {
+    I2S0.conf.rx_start = 0;
+    I2S0.in_link.stop = 1;
+    xSemaphoreTake(captureLock, portMAX_DELAY);
+    capture.stop();
+    xSemaphoreGive(captureLock);
+  }
+
+  LogicState getState() const {
+    return capture.getState();
+  }
+
+  const LogicCapture &getCapture() const {
+    return capture;
+  }
+
+  uint32_t getSampleHz() const {
+    return config.sampleHz;
+  }
+
+  uint8_t getChannels() const {
+    return config.channels;
+  }
+
+  LogicAnalyzerStats getStats() {
+    portENTER_CRITICAL(&mux);
+    LogicAnalyzerStats s = stats;
+    portEXIT_CRITICAL(&mux);
+    return s;
+  }
+};
+#endif
+
+#endif // LogicCapture_h
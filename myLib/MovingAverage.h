@@ -1,22 +1,145 @@
 #ifndef MovingAverage_h
 #define MovingAverage_h
 
-#include <Arduino.h>
+#include "Platform.h"
+#include "HotPath.h"
+#include <type_traits>
 
+// ---------------------------------------------------------------
+// Średnia krocząca z bieżącą sumą, update() i get() kosztują O(1).
+//
+// MovingAverage<V, N> - bufor N próbek w obiekcie (bez sterty),
+//   przy N będącym potęgą 2 indeks jest maskowany zamiast porównania.
+// MovingAverage<V>    - rozmiar podawany w konstruktorze, bufor na stercie
+//   (dotychczasowe użycie MovingAverage<double> mAVR(32)).
+//
+// Do pierwszego zapełnienia bufora średnia liczona jest z dotychczasowych
+// próbek. Suma liczb całkowitych jest trzymana w int64_t, więc jest dokładna,
+// a suma float/double kompensowana metodą Kahana, żeby błąd zaokrągleń
+// nie narastał przy ciągłym dodawaniu i odejmowaniu (nie kompilować
+// z -ffast-math, bo kompilator usunie kompensację).
+// ---------------------------------------------------------------
+template <class V, bool isFloat = std::is_floating_point<V>::value>
+class MovingAverageSum;
+
+// suma Kahana dla float/double
 template <class V>
+class MovingAverageSum<V, true>
+{
+private:
+    V sum;
+    V compensation;
+
+public:
+    typedef V Value;
+
+    MovingAverageSum() { reset(); }
+
+    void reset()
+    {
+        sum = 0;
+        compensation = 0;
+    }
+
+    // dodanie nowej i odjęcie najstarszej próbki
+    void replace(V added, V removed)
+    {
+        V y = (added - removed) - compensation;
+        V t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+
+    V get() const { return sum; }
+};
+
+// dokładna suma dla liczb całkowitych
+template <class V>
+class MovingAverageSum<V, false>
+{
+private:
+    int64_t sum;
+
+public:
+    typedef int64_t Value;
+
+    MovingAverageSum() { reset(); }
+
+    void reset() { sum = 0; }
+
+    void replace(V added, V removed) { sum += (int64_t)added - (int64_t)removed; }
+
+    int64_t get() const { return sum; }
+};
+
+template <class V, uint32_t N = 0>
 class MovingAverage
 {
 private:
+    static const bool POW2 = (N & (N - 1)) == 0;
+
+    V dataTab[N];
+    uint32_t index;     // miejsce następnej próbki
+    uint32_t countData; // liczba próbek w buforze, maks. N
+    MovingAverageSum<V> sum;
+
+public:
+    MovingAverage() { reset(); }
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < N; i++)
+            dataTab[i] = 0;
+        index = 0;
+        countData = 0;
+        sum.reset();
+    }
+
+    HOT_FN void update(V dataU)
+    {
+        sum.replace(dataU, dataTab[index]);
+        dataTab[index] = dataU;
+        if (POW2)
+            index = (index + 1) & (N - 1);
+        else if (++index == N)
+            index = 0;
+        if (countData < N)
+            countData++;
+    }
+
+    V get() const
+    {
+        if (countData == N)
+            return (V)(sum.get() / (typename MovingAverageSum<V>::Value)N);
+        if (countData == 0)
+            return 0;
+        return (V)(sum.get() / (typename MovingAverageSum<V>::Value)countData);
+    }
+
+    uint32_t count() const { return countData; }
+
+    bool isFull() const { return countData == N; }
+
+    static uint32_t size() { return N; }
+};
+
+// rozmiar podawany w konstruktorze
+template <class V>
+class MovingAverage<V, 0>
+{
+private:
+    uint32_t index;
     uint32_t countData;
     uint32_t sizeData;
     V *dataTab;
+    MovingAverageSum<V> sum;
 
 public:
     MovingAverage(uint32_t size)
     {
-        countData = 0;
-        sizeData = size;
-        dataTab = new V[size];
+        sizeData = size ? size : 1;
+        dataTab = new V[sizeData];
+        reset();
     }
 
     ~MovingAverage()
@@ -24,22 +147,40 @@ public:
         delete[] dataTab;
     }
 
-    void update(V dataU)
+    MovingAverage(const MovingAverage &) = delete;
+    MovingAverage &operator=(const MovingAverage &) = delete;
+
+    void reset()
+    {
+        for (uint32_t i = 0; i < sizeData; i++)
+            dataTab[i] = 0;
+        index = 0;
+        countData = 0;
+        sum.reset();
+    }
+
+    HOT_FN void update(V dataU)
     {
-        dataTab[countData++] = dataU;
-        if (countData > sizeData)
-            countData = 0;
+        sum.replace(dataU, dataTab[index]);
+        dataTab[index] = dataU;
+        if (++index == sizeData)
+            index = 0;
+        if (countData < sizeData)
+            countData++;
     }
 
-    V get()
+    V get() const
     {
-        double dataOut = 0;
-        for (uint32_t i = 0; i < sizeData; i++)
-        {
-            dataOut += dataTab[i];
-        }
-        return (V)(dataOut / sizeData);
+        if (countData == 0)
+            return 0;
+        return (V)(sum.get() / (typename MovingAverageSum<V>::Value)countData);
     }
+
+    uint32_t count() const { return countData; }
+
+    bool isFull() const { return countData == sizeData; }
+
+    uint32_t size() const { return sizeData; }
 };
 
-#endif // MovingAverage_h
\ No newline at end of file
+#endif // MovingAverage_h
@@ -0,0 +1,105 @@
+#ifndef Platform_h
+#define Platform_h
+
+// ---------------------------------------------------------------
+// Wspólne nagłówki dla myLib.
+// Na ESP32 (ARDUINO) to po prostu <Arduino.h>, natomiast przy budowaniu
+// na PC (PlatformIO [env:native]) dostarczamy minimalne zamienniki
+// millis()/micros()/delay() i Serial, żeby te same pliki dało się
+// uruchomić i zmierzyć na hoście.
+// ---------------------------------------------------------------
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+// czas od startu w us bez przekręcania się co ~71 min jak micros()
+inline uint64_t micros64() {
+  return (uint64_t)esp_timer_get_time();
+}
+
+#else
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#ifndef F
+#define F(s) (s)
+#endif
+
+// czas liczony od pierwszego wywołania, tak jak na ESP32 od startu
+inline uint64_t hostMicros64() {
+  typedef std::chrono::steady_clock clk;
+  static const clk::time_point t0 = clk::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(clk::now() - t0).count();
+}
+
+inline uint64_t micros64() {
+  return hostMicros64();
+}
+
+inline uint32_t micros() {
+  return (uint32_t)hostMicros64();
+}
+
+inline uint32_t millis() {
+  return (uint32_t)(hostMicros64() / 1000);
+}
+
+inline void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void delayMicroseconds(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// minimalny Serial wypisujący na stdout
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+
+  int printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+
+  void print(const char *s) { fputs(s, stdout); }
+  void print(char c) { putchar(c); }
+  void print(int v) { ::printf("%d", v); }
+  void print(unsigned int v) { ::printf("%u", v); }
+  void print(long v) { ::printf("%ld", v); }
+  void print(unsigned long v) { ::printf("%lu", v); }
+  void print(long long v) { ::printf("%lld", v); }
+  void print(unsigned long long v) { ::printf("%llu", v); }
+  void print(double v, int digits = 2) { ::printf("%.*f", digits, v); }
+
+  void println() { putchar('\n'); }
+  template <class T>
+  void println(T v) {
+    print(v);
+    println();
+  }
+  void println(double v, int digits) {
+    print(v, digits);
+    println();
+  }
+
+  void flush() { fflush(stdout); }
+};
+
+static HostSerial Serial __attribute__((unused));
+
+#endif // ARDUINO
+
+#endif // Platform_h
@@ -0,0 +1,209 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include "Platform.h"
+#include "HotPath.h"
+
+// ---------------------------------------------------------------
+// Profiler stref kodu: PROFILE_ZONE("nazwa") zapisuje zdarzenie początku,
+// a przy wyjściu z bloku zdarzenie końca, do bufora kołowego rdzenia,
+// na którym działa kod. Bez alokacji i bez blokad: miejsce w buforze
+// rezerwuje atomowe fetch_add, więc zapis jest bezpieczny z obu rdzeni,
+// z różnych tasków i z przerwań. Najstarsze zdarzenia są nadpisywane.
+//
+// dumpChromeTrace(Serial) wypisuje bufor jako JSON w formacie Chrome
+// trace_event - zapisać do pliku .json i otworzyć w ui.perfetto.dev
+// albo chrome://tracing. Wiersze to rdzenie (pid) i taski (tid).
+// Czas w us z micros(), wspólny dla obu rdzeni.
+//
+// Włączany flagą -DPROFILER_ENABLED=1, przy 0 (domyślnie) PROFILE_ZONE
+// nic nie robi, a bufory nie zajmują pamięci. Przy -DHOTPATH_IRAM=1
+// record() jest w IRAM, więc strefa w funkcji HOT_FN nie skacze do flash
+// (micros() i xTaskGetCurrentTaskHandle() są w IRAM frameworka).
+// ---------------------------------------------------------------
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+// zdarzeń na rdzeń, potęga 2; ProfileEvent to 20 B na ESP32 (2 wskaźniki,
+// 2 x uint32_t, char + wyrównanie), czyli domyślnie 10 KB na rdzeń
+#ifndef PROFILER_RING_SIZE
+#define PROFILER_RING_SIZE 512
+#endif
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILER_ENABLED
+
+#ifdef ARDUINO
+#define PROFILER_CORES portNUM_PROCESSORS
+#else
+#define PROFILER_CORES 1
+#endif
+
+struct ProfileEvent {
+  const char *name;  // literał, zapisywany jest tylko wskaźnik
+  void *task;
+  uint32_t us;
+  uint32_t seq;      // numer slotu + 1, zapisywany na końcu; 0 = w trakcie zapisu
+  char phase;        // 'B' początek, 'E' koniec
+};
+
+class Profiler {
+public:
+  static const uint32_t SIZE = PROFILER_RING_SIZE;
+  static const uint32_t MASK = SIZE - 1;
+  static_assert((SIZE & MASK) == 0, "PROFILER_RING_SIZE musi byc potega 2");
+
+private:
+  struct Ring {
+    ProfileEvent events[SIZE];
+    uint32_t head;
+  };
+
+  Ring rings[PROFILER_CORES];
+  volatile bool enabled;
+
+  HOT_INLINE static uint32_t coreId() {
+#ifdef ARDUINO
+    return xPortGetCoreID();
+#else
+    return 0;
+#endif
+  }
+
+  HOT_INLINE static void *currentTask() {
+#ifdef ARDUINO
+    return xTaskGetCurrentTaskHandle();
+#else
+    return nullptr;
+#endif
+  }
+
+  template <class Out>
+  static void printTaskName(Out &out, void *task) {
+#ifdef ARDUINO
+    out.printf("%s", pcTaskGetName((TaskHandle_t)task));
+#else
+    (void)task;
+    out.printf("main");
+#endif
+  }
+
+public:
+  Profiler() : enabled(true) {
+    reset();
+  }
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  HOT_INLINE static Profiler &instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  void reset() {
+    for (uint32_t c = 0; c < PROFILER_CORES; c++) {
+      rings[c].head = 0;
+      for (uint32_t i = 0; i < SIZE; i++) rings[c].events[i].seq = 0;
+    }
+  }
+
+  void enable(bool on) {
+    enabled = on;
+  }
+
+  HOT_FN void record(const char *name, char phase) {
+    if (!enabled) return;
+    Ring &r = rings[coreId()];
+    uint32_t slot = __atomic_fetch_add(&r.head, 1, __ATOMIC_RELAXED);
+    ProfileEvent &e = r.events[slot & MASK];
+    __atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+    e.name = name;
+    e.task = currentTask();
+    e.us = micros();
+    e.phase = phase;
+    __atomic_store_n(&e.seq, slot + 1, __ATOMIC_RELEASE);
+  }
+
+  // wypisanie bufora jako Chrome trace_event JSON, na czas wypisywania
+  // zapis jest wstrzymany; zdarzenia bez pary na początku bufora są pomijane przez przeglądarkę
+  template <class Out>
+  void dumpChromeTrace(Out &out) {
+    bool wasEnabled = enabled;
+    enabled = false;
+
+    const uint32_t MAX_TASKS = 16;
+    void *tasks[MAX_TASKS];
+    uint32_t taskCore[MAX_TASKS];
+    uint32_t taskCount = 0;
+    bool first = true;
+
+    out.printf("{\"traceEvents\":[\n");
+    for (uint32_t c = 0; c < PROFILER_CORES; c++) {
+      const Ring &r = rings[c];
+      uint32_t head = __atomic_load_n(&r.head, __ATOMIC_ACQUIRE);
+      uint32_t start = head > SIZE ? head - SIZE : 0;
+      for (uint32_t slot = start; slot != head; slot++) {
+        const ProfileEvent &e = r.events[slot & MASK];
+        if (__atomic_load_n(&e.seq, __ATOMIC_ACQUIRE) != slot + 1) continue;
+        out.printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":%u,\"tid\":%u}", first ? "" : ",\n", e.name,
+                   e.phase, (unsigned)e.us, (unsigned)c, (unsigned)(uintptr_t)e.task);
+        first = false;
+
+        uint32_t t = 0;
+        while (t < taskCount && !(tasks[t] == e.task && taskCore[t] == c)) t++;
+        if (t == taskCount && taskCount < MAX_TASKS) {
+          tasks[taskCount] = e.task;
+          taskCore[taskCount] = c;
+          taskCount++;
+        }
+      }
+    }
+    // nazwy wierszy: rdzenie i taski
+    for (uint32_t c = 0; c < PROFILER_CORES; c++) {
+      out.printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+                 first ? "" : ",\n", (unsigned)c, (unsigned)c);
+      first = false;
+    }
+    for (uint32_t t = 0; t < taskCount; t++) {
+      out.printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"",
+                 (unsigned)taskCore[t], (unsigned)(uintptr_t)tasks[t]);
+      printTaskName(out, tasks[t]);
+      out.printf("\"}}");
+    }
+    out.printf("\n]}\n");
+
+    enabled = wasEnabled;
+  }
+};
+
+// strefa od miejsca deklaracji do końca bloku
+class ProfileZone {
+private:
+  const char *name;
+
+public:
+  HOT_INLINE explicit ProfileZone(const char *zoneName) : name(zoneName) {
+    Profiler::instance().record(name, 'B');
+  }
+  HOT_INLINE ~ProfileZone() {
+    Profiler::instance().record(name, 'E');
+  }
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+};
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#else
+
+#define PROFILE_ZONE(name) \
+  do {                     \
+  } while (0)
+
+#endif // PROFILER_ENABLED
+
+#endif // Profiler_h
@@ -0,0 +1,266 @@
+#ifndef RunningMedian_h
+#define RunningMedian_h
+
+#include "Platform.h"
+#include "HotPath.h"
+#include <type_traits>
+
+// ---------------------------------------------------------------
+// Mediana krocząca z N ostatnich próbek, update() w O(log N).
+// Próbki są w buforze kołowym, a ich indeksy w dwóch kopcach wokół
+// mediany (algorytm "Mediator"): poniżej kopiec max, powyżej kopiec min,
+// na pozycji 0 mediana. Każda próbka zna swoje miejsce w kopcu, więc
+// najstarsza jest zastępowana nową w miejscu, bez usuwania leniwego.
+// Cała pamięć jest w obiekcie. Dla parzystej liczby próbek get() zwraca
+// górną z dwóch środkowych (jak posortowane[n / 2]).
+//
+// HampelFilter<T, N> odrzuca pojedyncze szpilki: próbka odległa od
+// mediany o więcej niż k * 1.4826 * MAD jest zastępowana medianą.
+// Przy 1-2 próbkach w oknie mediana to sama szpilka, więc do 3 próbek
+// filtr przepuszcza dane bez zmian; znaną błędną wartość (np. 85.0 z
+// DS18B20 po resecie) odrzuca zawsze setRejectValue().
+// ---------------------------------------------------------------
+template <class T, uint32_t N>
+class RunningMedian
+{
+private:
+    static_assert(N > 0 && N < 0x8000, "N poza zakresem");
+
+    static const int32_t HALF = N / 2;
+
+    T dataTab[N];       // bufor kołowy próbek
+    int16_t pos[N];     // pozycja próbki w kopcu
+    int16_t heapTab[N]; // indeksy próbek, heap(0) to mediana, ujemne - kopiec max
+    uint32_t index;
+    uint32_t countData;
+
+    // pomocnicze funkcje update() - przy -DHOTPATH_IRAM=1 wszystkie w IRAM
+    // (HOT_FN) albo wstawione inline (HOT_INLINE), inaczej -Os wydziela je do flash
+    HOT_INLINE int16_t &heap(int32_t i) { return heapTab[i + HALF]; }
+    HOT_INLINE int16_t heap(int32_t i) const { return heapTab[i + HALF]; }
+
+    // liczba elementów kopców, countData <= N podpowiada kompilatorowi zakres indeksów
+    HOT_INLINE int32_t minCount() const
+    {
+        if (countData > N)
+            __builtin_unreachable();
+        return ((int32_t)countData - 1) / 2;
+    }
+    HOT_INLINE int32_t maxCount() const
+    {
+        if (countData > N)
+            __builtin_unreachable();
+        return (int32_t)countData / 2;
+    }
+
+    HOT_INLINE bool less(int32_t i, int32_t j) const { return dataTab[heap(i)] < dataTab[heap(j)]; }
+
+    // zamiana gdy heap(i) < heap(j), true gdy zamieniono
+    HOT_INLINE bool exchangeIfLess(int32_t i, int32_t j)
+    {
+        if (!less(i, j))
+            return false;
+        int16_t t = heap(i);
+        heap(i) = heap(j);
+        heap(j) = t;
+        pos[heap(i)] = i;
+        pos[heap(j)] = j;
+        return true;
+    }
+
+    // kopiec min w dół od dziecka i
+    HOT_FN void minSortDown(int32_t i)
+    {
+        for (; i <= minCount(); i *= 2)
+        {
+            if (i > 1 && i < minCount() && less(i + 1, i))
+                ++i;
+            if (!exchangeIfLess(i, i / 2))
+                break;
+        }
+    }
+
+    // kopiec max w dół od dziecka i (indeksy ujemne)
+    HOT_FN void maxSortDown(int32_t i)
+    {
+        for (; i >= -maxCount(); i *= 2)
+        {
+            if (i < -1 && i > -maxCount() && less(i, i - 1))
+                --i;
+            if (!exchangeIfLess(i / 2, i))
+                break;
+        }
+    }
+
+    // w górę, true gdy element doszedł do mediany
+    HOT_FN bool minSortUp(int32_t i)
+    {
+        while (i > 0 && exchangeIfLess(i, i / 2))
+            i /= 2;
+        return i == 0;
+    }
+
+    HOT_FN bool maxSortUp(int32_t i)
+    {
+        while (i < 0 && exchangeIfLess(i / 2, i))
+            i /= 2;
+        return i == 0;
+    }
+
+public:
+    RunningMedian() { reset(); }
+
+    void reset()
+    {
+        index = 0;
+        countData = 0;
+        // kolejność zapełniania: mediana, max, min, max, min...
+        for (int32_t k = 0; k < (int32_t)N; k++)
+        {
+            dataTab[k] = 0;
+            pos[k] = ((k + 1) / 2) * ((k & 1) ? -1 : 1);
+            heap(pos[k]) = k;
+        }
+    }
+
+    HOT_FN void update(T dataU)
+    {
+        bool isNew = countData < N;
+        int32_t p = pos[index];
+        T old = dataTab[index];
+        dataTab[index] = dataU;
+        if (++index == N)
+            index = 0;
+        if (isNew)
+            countData++;
+
+        if (p > 0)
+        {
+            if (!isNew && old < dataU)
+                minSortDown(p * 2);
+            else if (minSortUp(p))
+                maxSortDown(-1);
+        }
+        else if (p < 0)
+        {
+            if (!isNew && dataU < old)
+                maxSortDown(p * 2);
+            else if (maxSortUp(p))
+                minSortDown(1);
+        }
+        else
+        {
+            if (maxCount())
+                maxSortDown(-1);
+            if (minCount())
+                minSortDown(1);
+        }
+    }
+
+    HOT_INLINE T get() const
+    {
+        return countData ? dataTab[heap(0)] : 0;
+    }
+
+    HOT_INLINE uint32_t count() const { return countData; }
+
+    bool isFull() const { return countData == N; }
+
+    static uint32_t size() { return N; }
+};
+
+// filtr Hampla działający na bieżąco (bez opóźnienia o N / 2 próbek):
+// nowa próbka trafia do okna, a gdy |x - mediana| > k * 1.4826 * MAD
+// i > minDeviation, zwracana jest mediana zamiast próbki.
+// MAD jest medianą odchyłek |x - mediana| z chwili wstawienia każdej próbki,
+// dzięki temu update() zostaje O(log N) zamiast O(N).
+template <class T, uint32_t N>
+class HampelFilter
+{
+private:
+    // porównanie progów w int64_t dla liczb całkowitych, w T dla float
+    typedef typename std::conditional<std::is_floating_point<T>::value, T, int64_t>::type Wide;
+
+    RunningMedian<T, N> median;
+    RunningMedian<T, N> deviation;
+    static const uint32_t MIN_SAMPLES = 3;  // od tylu próbek w oknie działa próg
+
+    int32_t thresholdQ8;  // k * 1.4826 * 256
+    T minDeviation;
+    T rejectValue;
+    T lastGood;  // ostatnia zwrócona dobra wartość
+    uint32_t outliers;
+    bool hasRejectValue;
+    bool lastOutlier;
+
+public:
+    // k - próg w odchyleniach standardowych, typowo 3
+    HampelFilter(float k = 3.0f, T minDev = 0)
+        : minDeviation(minDev), rejectValue(0), lastGood(0), outliers(0), hasRejectValue(false), lastOutlier(false)
+    {
+        setThreshold(k);
+    }
+
+    void setThreshold(float k)
+    {
+        thresholdQ8 = (int32_t)(k * 1.4826f * 256.0f + 0.5f);
+    }
+
+    // odchyłka, poniżej której próbka nigdy nie jest odrzucana (np. szum 1 LSB przy MAD = 0)
+    void setMinDeviation(T minDev)
+    {
+        minDeviation = minDev;
+    }
+
+    // wartość zawsze odrzucana, nie trafia do okna; update() zwraca wtedy ostatnią dobrą
+    void setRejectValue(T v)
+    {
+        rejectValue = v;
+        hasRejectValue = true;
+    }
+
+    void reset()
+    {
+        median.reset();
+        deviation.reset();
+        lastGood = 0;
+        outliers = 0;
+        lastOutlier = false;
+    }
+
+    // zwraca próbkę albo medianę, gdy próbka jest szpilką
+    HOT_FN T update(T dataU)
+    {
+        if (hasRejectValue && dataU == rejectValue)
+        {
+            lastOutlier = true;
+            outliers++;
+            return lastGood;
+        }
+        median.update(dataU);
+        T med = median.get();
+        T dev = dataU > med ? dataU - med : med - dataU;
+        deviation.update(dev);
+        T mad = deviation.get();
+
+        lastOutlier = median.count() >= MIN_SAMPLES && dev > minDeviation &&
+                      (Wide)dev * 256 > (Wide)thresholdQ8 * (Wide)mad;
+        if (!lastOutlier)
+            return lastGood = dataU;
+        outliers++;
+        return lastGood = med;
+    }
+
+    // false dopóki nie przyszła żadna próbka poza odrzucaną wartością
+    bool ready() const { return median.count() != 0; }
+
+    T getMedian() const { return median.get(); }
+
+    T getMad() const { return deviation.get(); }
+
+    bool isOutlier() const { return lastOutlier; }
+
+    uint32_t getOutliers() const { return outliers; }
+};
+
+#endif // RunningMedian_h
@@ -0,0 +1,257 @@
+#ifndef Sampler_h
+#define Sampler_h
+
+#include "Platform.h"
+
+// ---------------------------------------------------------------
+// Profiler próbkujący: przerwanie timera sprzętowego co SAMPLER_PERIOD_US
+// zapisuje adres (PC) przerwanego kodu i task, który wtedy działał.
+// Próbki są od razu zliczane w stałej tablicy (histogram PC -> liczba),
+// więc próbkowanie może trwać dowolnie długo bez dodatkowej pamięci.
+// W przeciwieństwie do PROFILE_ZONE nie trzeba niczego oznaczać w kodzie,
+// widać też czas spędzony w bibliotekach (WebServer, OneWire, String...).
+//
+// PC jest odczytywany z ramki zapisanej przez port FreeRTOS przy wejściu
+// do przerwania (pxTopOfStack bieżącego taska): XtExcFrame.pc na Xtensa,
+// RvExcFrame.mepc na RISC-V. Próbkowany jest tylko rdzeń, na którym
+// wywołano begin() (w Arduino setup() i loop() działają na rdzeniu 1).
+// Okres domyślnie nie jest wielokrotnością 1 ms, żeby próbki nie
+// zsynchronizowały się z tickiem FreeRTOS i timerami co N ms.
+//
+// dump(Serial) wypisuje histogram jako tekst, adresy zamienia na nazwy
+// funkcji skrypt myLib/tools/sampler_symbolize.py z plikiem firmware.elf.
+//
+// Włączany flagą -DSAMPLER_ENABLED=1, przy 0 (domyślnie) nic nie jest kompilowane.
+// ---------------------------------------------------------------
+#ifndef SAMPLER_ENABLED
+#define SAMPLER_ENABLED 0
+#endif
+
+// okres próbkowania, 1009 us ~ 991 Hz
+#ifndef SAMPLER_PERIOD_US
+#define SAMPLER_PERIOD_US 1009
+#endif
+
+// różnych adresów w histogramie, potęga 2, 8 B na adres
+#ifndef SAMPLER_SLOTS
+#define SAMPLER_SLOTS 1024
+#endif
+
+#ifndef SAMPLER_TASKS
+#define SAMPLER_TASKS 16
+#endif
+
+#if SAMPLER_ENABLED
+
+#ifdef ARDUINO
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "driver/gptimer.h"
+#else
+#include "driver/timer.h"
+// HwSoftTimer używa TIMER_GROUP_1 / TIMER_0
+#ifndef SAMPLER_TIMER_GROUP
+#define SAMPLER_TIMER_GROUP TIMER_GROUP_1
+#endif
+#ifndef SAMPLER_TIMER_INDEX
+#define SAMPLER_TIMER_INDEX TIMER_1
+#endif
+#endif
+
+// pozycja PC w ramce przerwania: XtExcFrame {exit, pc, ...}, RvExcFrame {mepc, ...}
+#ifdef __XTENSA__
+#define SAMPLER_FRAME_PC 1
+#else
+#define SAMPLER_FRAME_PC 0
+#endif
+#endif
+
+class Sampler {
+public:
+  static const uint32_t SLOTS = SAMPLER_SLOTS;
+  static const uint32_t MASK = SLOTS - 1;
+  static const uint32_t MAX_PROBE = 16;
+  static_assert((SLOTS & MASK) == 0, "SAMPLER_SLOTS musi byc potega 2");
+
+private:
+  uint32_t pcTab[SLOTS];  // 0 = wolne miejsce
+  uint32_t countTab[SLOTS];
+  void *taskTab[SAMPLER_TASKS];
+  uint32_t taskCount[SAMPLER_TASKS];
+  uint32_t samples;
+  uint32_t dropped;   // próbki bez miejsca w tablicy adresów
+  uint32_t periodUs;
+  uint32_t core;
+  volatile bool enabled;
+
+#ifdef ARDUINO
+#if ESP_IDF_VERSION_MAJOR >= 5
+  gptimer_handle_t gptimer;
+#endif
+
+  // ramka przerwanego taska; przy przerwaniu zagnieżdżonym to nadal ramka
+  // taska sprzed pierwszego przerwania
+  static void onInterrupt(Sampler *s) {
+    void *task = xTaskGetCurrentTaskHandle();
+    uint32_t *frame = *(uint32_t **)task;  // pxTopOfStack, pierwsze pole TCB
+    s->sample(frame[SAMPLER_FRAME_PC], task);
+  }
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  static bool IRAM_ATTR onAlarm(gptimer_handle_t, const gptimer_alarm_event_data_t *, void *arg) {
+    onInterrupt((Sampler *)arg);
+    return false;
+  }
+#else
+  static bool IRAM_ATTR onAlarm(void *arg) {
+    onInterrupt((Sampler *)arg);
+    return false;
+  }
+#endif
+#endif
+
+  template <class Out>
+  static void printTaskName(Out &out, void *task) {
+#ifdef ARDUINO
+    out.printf("%s", pcTaskGetName((TaskHandle_t)task));
+#else
+    out.printf("%p", task);
+#endif
+  }
+
+public:
+  Sampler() : periodUs(SAMPLER_PERIOD_US), core(0), enabled(false) {
+    reset();
+  }
+
+  Sampler(const Sampler &) = delete;
+  Sampler &operator=(const Sampler &) = delete;
+
+  static Sampler &instance() {
+    static Sampler sampler;
+    return sampler;
+  }
+
+#ifdef ARDUINO
+  // uruchomienie timera na bieżącym rdzeniu, wywołać w setup()
+  bool begin(uint32_t period = SAMPLER_PERIOD_US) {
+    periodUs = period;
+    core = xPortGetCoreID();
+    enabled = true;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+    gptimer_config_t config = {};
+    config.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    config.direction = GPTIMER_COUNT_UP;
+    config.resolution_hz = 1000000;  // 1 tick = 1 us
+    if (gptimer_new_timer(&config, &gptimer) != ESP_OK) return false;
+
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = onAlarm;
+    gptimer_register_event_callbacks(gptimer, &callbacks, this);
+
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = period;
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+    gptimer_set_alarm_action(gptimer, &alarm);
+
+    gptimer_enable(gptimer);
+    return gptimer_start(gptimer) == ESP_OK;
+#else
+    timer_config_t config = {};
+    config.divider = 80;  // APB 80 MHz -> 1 us
+    config.counter_dir = TIMER_COUNT_UP;
+    config.counter_en = TIMER_PAUSE;
+    config.alarm_en = TIMER_ALARM_EN;
+    config.auto_reload = TIMER_AUTORELOAD_EN;
+    if (timer_init(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX, &config) != ESP_OK) return false;
+
+    timer_set_counter_value(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX, 0);
+    timer_set_alarm_value(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX, period);
+    timer_enable_intr(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX);
+    timer_isr_callback_add(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX, onAlarm, this, 0);
+    return timer_start(SAMPLER_TIMER_GROUP, SAMPLER_TIMER_INDEX) == ESP_OK;
+#endif
+  }
+#endif
+
+  void reset() {
+    bool wasEnabled = enabled;
+    enabled = false;
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      pcTab[i] = 0;
+      countTab[i] = 0;
+    }
+    for (uint32_t t = 0; t < SAMPLER_TASKS; t++) {
+      taskTab[t] = nullptr;
+      taskCount[t] = 0;
+    }
+    samples = 0;
+    dropped = 0;
+    enabled = wasEnabled;
+  }
+
+  // wstrzymanie i wznowienie zliczania bez zatrzymywania timera
+  void enable(bool on) {
+    enabled = on;
+  }
+
+  // zapis jednej próbki, wołany z przerwania (na PC można wołać ręcznie)
+  void sample(uint32_t pc, void *task) {
+    if (!enabled) return;
+    samples++;
+
+    uint32_t t = 0;
+    while (t < SAMPLER_TASKS && taskTab[t] != task && taskTab[t] != nullptr) t++;
+    if (t < SAMPLER_TASKS) {
+      taskTab[t] = task;
+      taskCount[t]++;
+    }
+
+    uint32_t i = ((pc >> 1) * 2654435761u) >> 16;  // hash Knutha
+    for (uint32_t probe = 0; probe < MAX_PROBE; probe++, i++) {
+      uint32_t &slot = pcTab[i & MASK];
+      if (slot == pc || slot == 0) {
+        slot = pc;
+        countTab[i & MASK]++;
+        return;
+      }
+    }
+    dropped++;
+  }
+
+  uint32_t getSamples() const {
+    return samples;
+  }
+
+  uint32_t getDropped() const {
+    return dropped;
+  }
+
+  // histogram jako tekst dla sampler_symbolize.py, na czas wypisywania
+  // zliczanie jest wstrzymane
+  template <class Out>
+  void dump(Out &out) {
+    bool wasEnabled = enabled;
+    enabled = false;
+
+    out.printf("# sampler period_us=%u core=%u samples=%u dropped=%u\n", (unsigned)periodUs, (unsigned)core,
+               (unsigned)samples, (unsigned)dropped);
+    for (uint32_t t = 0; t < SAMPLER_TASKS && taskTab[t] != nullptr; t++) {
+      out.printf("task ");
+      printTaskName(out, taskTab[t]);
+      out.printf(" %u\n", (unsigned)taskCount[t]);
+    }
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      if (countTab[i]) out.printf("pc 0x%08x %u\n", (unsigned)pcTab[i], (unsigned)countTab[i]);
+    }
+    out.printf("# end\n");
+
+    enabled = wasEnabled;
+  }
+};
+
+#endif // SAMPLER_ENABLED
+
+#endif // Sampler_h
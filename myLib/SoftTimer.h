@@ -1,56 +1,113 @@
 #ifndef SoftTimer_h
 #define SoftTimer_h
 
-//#include <Arduino.h>
+#include "TimerService.h"
 // ---------------------------------------------------------------
-class SoftTimer {
+// SoftTimer jest uchwytem na węzeł w kole czasowym TimerService.
+// Wszystkie timery obsługuje jedno wywołanie TimerService::instance().poll()
+// w loop(), update() zostało dla zgodności ze starym kodem.
+// Service to TimerService, TimerServiceMicros albo HwTimerDispatcher
+// (HwSoftTimer.h), każdy z metodami instance(), arm(), cancel() i poll().
+// ---------------------------------------------------------------
+template <class Service>
+class BasicSoftTimer {
+public:
+  typedef TimerNode::CallbackFunction CallbackFunction;
+
 private:
-  typedef void (*CallbackFunction)();
-  CallbackFunction callback;
-  uint32_t interval;
-  volatile uint32_t prevTime;
-  volatile uint32_t nowTime;
-  bool f_start;  //główna flaga włączająca timer
+  Service *service;
+  TimerNode node;
+  uint32_t interval;  // w jednostkach serwisu, węzeł może trzymać przeliczoną wartość
+
+  void init(uint32_t timeInterval, const CallbackFunction &cb, bool OnOff, TimerMode mode) {
+    node.callback = cb;
+    interval = timeInterval;
+    node.mode = mode;
+    if (OnOff) start();
+  }
 
 public:
   /*
   timeInterval - intrerwał dla CallbackFunction
-  cb - nazwa CallbackFunction
+  cb - nazwa CallbackFunction, funkcja z kontekstem TimerCallback(fn, ctx) albo mała lambda
   OnOff - timer startuje od razu(true) lub po wywołaniu metody start
+  mode - TIMER_FIXED_DELAY (domyślnie) lub TIMER_FIXED_RATE dla stałej fazy
   */
-  SoftTimer(uint32_t timeInterval, CallbackFunction cb, bool OnOff) {
-    f_start = false;
-    callback = cb;
-    interval = timeInterval;
-    if (OnOff) start();
+  BasicSoftTimer(uint32_t timeInterval, const CallbackFunction &cb, bool OnOff, TimerMode mode = TIMER_FIXED_DELAY)
+    : service(&Service::instance()) {
+    init(timeInterval, cb, OnOff, mode);
+  }
+
+  // timer obsługiwany przez wskazany serwis zamiast domyślnego
+  BasicSoftTimer(Service &svc, uint32_t timeInterval, const CallbackFunction &cb, bool OnOff,
+                 TimerMode mode = TIMER_FIXED_DELAY)
+    : service(&svc) {
+    init(timeInterval, cb, OnOff, mode);
   }
 
-  // uruchomienie timera jeżeli nie został uruchomiony przy tworzeniu obiektu
+  // stop() w HwTimerDispatcher usuwa też wygaśnięcia czekające w kolejce
+  ~BasicSoftTimer() {
+    stop();
+  }
+
+  BasicSoftTimer(const BasicSoftTimer &) = delete;
+  BasicSoftTimer &operator=(const BasicSoftTimer &) = delete;
+
+  // uruchomienie timera jeżeli nie został uruchomiony przy tworzeniu obiektu,
+  // faza trybu TIMER_FIXED_RATE liczona jest od tego momentu
   void start() {
-    prevTime = millis();
-    f_start = true;
+    node.missed = 0;
+    service->arm(node, interval);
   }
 
   // zatrzymanie timera
   void stop() {
-    f_start = false;
+    service->cancel(node);
   }
 
-  // restart timera
-  void restart(uint32_t newTimeInterval, CallbackFunction cb, bool OnOff) {
-    SoftTimer(newTimeInterval, cb, OnOff);
+  // restart timera z nowym interwałem i callbackiem
+  void restart(uint32_t newTimeInterval, const CallbackFunction &cb, bool OnOff) {
+    stop();
+    init(newTimeInterval, cb, OnOff, node.mode);
   }
 
-  // metoda która musi być uruchomiona w głównej pętli programu żeby timer wogóle działał
+  bool isRunning() const {
+    return node.armed();
+  }
+
+  // tryb zmieniony w trakcie pracy obowiązuje od następnego wygaśnięcia
+  void setMode(TimerMode mode) {
+    node.mode = mode;
+  }
+
+  TimerMode getMode() const {
+    return node.mode;
+  }
+
+  // liczba okresów pominiętych, bo obsługa przyszła później niż cały interwał
+  uint32_t getMissedTicks() const {
+    return node.missed;
+  }
+
+#if SOFTTIMER_STATS
+  // statystyka spóźnień callbacka (SOFTTIMER_STATS=1), kopia do wypisania lub wysłania;
+  // przy HwSoftTimer zapisywana w tasku dispatchera, odczyt nie jest atomowy
+  TimerLateness getLateness() const {
+    return node.lateness;
+  }
+
+  void resetLateness() {
+    node.lateness.reset();
+  }
+#endif
+
+  // dla zgodności, obsługuje wszystkie timery serwisu a nie tylko ten jeden
   void update() {
-    if (f_start) {
-      nowTime = millis();
-      if ((prevTime + interval) <= nowTime) {
-        callback();
-        prevTime = nowTime;
-      }
-    }
+    service->poll();
   }
 };
+
+typedef BasicSoftTimer<TimerService> SoftTimer;
+typedef BasicSoftTimer<TimerServiceMicros> SoftTimerMicros;
 // ---------------------------------------------------------------
-#endif /* SoftTimer_h */
\ No newline at end of file
+#endif /* SoftTimer_h */
@@ -0,0 +1,349 @@
+#ifndef TimerService_h
+#define TimerService_h
+
+#include "Platform.h"
+#include "InplaceCallback.h"
+#include "TimerStats.h"
+
+// ---------------------------------------------------------------
+// Hierarchiczne koło czasowe (timing wheel) dla wszystkich SoftTimer-ów.
+// Jedno wywołanie poll() w loop() obsługuje dowolną liczbę timerów,
+// a uzbrojenie, anulowanie i wygaśnięcie timera kosztują O(1).
+//
+// TIMER_WHEEL_LEVELS poziomów po 2^TIMER_WHEEL_BITS slotów, jeden tick
+// to jedna jednostka zegara (ms dla MillisClock). Domyślnie 4 x 64 sloty
+// pokrywają 2^24 ticków (~4.6 h), dłuższe interwały są przekładane.
+// ---------------------------------------------------------------
+#ifndef TIMER_WHEEL_BITS
+#define TIMER_WHEEL_BITS 6
+#endif
+
+#ifndef TIMER_WHEEL_LEVELS
+#define TIMER_WHEEL_LEVELS 4
+#endif
+
+// bufor na lambdę przechwytującą kontekst w callbacku timera
+#ifndef TIMER_CALLBACK_SIZE
+#define TIMER_CALLBACK_SIZE (2 * sizeof(void *))
+#endif
+
+typedef InplaceCallback<TIMER_CALLBACK_SIZE> TimerCallback;
+
+// zegar w milisekundach dla koła czasowego
+struct MillisClock {
+  static const uint32_t TICKS_PER_MS = 1;
+  static uint32_t now() {
+    return millis();
+  }
+  // us od początku bieżącego ticka, dokładność statystyki spóźnień
+  static uint32_t subTickUs() {
+    return (uint32_t)(micros64() % 1000);
+  }
+};
+
+// zegar w mikrosekundach (micros() to młodsze 32 bity esp_timer_get_time()),
+// przekręca się co ~71 min, maksymalny interwał to 2^31 us (~35 min)
+struct MicrosClock {
+  static const uint32_t TICKS_PER_MS = 1000;
+  static uint32_t now() {
+    return micros();
+  }
+  static uint32_t subTickUs() {
+    return 0;
+  }
+};
+
+// zegar sterowany ręcznie, do sprawdzania kolejności i opóźnień na PC
+struct MockClock {
+  static const uint32_t TICKS_PER_MS = 1000;
+  static uint32_t &time() {
+    static uint32_t t = 0;
+    return t;
+  }
+  static uint32_t now() {
+    return time();
+  }
+  static void set(uint32_t t) {
+    time() = t;
+  }
+  static void advance(uint32_t dt) {
+    time() += dt;
+  }
+  static uint32_t subTickUs() {
+    return 0;
+  }
+};
+
+// sposób wyznaczania następnego wygaśnięcia timera okresowego
+enum TimerMode : uint8_t {
+  TIMER_FIXED_DELAY,  // następne wygaśnięcie = moment obsługi + interwał (jak dotychczas)
+  TIMER_FIXED_RATE    // następne wygaśnięcie = poprzednie + interwał, bez dryfu fazy
+};
+
+// węzeł timera w kole, lista jednokierunkowa z pprev (jak hlist w Linuksie)
+struct TimerNode {
+  typedef TimerCallback CallbackFunction;
+
+  TimerNode *next;
+  TimerNode **pprev;  // nullptr gdy timer nie jest uzbrojony
+  uint32_t expiry;    // tick najbliższego wygaśnięcia
+  uint32_t interval;
+  uint32_t missed;    // pominięte ticki w trybie TIMER_FIXED_RATE
+  uint32_t generation;  // zmieniana przy arm/cancel w HwTimerDispatcher, unieważnia wpisy w kolejce
+  CallbackFunction callback;
+  TimerMode mode;
+#if SOFTTIMER_STATS
+  TimerLateness lateness;  // spóźnienie wywołań względem terminu
+#endif
+
+  TimerNode()
+    : next(nullptr), pprev(nullptr), expiry(0), interval(0), missed(0), generation(0), mode(TIMER_FIXED_DELAY) {}
+
+  bool armed() const {
+    return pprev != nullptr;
+  }
+};
+
+template <class Clock>
+class BasicTimerService {
+public:
+  static const uint32_t BITS = TIMER_WHEEL_BITS;
+  static const uint32_t LEVELS = TIMER_WHEEL_LEVELS;
+  static const uint32_t SLOTS = 1u << BITS;
+  static const uint32_t MASK = SLOTS - 1;
+  static const uint32_t RANGE = 1u << (BITS * LEVELS);
+  static const uint32_t MAX_INTERVAL = 0x7FFFFFFFu;
+  static const uint32_t TICKS_PER_MS = Clock::TICKS_PER_MS;
+
+  static_assert(BITS <= 6, "bitmapa slotow poziomu 0 miesci sie w uint64_t");
+  static_assert(BITS * LEVELS < 32, "zakres kola musi byc mniejszy niz 2^32 tickow");
+
+private:
+  TimerNode *wheel[LEVELS][SLOTS];
+  uint64_t occupied;  // niepuste sloty poziomu 0 (mogą być nieaktualne po cancel)
+  uint32_t current;   // następny tick do obsłużenia
+  uint32_t count;     // liczba uzbrojonych timerów
+  bool polling;
+
+  static void link(TimerNode **head, TimerNode &node) {
+    node.next = *head;
+    if (node.next) node.next->pprev = &node.next;
+    *head = &node;
+    node.pprev = head;
+  }
+
+  static void unlink(TimerNode &node) {
+    *node.pprev = node.next;
+    if (node.next) node.next->pprev = node.pprev;
+    node.next = nullptr;
+    node.pprev = nullptr;
+  }
+
+  // wstawienie do slotu wynikającego z odległości do wygaśnięcia
+  void insert(TimerNode &node) {
+    int32_t d = (int32_t)(node.expiry - current);
+    uint32_t delta = d < 0 ? 0 : (uint32_t)d;
+    if (delta >= RANGE) delta = RANGE - 1;  // zostanie przełożony przy kaskadzie
+    uint32_t tick = current + delta;
+
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && delta >= (1u << ((level + 1) * BITS))) level++;
+
+    uint32_t slot = (tick >> (level * BITS)) & MASK;
+    if (level == 0) occupied |= (uint64_t)1 << slot;
+    link(&wheel[level][slot], node);
+  }
+
+  // przeniesienie timerów z wyższych poziomów na początku każdego obrotu poziomu 0
+  void cascade() {
+    for (uint32_t level = 1; level < LEVELS; level++) {
+      uint32_t slot = (current >> (level * BITS)) & MASK;
+      TimerNode *list = wheel[level][slot];
+      wheel[level][slot] = nullptr;
+      while (list) {
+        TimerNode *node = list;
+        list = node->next;
+        node->next = nullptr;
+        insert(*node);
+      }
+      if (slot != 0) break;
+    }
+  }
+
+  // wszystkie porównania czasu są względne (różnica uint32_t), więc
+  // przekręcenie się millis()/micros() niczego nie psuje
+  static void reschedule(TimerNode &node, uint32_t now) {
+    if (node.mode == TIMER_FIXED_RATE && node.interval > 0) {
+      int32_t late = (int32_t)(now - node.expiry);
+      uint32_t skipped = late > 0 ? (uint32_t)late / node.interval : 0;
+      node.missed += skipped;
+      node.expiry += (skipped + 1) * node.interval;
+    } else {
+      node.expiry = now + node.interval;
+    }
+  }
+
+  // spóźnienie w us względem terminu deadline (w tickach zegara)
+  static uint32_t latenessUs(uint32_t deadline) {
+    uint32_t late = Clock::now() - deadline;
+    if ((int32_t)late < 0) return 0;
+    return late * (1000 / TICKS_PER_MS) + Clock::subTickUs();
+  }
+
+  // domyślna obsługa wygaśnięcia - wywołanie callbacka timera
+  struct CallCallback {
+#if SOFTTIMER_STATS
+    void operator()(TimerNode &node, uint32_t deadline) const {
+      node.lateness.add(latenessUs(deadline));
+      node.callback();
+    }
+#else
+    void operator()(TimerNode &node, uint32_t) const {
+      node.callback();
+    }
+#endif
+  };
+
+  template <class Fn>
+  void expire(uint32_t slot, uint32_t now, Fn &fn) {
+    occupied &= ~((uint64_t)1 << slot);
+    TimerNode *local = wheel[0][slot];
+    wheel[0][slot] = nullptr;
+    if (local) local->pprev = &local;
+    current++;
+
+    while (local) {
+      TimerNode &node = *local;
+      unlink(node);
+      uint32_t deadline = node.expiry;
+      reschedule(node, now);
+      insert(node);
+      fn(node, deadline);  // callback może zatrzymać lub przezbroić dowolny timer
+    }
+  }
+
+public:
+  BasicTimerService() : occupied(0), current(0), count(0), polling(false) {
+    for (uint32_t l = 0; l < LEVELS; l++)
+      for (uint32_t s = 0; s < SLOTS; s++) wheel[l][s] = nullptr;
+  }
+
+  BasicTimerService(const BasicTimerService &) = delete;
+  BasicTimerService &operator=(const BasicTimerService &) = delete;
+
+  // domyślna instancja używana przez SoftTimer
+  static BasicTimerService &instance() {
+    static BasicTimerService service;
+    return service;
+  }
+
+  // uzbrojenie (lub przezbrojenie) timera, pierwsze wygaśnięcie za interval ticków
+  void arm(TimerNode &node, uint32_t interval) {
+    if (node.armed()) cancel(node);
+    uint32_t now = Clock::now();
+    if (count == 0) current = now;  // puste koło można przesunąć od razu
+    if (interval > MAX_INTERVAL) interval = MAX_INTERVAL;
+    node.interval = interval;
+    node.expiry = now + interval;
+    insert(node);
+    count++;
+  }
+
+  void cancel(TimerNode &node) {
+    if (!node.armed()) return;
+    unlink(node);
+    count--;
+  }
+
+  uint32_t armedCount() const {
+    return count;
+  }
+
+  // tick najbliższego wygaśnięcia spośród uzbrojonych timerów, false gdy brak
+  bool nextExpiry(uint32_t &expiry) const {
+    if (count == 0) return false;
+
+    // poziom 0: pierwszy niepusty slot od current, wszystkie jego timery mają ten sam tick
+    bool found = false;
+    uint32_t idx = current & MASK;
+    for (uint32_t k = 0; k < SLOTS; k++) {
+      if (wheel[0][(idx + k) & MASK]) {
+        expiry = current + k;
+        found = true;
+        break;
+      }
+    }
+
+    // wyższe poziomy: slot bieżącego bloku i pierwszy niepusty po nim,
+    // dalsze sloty danego poziomu wygasają na pewno później
+    for (uint32_t level = 1; level < LEVELS; level++) {
+      idx = (current >> (level * BITS)) & MASK;
+      for (uint32_t k = 0; k < SLOTS; k++) {
+        const TimerNode *node = wheel[level][(idx + k) & MASK];
+        if (!node) continue;
+        for (; node; node = node->next) {
+          if (!found || (int32_t)(node->expiry - expiry) < 0) expiry = node->expiry;
+          found = true;
+        }
+        if (k > 0) break;
+      }
+    }
+    return found;
+  }
+
+  // ticki do najbliższego wygaśnięcia, 0 gdy coś już czeka, 0xFFFFFFFF gdy nie ma timerów
+  uint32_t ticksToNextExpiry() const {
+    uint32_t expiry;
+    if (!nextExpiry(expiry)) return 0xFFFFFFFFu;
+    int32_t d = (int32_t)(expiry - Clock::now());
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+  // jedyny punkt wejścia z loop(), obsługuje wszystkie ticki od ostatniego wywołania
+  void poll() {
+    CallCallback fn;
+    poll(fn);
+  }
+
+  // wariant z własną obsługą wygaśnięcia fn(node, deadline), np. kolejkowanie z ISR
+  template <class Fn>
+  void poll(Fn &fn) {
+    if (polling) return;  // wywołanie z wnętrza callbacka
+    uint32_t now = Clock::now();
+    if (count == 0) {
+      current = now + 1;
+      return;
+    }
+    polling = true;
+    while ((int32_t)(now - current) >= 0) {
+      uint32_t slot = current & MASK;
+      if (slot == 0) cascade();
+
+      uint64_t pending = occupied >> slot;
+      uint32_t left = now - current;
+      if (pending == 0) {
+        uint32_t skip = SLOTS - slot;  // nic do końca obrotu
+        if (left < skip) {
+          current = now + 1;
+          break;
+        }
+        current += skip;
+        continue;
+      }
+
+      uint32_t step = __builtin_ctzll(pending);
+      if (left < step) {
+        current = now + 1;
+        break;
+      }
+      current += step;
+      expire(slot + step, now, fn);
+    }
+    polling = false;
+  }
+};
+
+typedef BasicTimerService<MillisClock> TimerService;
+typedef BasicTimerService<MicrosClock> TimerServiceMicros;
+
+#endif // TimerService_h
@@ -0,0 +1,90 @@
+#ifndef TimerStats_h
+#define TimerStats_h
+
+#include "Platform.h"
+
+// ---------------------------------------------------------------
+// Statystyka spóźnień callbacków SoftTimer-a względem terminu.
+// Włączana flagą -DSOFTTIMER_STATS=1 w build_flags, przy 0 (domyślnie)
+// węzeł timera nie ma tych pól i nic nie jest mierzone.
+// Histogram ma TIMER_STATS_BUCKETS przedziałów logarytmicznych:
+// [0, 128) us, [128, 256) us, [256, 512) us ... ostatni otwarty.
+// ---------------------------------------------------------------
+#ifndef SOFTTIMER_STATS
+#define SOFTTIMER_STATS 0
+#endif
+
+#ifndef TIMER_STATS_BUCKETS
+#define TIMER_STATS_BUCKETS 12
+#endif
+
+#define TIMER_STATS_FIRST_BITS 7  // pierwszy przedział to 2^7 us
+
+// bufor na najdłuższy wynik toJson(): 72 B części stałej (z 3 liczbami
+// 32-bit) + NUL i do 11 B (przecinek + 10 cyfr) na przedział
+#define TIMER_STATS_JSON_BYTES (80 + 11 * TIMER_STATS_BUCKETS)
+
+struct TimerLateness {
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t buckets[TIMER_STATS_BUCKETS];
+
+  TimerLateness() {
+    reset();
+  }
+
+  void reset() {
+    count = 0;
+    maxUs = 0;
+    sumUs = 0;
+    for (uint32_t i = 0; i < TIMER_STATS_BUCKETS; i++) buckets[i] = 0;
+  }
+
+  static uint32_t bucketOf(uint32_t us) {
+    uint32_t log2 = 31 - __builtin_clz(us | 1);
+    if (log2 < TIMER_STATS_FIRST_BITS) return 0;
+    uint32_t b = log2 - TIMER_STATS_FIRST_BITS + 1;
+    return b < TIMER_STATS_BUCKETS ? b : TIMER_STATS_BUCKETS - 1;
+  }
+
+  // dolna granica przedziału w us
+  static uint32_t bucketLowUs(uint32_t bucket) {
+    return bucket == 0 ? 0 : 1u << (bucket + TIMER_STATS_FIRST_BITS - 1);
+  }
+
+  void add(uint32_t us) {
+    count++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+    buckets[bucketOf(us)]++;
+  }
+
+  uint32_t meanUs() const {
+    return count ? (uint32_t)(sumUs / count) : 0;
+  }
+
+  // wypisanie w jednej linii, np. na Serial
+  template <class Out>
+  void print(Out &out, const char *name) const {
+    out.printf("%s: n=%u mean=%u us max=%u us |", name, (unsigned)count, (unsigned)meanUs(), (unsigned)maxUs);
+    for (uint32_t i = 0; i < TIMER_STATS_BUCKETS; i++) out.printf(" %u", (unsigned)buckets[i]);
+    out.printf("\n");
+  }
+
+  // JSON do bufora (np. dla WebServer) o rozmiarze TIMER_STATS_JSON_BYTES,
+  // zwraca długość jak snprintf
+  int toJson(char *buf, size_t len) const {
+    int n = snprintf(buf, len, "{\"count\":%u,\"meanUs\":%u,\"maxUs\":%u,\"buckets\":[", (unsigned)count,
+                     (unsigned)meanUs(), (unsigned)maxUs);
+    for (uint32_t i = 0; i < TIMER_STATS_BUCKETS; i++) {
+      size_t used = n < (int)len ? n : len;
+      n += snprintf(buf + used, len - used, i ? ",%u" : "%u", (unsigned)buckets[i]);
+    }
+    size_t used = n < (int)len ? n : len;
+    n += snprintf(buf + used, len - used, "]}");
+    return n;
+  }
+};
+
+#endif // TimerStats_h
@@ -0,0 +1,450 @@
+#ifndef Vga_h
+#define Vga_h
+
+#include "Platform.h"
+#include "I2sParallel.h"
+#include "Font8x8.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------
+// Wyjście VGA z I2S1 + DMA (I2sParallel) bez bufora ramki.
+// W pierścieniu jest tylko VGA_LINE_BUFFERS linii (każda z porchami
+// i synchronizacją), przerwanie EOF po wysłaniu linii rysuje w jej
+// buforze linię o VGA_LINE_BUFFERS dalej. Obraz pochodzi z warstwy
+// tekstu/kafelków (VgaTextLayer): komórki 8 px szerokości z kodem
+// znaku i dwoma kolorami, wiersz glifu powielany scaleY razy.
+// 640x480 z czcionką 8x8 i scaleY = 2: 80x30 znaków, 7.2 KB komórek
+// i 4 x 1600 B linii zamiast 300 KB ramki.
+//
+// Bajt na piksel jak w FabGL na TTGO VGA32 v1.2 (płytka TTGO_VGA_1.2A):
+// bit 0..1 R, 2..3 G, 4..5 B (po 2 bity), 6 HSYNC, 7 VSYNC.
+// Zegar pikseli z APLL (25.175 MHz dla 640x480@60).
+//
+// Część poziomego wygaszania i synchronizacji jest przepisywana tylko
+// gdy w buforze była inna linia (widoczna / wygaszona / VSYNC), dla
+// zwykłych linii przerwanie rysuje tylko 640 pikseli.
+// Pominięte przerwanie (np. długi zapis do flash) zostawia w buforze
+// starą linię i przesuwa obraz o jedną linię w tej klatce, monitor
+// łapie synchronizację od nowa.
+//
+// VgaTextLayer i VgaScanout nie zależą od sprzętu, na PC VgaHostFrame
+// składa z nich całą klatkę, sprawdza synchronizację i zapisuje PPM.
+// ---------------------------------------------------------------
+
+#define VGA_HSYNC_BIT 0x40
+#define VGA_VSYNC_BIT 0x80
+
+// linii w pierścieniu DMA, rysowanie ma (VGA_LINE_BUFFERS - 1) linii zapasu
+#ifndef VGA_LINE_BUFFERS
+#define VGA_LINE_BUFFERS 4
+#endif
+
+struct VgaTiming {
+  uint32_t pixelHz;
+  uint16_t hVisible, hFront, hSync, hBack;
+  uint16_t vVisible, vFront, vSync, vBack;
+  bool hSyncNegative, vSyncNegative;
+
+  uint16_t hTotal() const {
+    return hVisible + hFront + hSync + hBack;
+  }
+
+  uint16_t vTotal() const {
+    return vVisible + vFront + vSync + vBack;
+  }
+};
+
+static const VgaTiming VGA_640x480_60 = {25175000, 640, 16, 96, 48, 480, 10, 2, 33, true, true};
+
+// 0..255 na składową, zostają 2 najstarsze bity
+inline uint8_t vgaRgb(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint8_t)((r >> 6) | ((g >> 6) << 2) | ((b >> 6) << 4));
+}
+
+enum VgaColor : uint8_t {
+  VGA_BLACK = 0x00,
+  VGA_RED = 0x03,
+  VGA_GREEN = 0x0C,
+  VGA_YELLOW = 0x0F,
+  VGA_BLUE = 0x30,
+  VGA_MAGENTA = 0x33,
+  VGA_CYAN = 0x3C,
+  VGA_WHITE = 0x3F,
+  VGA_GRAY = 0x15,
+  VGA_DARK_BLUE = 0x10
+};
+
+// glify 8 px szerokości, bajt na wiersz, bit 0 = lewy piksel
+struct VgaFont {
+  const uint8_t *glyphs;
+  uint8_t first;
+  uint8_t count;
+  uint8_t height;
+};
+
+static const VgaFont VGA_FONT8X8 = {font8x8, FONT8X8_FIRST, FONT8X8_COUNT, 8};
+
+// kafelki pasków: VGA_TILE_BAR + n, n = 0..8 zapalonych kolumn od lewej
+#define VGA_TILE_BAR 0x80
+#define VGA_BAR_ROWS(v) 0x00, v, v, v, v, v, v, 0x00
+
+static const uint8_t vgaBarTiles[9 * 8] = {
+  VGA_BAR_ROWS(0x00), VGA_BAR_ROWS(0x01), VGA_BAR_ROWS(0x03), VGA_BAR_ROWS(0x07), VGA_BAR_ROWS(0x0F),
+  VGA_BAR_ROWS(0x1F), VGA_BAR_ROWS(0x3F), VGA_BAR_ROWS(0x7F), VGA_BAR_ROWS(0xFF),
+};
+
+static const VgaFont VGA_BAR_TILES = {vgaBarTiles, VGA_TILE_BAR, 9, 8};
+
+struct VgaCell {
+  uint8_t code;
+  uint8_t fg;
+  uint8_t bg;
+};
+
+class VgaTextLayer {
+private:
+  VgaCell *cells;
+  uint16_t cols;
+  uint16_t rows;
+  const VgaFont *font;
+  const VgaFont *tiles;
+  uint8_t scaleY;
+  uint8_t cellHeight;
+
+  // wiersz line glifu albo nullptr dla kodu spoza czcionki i kafelków
+  const uint8_t *glyphRow(uint8_t code, uint8_t line) const {
+    if ((uint8_t)(code - font->first) < font->count) return font->glyphs + (code - font->first) * font->height + line;
+    if (tiles && (uint8_t)(code - tiles->first) < tiles->count && line < tiles->height)
+      return tiles->glyphs + (code - tiles->first) * tiles->height + line;
+    return nullptr;
+  }
+
+public:
+  VgaTextLayer() : cells(nullptr), cols(0), rows(0), font(&VGA_FONT8X8), tiles(nullptr), scaleY(1), cellHeight(8) {}
+
+  // storage na cols * rows komórek
+  void begin(VgaCell *storage, uint16_t c, uint16_t r, const VgaFont &f = VGA_FONT8X8, uint8_t scale = 2,
+             const VgaFont *t = &VGA_BAR_TILES) {
+    cells = storage;
+    cols = c;
+    rows = r;
+    font = &f;
+    tiles = t;
+    scaleY = scale ? scale : 1;
+    cellHeight = (uint8_t)(font->height * scaleY);
+    clear(VGA_WHITE, VGA_BLACK);
+  }
+
+  uint16_t getCols() const {
+    return cols;
+  }
+
+  uint16_t getRows() const {
+    return rows;
+  }
+
+  uint32_t bytes() const {
+    return (uint32_t)cols * rows * sizeof(VgaCell);
+  }
+
+  void clear(uint8_t fg, uint8_t bg) {
+    for (uint32_t i = 0; i < (uint32_t)cols * rows; i++) cells[i] = {' ', fg, bg};
+  }
+
+  void put(uint16_t col, uint16_t row, uint8_t code, uint8_t fg, uint8_t bg) {
+    if (col < cols && row < rows) cells[row * cols + col] = {code, fg, bg};
+  }
+
+  // zwraca kolumnę za tekstem, to co wychodzi poza wiersz jest obcinane
+  uint16_t print(uint16_t col, uint16_t row, const char *text, uint8_t fg, uint8_t bg) {
+    while (*text) put(col++, row, (uint8_t)*text++, fg, bg);
+    return col;
+  }
+
+  uint16_t printf(uint16_t col, uint16_t row, uint8_t fg, uint8_t bg, const char *format, ...)
+      __attribute__((format(printf, 6, 7))) {
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return print(col, row, text, fg, bg);
+  }
+
+  // pasek width komórek wypełniony w value / maxValue, z dokładnością do 1 px
+  void bar(uint16_t col, uint16_t row, uint16_t width, uint32_t value, uint32_t maxValue, uint8_t fg, uint8_t bg) {
+    if (value > maxValue) value = maxValue;
+    uint32_t lit = maxValue ? (uint32_t)((uint64_t)width * 8 * value / maxValue) : 0;
+    for (uint16_t i = 0; i < width; i++) {
+      uint32_t n = lit > 8 ? 8 : lit;
+      put(col + i, row, (uint8_t)(VGA_TILE_BAR + n), fg, bg);
+      lit -= n;
+    }
+  }
+
+  // wiersz y obrazu: width pikseli do dst w kolejności I2S, sync = bity synchronizacji
+  void renderLine(uint16_t *dst, uint16_t y, uint8_t sync, uint16_t width) const {
+    uint32_t x = 0;
+    uint16_t row = y / cellHeight;
+    if (row < rows) {
+      uint8_t line = (uint8_t)((y % cellHeight) / scaleY);
+      const VgaCell *c = &cells[row * cols];
+      uint16_t n = width / 8 < cols ? width / 8 : cols;
+      for (uint16_t i = 0; i < n; i++, c++, x += 8) {
+        const uint8_t *g = glyphRow(c->code, line);
+        uint8_t bits = g ? *g : 0;
+        uint16_t fg = c->fg | sync;
+        uint16_t bg = c->bg | sync;
+        for (uint32_t k = 0; k < 8; k++) dst[I2sParallel::sampleIndex(x + k)] = (bits >> k) & 1 ? fg : bg;
+      }
+    }
+    for (; x < width; x++) dst[I2sParallel::sampleIndex(x)] = sync;
+  }
+};
+
+class VgaScanout {
+private:
+  enum LineKind : uint8_t { LINE_NONE, LINE_VISIBLE, LINE_BLANK, LINE_VSYNC };
+
+  struct Slot {
+    const uint16_t *buffer;
+    LineKind kind;
+  };
+
+  VgaTiming timing;
+  const VgaTextLayer *layer;
+  uint16_t line;  // następna linia do narysowania
+  uint32_t frames;
+  Slot slots[VGA_LINE_BUFFERS];
+  uint32_t nextSlot;
+
+  // rodzaj zawartości bufora, nowy bufor dostaje wolne miejsce
+  Slot &slotOf(const uint16_t *buffer) {
+    for (uint32_t i = 0; i < VGA_LINE_BUFFERS; i++)
+      if (slots[i].buffer == buffer) return slots[i];
+    Slot &s = slots[nextSlot];
+    nextSlot = (nextSlot + 1) % VGA_LINE_BUFFERS;
+    s.buffer = buffer;
+    s.kind = LINE_NONE;
+    return s;
+  }
+
+  void span(uint16_t *dst, uint32_t from, uint32_t to, uint8_t v) {
+    for (uint32_t x = from; x < to; x++) dst[I2sParallel::sampleIndex(x)] = v;
+  }
+
+public:
+  VgaScanout() : timing(VGA_640x480_60), layer(nullptr), line(0), frames(0), nextSlot(0) {
+    memset(slots, 0, sizeof(slots));
+  }
+
+  void begin(const VgaTiming &t, const VgaTextLayer *l) {
+    timing = t;
+    layer = l;
+    line = 0;
+    frames = 0;
+    nextSlot = 0;
+    memset(slots, 0, sizeof(slots));
+  }
+
+  // bity synchronizacji dla stanów aktywny / nieaktywny z polaryzacją
+  uint8_t syncBits(bool hsync, bool vsync) const {
+    return (uint8_t)((hsync != timing.hSyncNegative ? VGA_HSYNC_BIT : 0) |
+                     (vsync != timing.vSyncNegative ? VGA_VSYNC_BIT : 0));
+  }
+
+  // następna linia do bufora z hTotal() próbkami
+  void fill(uint16_t *dst) {
+    uint16_t vSyncStart = timing.vVisible + timing.vFront;
+    LineKind kind = line < timing.vVisible ? LINE_VISIBLE
+                    : line >= vSyncStart && line < vSyncStart + timing.vSync ? LINE_VSYNC
+                                                                             : LINE_BLANK;
+    bool vsync = kind == LINE_VSYNC;
+    uint8_t idle = syncBits(false, vsync);
+
+    Slot &s = slotOf(dst);
+    if (s.kind != kind) {
+      uint32_t hSyncStart = timing.hVisible + timing.hFront;
+      span(dst, timing.hVisible, hSyncStart, idle);
+      span(dst, hSyncStart, hSyncStart + timing.hSync, syncBits(true, vsync));
+      span(dst, hSyncStart + timing.hSync, timing.hTotal(), idle);
+      if (kind != LINE_VISIBLE) span(dst, 0, timing.hVisible, idle);
+      s.kind = kind;
+    }
+    if (kind == LINE_VISIBLE) {
+      if (layer) layer->renderLine(dst, line, idle, timing.hVisible);
+      else span(dst, 0, timing.hVisible, idle);
+    }
+
+    if (++line == timing.vTotal()) {
+      line = 0;
+      frames++;
+    }
+  }
+
+  uint16_t getLine() const {
+    return line;
+  }
+
+  uint32_t getFrames() const {
+    return frames;
+  }
+
+  const VgaTiming &getTiming() const {
+    return timing;
+  }
+};
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32
+// piny bitów koloru (najmłodszy pierwszy) i synchronizacji
+struct VgaPins {
+  int8_t red[2];
+  int8_t green[2];
+  int8_t blue[2];
+  int8_t hsync;
+  int8_t vsync;
+};
+
+// TTGO VGA32 v1.2, jak domyślne w FabGL
+static const VgaPins VGA_PINS_TTGO = {{21, 22}, {18, 19}, {4, 5}, 23, 15};
+
+class Vga {
+private:
+  I2sParallel bus;
+  VgaScanout scanout;
+
+  static void fillLine(uint16_t *buffer, uint32_t samples, void *arg) {
+    (void)samples;
+    ((VgaScanout *)arg)->fill(buffer);
+  }
+
+public:
+  // layer musi żyć tak długo jak obraz, zmiany w nim widać od następnej linii
+  bool begin(const VgaPins &pins, const VgaTiming &timing, const VgaTextLayer *layer) {
+    scanout.begin(timing, layer);
+    I2sParallelConfig cfg = {};
+    const int8_t order[8] = {pins.red[0],  pins.red[1],  pins.green[0], pins.green[1],
+                             pins.blue[0], pins.blue[1], pins.hsync,    pins.vsync};
+    for (uint32_t i = 0; i < 16; i++) cfg.dataPins[i] = i < 8 ? order[i] : -1;
+    cfg.busWidth = 8;
+    cfg.clockPin = -1;
+    cfg.clockHz = timing.pixelHz;
+    cfg.samples = timing.hTotal();
+    cfg.bufferCount = VGA_LINE_BUFFERS;
+    cfg.fill = fillLine;
+    cfg.arg = &scanout;
+    cfg.apll = true;
+    return bus.begin(cfg);
+  }
+
+  void end() {
+    bus.end();
+  }
+
+  uint32_t getPixelHz() const {
+    return bus.getClockHz();
+  }
+
+  uint32_t getFrames() const {
+    return scanout.getFrames();
+  }
+
+  // bufory linii = 1 linia, niedobór = linia rysowana dłużej niż zapas
+  I2sParallelStats takeStats() {
+    return bus.takeStats();
+  }
+};
+#endif
+
+#ifndef ARDUINO
+// cała klatka ze VgaScanout tak jak z DMA: RGB do PPM i kontrola synchronizacji
+class VgaHostFrame {
+private:
+  uint16_t *lines;
+  uint8_t *rgb;
+  uint8_t *colors;
+  uint16_t width;
+  uint16_t height;
+  uint32_t syncErrors;
+  uint32_t vsyncLines;
+
+public:
+  VgaHostFrame() : lines(nullptr), rgb(nullptr), colors(nullptr), width(0), height(0), syncErrors(0), vsyncLines(0) {}
+
+  ~VgaHostFrame() {
+    free(lines);
+    free(rgb);
+    free(colors);
+  }
+
+  VgaHostFrame(const VgaHostFrame &) = delete;
+  VgaHostFrame &operator=(const VgaHostFrame &) = delete;
+
+  // jedna klatka od bieżącej linii scanout (po begin() to linia 0)
+  bool capture(VgaScanout &scanout) {
+    const VgaTiming &t = scanout.getTiming();
+    uint32_t total = t.hTotal();
+    if (!lines) {
+      width = t.hVisible;
+      height = t.vVisible;
+      lines = (uint16_t *)calloc(VGA_LINE_BUFFERS * total, sizeof(uint16_t));
+      rgb = (uint8_t *)calloc((size_t)width * height * 3, 1);
+      colors = (uint8_t *)calloc((size_t)width * height, 1);
+      if (!lines || !rgb || !colors) return false;
+    }
+    syncErrors = 0;
+    vsyncLines = 0;
+    uint32_t hSyncStart = t.hVisible + t.hFront;
+    uint32_t vSyncStart = t.vVisible + t.vFront;
+    for (uint32_t n = 0; n < t.vTotal(); n++) {
+      uint32_t y = scanout.getLine();
+      uint16_t *buf = lines + (n % VGA_LINE_BUFFERS) * total;
+      scanout.fill(buf);
+      bool vsync = y >= vSyncStart && y < vSyncStart + t.vSync;
+      vsyncLines += vsync;
+      for (uint32_t x = 0; x < total; x++) {
+        uint8_t v = (uint8_t)buf[I2sParallel::sampleIndex(x)];
+        bool hsync = x >= hSyncStart && x < hSyncStart + t.hSync;
+        if ((v & (VGA_HSYNC_BIT | VGA_VSYNC_BIT)) != scanout.syncBits(hsync, vsync)) syncErrors++;
+        uint8_t color = v & 0x3F;
+        if (x < t.hVisible && y < t.vVisible) {
+          colors[y * width + x] = color;
+          uint8_t *p = &rgb[(y * width + x) * 3];
+          p[0] = (uint8_t)((color & 3) * 85);
+          p[1] = (uint8_t)(((color >> 2) & 3) * 85);
+          p[2] = (uint8_t)(((color >> 4) & 3) * 85);
+        } else if (color) {
+          syncErrors++;  // kolor poza obszarem widocznym
+        }
+      }
+    }
+    return true;
+  }
+
+  // próbki z błędną synchronizacją albo kolorem w wygaszaniu
+  uint32_t getSyncErrors() const {
+    return syncErrors;
+  }
+
+  uint32_t getVsyncLines() const {
+    return vsyncLines;
+  }
+
+  uint8_t pixel(uint16_t x, uint16_t y) const {
+    return x < width && y < height ? colors[y * width + x] : 0;
+  }
+
+  bool writePpm(const char *path) const {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%u %u\n255\n", (unsigned)width, (unsigned)height);
+    bool ok = fwrite(rgb, 3, (size_t)width * height, f) == (size_t)width * height;
+    return fclose(f) == 0 && ok;
+  }
+};
+#endif
+
+#endif // Vga_h
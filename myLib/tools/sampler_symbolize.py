@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------------
+# Zamiana zrzutu Sampler::dump() na nazwy funkcji z pliku ELF.
+#
+#   pio device monitor | tee log.txt      (w monitorze wysłać 's')
+#   python3 sampler_symbolize.py .pio/build/esp32/firmware.elf log.txt
+#
+# Brany jest ostatni zrzut z logu ("# sampler" ... "# end"). Adresy
+# są tłumaczone jednym wywołaniem addr2line, wybranym według
+# architektury z nagłówka ELF (xtensa-esp32-elf-, riscv32-esp-elf-...),
+# szukanym w PATH i w ~/.platformio/packages. Inny program: --addr2line.
+# ---------------------------------------------------------------
+import argparse
+import glob
+import os
+import shutil
+import struct
+import subprocess
+import sys
+from collections import defaultdict
+
+EM_XTENSA = 94
+EM_RISCV = 243
+
+
+def elf_machine(path):
+    with open(path, "rb") as f:
+        header = f.read(20)
+    if header[:4] != b"\x7fELF":
+        sys.exit("%s: to nie jest plik ELF" % path)
+    endian = "<" if header[5] == 1 else ">"
+    return struct.unpack(endian + "H", header[18:20])[0]
+
+
+def find_addr2line(elf):
+    machine = elf_machine(elf)
+    if machine == EM_XTENSA:
+        names = ["xtensa-esp32-elf-addr2line", "xtensa-esp32s2-elf-addr2line",
+                 "xtensa-esp32s3-elf-addr2line", "xtensa-esp-elf-addr2line"]
+    elif machine == EM_RISCV:
+        names = ["riscv32-esp-elf-addr2line"]
+    else:
+        names = ["addr2line"]
+    for name in names:
+        path = shutil.which(name)
+        if path:
+            return path
+        found = glob.glob(os.path.expanduser("~/.platformio/packages/toolchain-*/bin/" + name))
+        if found:
+            return found[0]
+    sys.exit("nie znaleziono addr2line (%s), podać --addr2line" % ", ".join(names))
+
+
+def read_dump(lines):
+    header, tasks, pcs = None, [], {}
+    current = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# sampler"):
+            current = (line, [], {})
+        elif current is None:
+            continue
+        elif line == "# end":
+            header, tasks, pcs = current
+            current = None
+        elif line.startswith("task "):
+            name, count = line[5:].rsplit(" ", 1)
+            current[1].append((name, int(count)))
+        elif line.startswith("pc "):
+            _, addr, count = line.split()
+            current[2][int(addr, 16)] = current[2].get(int(addr, 16), 0) + int(count)
+    if header is None:
+        sys.exit("w logu nie ma pełnego zrzutu (# sampler ... # end)")
+    return header, tasks, pcs
+
+
+def symbolize(addr2line, elf, addrs):
+    out = subprocess.run([addr2line, "-e", elf, "-f", "-C"],
+                         input="".join("0x%x\n" % a for a in addrs),
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    result = {}
+    for i, addr in enumerate(addrs):
+        func = out[2 * i] if 2 * i < len(out) else "??"
+        where = out[2 * i + 1] if 2 * i + 1 < len(out) else "??:0"
+        where = where.split(" (discriminator")[0]
+        result[addr] = (func, where)
+    return result
+
+
+def print_table(title, rows, total, limit):
+    print("\n%s" % title)
+    print("%8s %7s  %s" % ("próbki", "%", "miejsce"))
+    for name, count in sorted(rows.items(), key=lambda r: -r[1])[:limit]:
+        print("%8d %6.2f%%  %s" % (count, 100.0 * count / total, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolizacja zrzutu Sampler::dump()")
+    parser.add_argument("elf", help="firmware.elf z .pio/build/<env>/")
+    parser.add_argument("log", nargs="?", help="log z monitora, domyślnie stdin")
+    parser.add_argument("--addr2line", help="ścieżka do addr2line dla architektury ELF")
+    parser.add_argument("--top", type=int, default=30, help="liczba wierszy tabel")
+    parser.add_argument("--lines", action="store_true", help="dodatkowo tabela plik:linia")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as f:
+            header, tasks, pcs = read_dump(f)
+    else:
+        header, tasks, pcs = read_dump(sys.stdin)
+
+    total = sum(pcs.values())
+    print(header)
+    if total == 0:
+        return
+
+    addr2line = args.addr2line or find_addr2line(args.elf)
+    symbols = symbolize(addr2line, args.elf, sorted(pcs))
+
+    functions = defaultdict(int)
+    lines = defaultdict(int)
+    files = defaultdict(int)
+    for addr, count in pcs.items():
+        func, where = symbols[addr]
+        functions[func] += count
+        lines[func + "  " + os.path.basename(where)] += count
+        files[where.rsplit(":", 1)[0]] += count
+
+    if tasks:
+        print_table("Taski", dict(tasks), sum(c for _, c in tasks), args.top)
+    print_table("Funkcje", functions, total, args.top)
+    print_table("Pliki", files, total, args.top)
+    if args.lines:
+        print_table("Linie", lines, total, args.top)
+
+
+if __name__ == "__main__":
+    main()